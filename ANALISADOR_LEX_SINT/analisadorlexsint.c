@@ -5,10 +5,64 @@
 #include <stdbool.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <utime.h>
+#include <limits.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <math.h>
+#include <poll.h>
+#include <sys/inotify.h>
 
-#define MAX_SYMBOLS 100
+#include "arvore.h"
+
+#define SYMBOL_TABLE_INITIAL 64
+#define NAME_CHUNK_SIZE 4096
+#define INTERNER_SHARD_BITS 6
+#define INTERNER_SHARDS (1 << INTERNER_SHARD_BITS)
+#define INTERNER_SHARD_INITIAL 16
 #define MAX_LEXEME 100
 #define MAX_LINE_LENGTH 256
+#define LEXER_READ_SIZE (64 * 1024)
+#define LEXER_HISTORY (16 * 1024)
+#define TOKEN_BATCH_SIZE 256
+#define TRACE_RING_SIZE 4096
+#define PIPELINE_SLOTS 16
+#define PIPELINE_SPINS 64
+#define OUTPUT_BUFFER_SIZE (256 * 1024)
+#define TOKEN_NAME_WIDTH 15
+#define OUT_MEMORY -1
+#define BINARY_MAGIC "MPASBIN"
+#define BINARY_VERSION 1
+// Deve mudar sempre que a saida do analisador mudar: invalida o cache
+#define ANALYZER_VERSION "1.1"
+#define CACHE_MAGIC "MPASCCH"
+#define CACHE_VERSION 1
+#define CACHE_DEFAULT_MAX_BYTES (256ULL * 1024 * 1024)
+#define EXECUTION_MAX_DEPTH 10000
+#define EXECUTION_DEFAULT_STEPS 100000000ULL
+#define EVALUATION_DEFAULT_STEPS 1000000ULL
+#define EVALUATION_DEFAULT_MSEC 100
+#define EVALUATION_CHECK_STEPS 65536
+#define PROFILE_INTERVAL_USEC 1000
+#define PROFILE_REPORT_ROWS 15
+#define NATIVE_CC_FLAGS "-O2 -ffp-contract=off"
+#define NATIVE_CC_FLAG_LIST "-O2", "-ffp-contract=off"
+#define WATCH_DEBOUNCE_MSEC 100
+#define WATCH_REPORT_ERRORS 10
+// Codigo de saida quando --max-memory (ou o proprio malloc) nao deixa alocar
+#define EXIT_MEMORY 3
 
 typedef enum {
     // Palavras reservadas
@@ -30,44 +84,513 @@ typedef enum {
     TOK_EOF, TOK_ERROR
 } TokenType;
 
+// Bloco de nomes: cada nome fica no mesmo lugar ate o fim (as tabelas
+// guardam ponteiros); blocos cheios ficam encadeados por previous
+typedef struct NameChunk {
+    struct NameChunk* previous;
+    size_t size;
+    size_t used;
+    char data[];
+} NameChunk;
+
+// Interner de nomes compartilhado por varios lexers (varias threads): cada
+// nome fica guardado uma vez so no processo. INTERNER_SHARDS partes pelos
+// bits altos do hash, cada uma com enderecamento aberto. Leitura sem trava:
+// o slot e publicado com release depois que o nome esta escrito. Insercao
+// com a trava da parte, que confere de novo antes de inserir. Ao crescer, a
+// tabela nova e publicada inteira; a antiga fica em retired ate o fim, pois
+// um leitor pode ainda estar nela (quem nao acha ali cai na insercao, que
+// olha a tabela nova)
 typedef struct {
-    char name[MAX_LEXEME];
+    uint32_t hash;
+    uint32_t length;
+    char name[];
+} InternedName;
+
+typedef struct InternerSlots {
+    uint32_t mask;
+    struct InternerSlots* retired;
+    _Atomic(const InternedName*) slots[];
+} InternerSlots;
+
+typedef struct {
+    _Alignas(64) _Atomic(InternerSlots*) table;
+    pthread_mutex_t lock;
+    uint32_t count;
+    NameChunk* names;
+} InternerShard;
+
+typedef struct {
+    InternerShard shards[INTERNER_SHARDS];
+    _Atomic uint64_t count;
+    _Atomic uint64_t bytes;
+    _Atomic uint64_t lock_waits;
+} Interner;
+
+typedef struct {
+    const char* name;
+    uint32_t length;
+    uint32_t hash;
     TokenType type;
 } Symbol;
 
+// Simbolos na ordem de insercao (a da impressao); slots e o indice hash
+// (indice + 1, 0 = vazio), como na StringPool. Cresce sem limite fixo: o
+// teto e o de --max-memory. Os nomes ficam em names, ou no interner
+// compartilhado: ai a tabela e so a visao do arquivo (ordem e tipos)
 typedef struct {
-    Symbol symbols[MAX_SYMBOLS];
+    Symbol* symbols;
     int count;
+    int capacity;
+    uint32_t* slots;
+    uint32_t slot_mask;
+    NameChunk* names;
+    Interner* interner;
 } SymbolTable;
 
 typedef struct {
     TokenType type;
     char lexeme[MAX_LEXEME];
-    int line;
-    int column;
+    int64_t line;
+    int64_t column;
+    // Valor dos literais, calculado na mesma passada que copia o lexema
+    int64_t integer;  // LIT_INT
+    double real;      // LIT_REAL e LIT_REAL_EXP
 } Token;
 
+// A entrada e lida em blocos por read(); os ultimos LEXER_HISTORY bytes ja
+// consumidos ficam no buffer para ShowError mostrar a linha do erro sem
+// reabrir o arquivo (o que nao e possivel em pipes e stdin)
 typedef struct {
-    FILE* file;
-    char current_char;
-    int line;
-    int column;
+    int fd;
+    bool seekable;
+    unsigned char* buffer;
+    size_t length;
+    size_t position;
+    uint64_t buffer_offset;
+    bool at_end;
+    int current_char;
+    int64_t line;
+    int64_t column;
     SymbolTable symbol_table;
     char* filename; 
 } Lexer;
 
+// Lote de tokens produzido pela thread do lexer no modo --pipeline
+typedef struct {
+    Token tokens[TOKEN_BATCH_SIZE];
+    int count;
+} TokenBatch;
+
+// Anel SPSC: a thread do lexer publica lotes em head, o parser consome em tail.
+// Com PIPELINE_SLOTS lotes cheios o produtor espera (backpressure). Quem
+// espera cede a CPU PIPELINE_SPINS vezes e depois dorme em changed; o outro
+// lado so pega o lock para acordar quando waiting > 0
+typedef struct {
+    Lexer* lexer;
+    TokenBatch slots[PIPELINE_SLOTS];
+    _Atomic size_t head;
+    _Atomic size_t tail;
+    _Atomic int stop;
+    _Atomic int waiting;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    pthread_t thread;
+    size_t position;
+    bool finished;
+    Token last_token;
+} TokenPipeline;
+
+typedef struct {
+    bool pipeline;
+    bool binary;
+    const char* dump_filename;
+    const char* cache_dir;
+    uint64_t cache_max_bytes;
+    bool cache_stats;
+    const char* output_base;
+    bool stats;
+    bool stats_json;
+    bool no_trace;
+    bool ll1;
+    bool execute;
+    bool profile;
+    uint64_t max_steps;
+    bool emit_c;
+    bool compile;
+    bool fold;
+    uint64_t max_milliseconds;
+    bool tree_snapshot;
+    uint64_t max_memory;
+    const char* watch_dir;
+    const char* symbols_dir;
+    int threads;
+    bool private_symbols;
+    bool literals_strtod;
+    bool plain_loops;
+    bool loop_report;
+} Options;
+
+typedef enum {
+    STATS_PHASE_LEXICAL,
+    STATS_PHASE_PARSE,
+    STATS_PHASE_SYNTAX_FILE,
+    STATS_PHASE_STREAM,
+    STATS_PHASE_OUTPUT,
+    STATS_PHASE_DIAGNOSTICS,
+    STATS_PHASE_EXECUTION,
+    STATS_PHASES
+} StatsPhase;
+
+// --stats: tempos por fase e bytes lidos/escritos sao sempre medidos (fora
+// dos lacos internos). Os contadores por token/caractere so existem quando
+// compilado com -DMPAS_STATS; sem isso STAT_ADD nao gera codigo.
+typedef struct {
+    double phase_seconds[STATS_PHASES];
+    // Atomico: com --pipeline e --simbolos ha lexers em outras threads
+    _Atomic uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint64_t tokens[TOK_ERROR + 1];
+    uint64_t symbol_lookups;
+    uint64_t symbol_probes;
+    uint64_t symbol_collisions;
+    uint64_t peek_calls;
+    uint64_t ll1_stack_peak;
+} Stats;
+
+// Subsistemas da contabilidade de memoria (mem_realloc/mem_free)
+typedef enum {
+    MEMORY_SOURCE,     // buffers de leitura do fonte, arquivos lidos inteiros, mmap do .bin
+    MEMORY_TOKENS,     // pipeline de tokens, tokens e strings do --binario
+    MEMORY_SYMBOLS,    // tabela de simbolos
+    MEMORY_PARSE,      // pilhas do parser, sequencia de producoes, arvore do programa
+    MEMORY_OUTPUT,     // OutputBuffer (terminal, .lex, .syntax, cache, C gerado)
+    MEMORY_EXECUTION,  // valores das variaveis e contadores do perfil
+    MEMORY_SUBSYSTEMS
+} MemorySubsystem;
+
+#ifdef MPAS_STATS
+#define STAT_ADD(field, amount) (stats.field += (amount))
+#else
+#define STAT_ADD(field, amount) ((void)0)
+#endif
+
+// Saida bufferizada com formatacao manual; substitui printf/fprintf nos
+// arquivos .lex/.syntax e no terminal. Com fd == OUT_MEMORY o buffer so
+// cresce e o conteudo fica em data.
+typedef struct OutputBuffer {
+    int fd;
+    char* data;
+    size_t length;
+    size_t capacity;
+    struct OutputBuffer* capture;
+} OutputBuffer;
+
+typedef enum {
+    RULE_PROGRAM, RULE_BLOCK, RULE_VARIABLE_DECLARATIONS_PART,
+    RULE_VARIABLE_DECLARATION, RULE_IDENTIFIER_LIST, RULE_TYPE,
+    RULE_COMPOUND_COMMAND, RULE_COMMAND, RULE_ASSIGNMENT,
+    RULE_CONDITIONAL_COMMAND, RULE_REPETITIVE_COMMAND, RULE_EXPRESSION,
+    RULE_RELATION, RULE_SIMPLE_EXPRESSION, RULE_TERM, RULE_FACTOR,
+    RULE_VARIABLE,
+    RULE_COUNT
+} ProductionRule;
+
+// Eventos da sequencia de producoes alem das regras; EVENT_ERROR e seguido
+// pelo indice do texto do diagnostico na tabela de strings
+#define EVENT_SUCCESS RULE_COUNT
+#define EVENT_ERROR (RULE_COUNT + 1)
+
+typedef struct {
+    const char* text;
+    size_t length;
+} ProductionText;
+
+// Tabela de strings sem repeticao; cada string termina em '\0' dentro de blob
+typedef struct {
+    char* blob;
+    size_t blob_size;
+    size_t blob_capacity;
+    uint32_t* offsets;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t* slots;
+    uint32_t slot_mask;
+} StringPool;
+
+typedef struct {
+    TokenType type;
+    uint32_t string_id;
+    int64_t line;
+    int64_t column;
+} BinaryToken;
+
+typedef struct {
+    StringPool strings;
+    BinaryToken* tokens;
+    size_t token_count;
+    size_t token_capacity;
+    uint32_t* events;
+    size_t event_count;
+    size_t event_capacity;
+} BinaryWriter;
+
+// Copia do que foi escrito no terminal, com as fronteiras das duas fases;
+// as linhas com o nome do arquivo ficam de fora para o cache nao depender dele
+typedef struct {
+    OutputBuffer log;
+    size_t lexical_end;
+    size_t syntax_start;
+    size_t syntax_end;
+    bool syntax_saved;
+    bool complete;
+} AnalysisTranscript;
+
+// --watch: o .lex e o .syntax ficam nestes buffers em vez de irem para os
+// arquivos, e a tabela de simbolos da passada lexica fica com o chamador,
+// com os nomes no interner dele
+typedef struct {
+    OutputBuffer lex;
+    OutputBuffer syntax;
+    SymbolTable symbols;
+    uint64_t tokens;
+    Interner* interner;
+} AnalysisOutputs;
+
+enum {
+    CACHE_LEXICAL_LOG, CACHE_SYNTAX_LOG, CACHE_TOKENS_FILE, CACHE_SYNTAX_FILE,
+    CACHE_SECTIONS
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    int32_t exit_code;
+    uint32_t flags;
+    uint32_t reserved;
+    uint64_t checksum;
+    uint64_t section_size[CACHE_SECTIONS];
+} CacheEntryHeader;
+
+#define CACHE_SYNTAX_SAVED 1u
+
+// Cabecalho do formato binario (little-endian). As secoes sao apontadas por
+// deslocamentos a partir do inicio do arquivo, que pode ser lido via mmap.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t string_count;
+    uint64_t string_index_offset;
+    uint64_t string_blob_offset;
+    uint64_t string_blob_size;
+    uint64_t token_count;
+    uint64_t token_offset;
+    uint64_t token_size;
+    uint64_t event_count;
+    uint64_t event_offset;
+    uint64_t event_size;
+} BinaryHeader;
+
+// Arvore do programa aceito, usada por --executar. Os nos ficam em vetores
+// e se ligam por indice (-1: nenhum)
+typedef enum {
+    EXPR_INTEGER, EXPR_REAL, EXPR_VARIABLE, EXPR_NEGATE, EXPR_BINARY
+} ExpressionKind;
+
+typedef struct {
+    ExpressionKind kind;
+    TokenType op;
+    int32_t left;
+    int32_t right;
+    int32_t variable;
+    int32_t height;  // 1 nas folhas: profundidade da recursao de evaluate
+    int64_t integer;
+    double real;
+} ExpressionNode;
+
+// Trecho do fonte: primeiro e ultimo caractere (fica fora de ExpressionNode
+// para nao pesar no interpretador; so --arvore usa)
+typedef struct {
+    int64_t line;
+    int64_t column;
+    int64_t end_line;
+    int64_t end_column;
+} SourceSpan;
+
+typedef enum {
+    STMT_ASSIGNMENT, STMT_COMPOUND, STMT_CONDITIONAL, STMT_REPETITIVE
+} StatementKind;
+
+// body: corpo do while, ramo then do if ou primeiro comando do composto;
+// next: proximo comando do mesmo composto; parent: comando que contem este;
+// loop: CountedLoop do while (-1: nao e laco contado)
+typedef struct {
+    StatementKind kind;
+    int32_t parent;
+    int32_t next;
+    int32_t variable;
+    int32_t expression;
+    int32_t body;
+    int32_t alternative;
+    int32_t loop;
+    int64_t line;
+    int64_t column;
+    int64_t end_line;
+    int64_t end_column;
+} StatementNode;
+
+typedef struct {
+    char name[MAX_LEXEME];
+    bool real;
+    bool declared;
+    SourceSpan span;
+} ProgramVariable;
+
+// Laco contado (analyze_loops): while v op limite, com v integer, o limite
+// um literal ou uma variavel integer que o corpo nao altera, e v alterada
+// no corpo so por um v := v + passo (ou v - passo) no nivel de cima dele.
+// O numero de voltas sai de v, do limite e do passo na entrada do laco.
+// Cada nivel vale para o corpo inteiro e inclui o anterior
+typedef enum {
+    LOOP_COUNTED,   // corpo qualquer: so o numero de voltas
+    LOOP_STRAIGHT,  // so atribuicoes: os passos do corpo entram de uma vez
+    LOOP_BATCHED,   // so acumulacoes e atribuicoes inteiras independentes entre as voltas
+    LOOP_CLOSED     // ... com as acumulacoes afins em v: forma fechada
+} LoopKind;
+
+typedef enum {
+    LOOP_INDUCTION,   // v := v + passo
+    LOOP_ACCUMULATE,  // t := t + e (t uma vez so, somando, e e nao le t)
+    LOOP_SET,         // t := e
+    LOOP_OTHER
+} LoopRole;
+
+// Atribuicao do nivel de cima de um corpo LOOP_STRAIGHT, na ordem
+typedef struct {
+    int32_t statement;
+    LoopRole role;
+    int32_t degree;        // grau de e em v (so +, - e *), -1 se nao e polinomio
+    bool after_induction;  // le v ja com o passo somado
+} LoopAssignment;
+
+typedef struct {
+    int32_t statement;
+    int32_t variable;
+    TokenType op;
+    int32_t limit;
+    int64_t step;
+    LoopKind kind;
+    int32_t first_assignment;
+    int32_t assignment_count;
+    uint32_t steps_per_iteration;
+} CountedLoop;
+
+typedef struct {
+    char name[MAX_LEXEME];
+    ProgramVariable* variables;
+    int32_t variable_count;
+    int32_t variable_capacity;
+    ExpressionNode* expressions;
+    SourceSpan* expression_spans;
+    int32_t expression_count;
+    int32_t expression_capacity;
+    StatementNode* statements;
+    int32_t statement_count;
+    int32_t statement_capacity;
+    CountedLoop* loops;
+    int32_t loop_count;
+    int32_t loop_capacity;
+    LoopAssignment* loop_assignments;
+    int32_t loop_assignment_count;
+    int32_t loop_assignment_capacity;
+    int32_t body;
+} ProgramTree;
+
+typedef struct {
+    bool real;
+    int64_t integer;
+    double real_value;
+} Value;
+
+typedef struct {
+    const ProgramTree* tree;
+    Value* values;
+    uint64_t steps;
+    uint64_t max_steps;
+    uint64_t step_limit;
+    double deadline;
+    bool timed_out;
+    bool stopped;
+    const char* error;
+    int32_t error_statement;
+} Execution;
+
+#define out_literal(out, text) out_write((out), (text), sizeof(text) - 1)
+
 const char* token_type_to_string(TokenType type);
+void init_token_name_columns(void);
+
+void* mem_realloc(MemorySubsystem subsystem, void* data, size_t old_size, size_t new_size);
+void* mem_calloc(MemorySubsystem subsystem, size_t count, size_t size);
+void mem_free(MemorySubsystem subsystem, void* data, size_t size);
+void memory_charge(MemorySubsystem subsystem, size_t size);
+void memory_release(MemorySubsystem subsystem, size_t size);
+
+#define mem_alloc(subsystem, size) mem_realloc((subsystem), NULL, 0, (size))
+
+void out_init(OutputBuffer* out, int fd);
+void out_free(OutputBuffer* out);
+void out_flush(OutputBuffer* out);
+void out_write(OutputBuffer* out, const char* text, size_t length);
+void out_str(OutputBuffer* out, const char* text);
+void out_char(OutputBuffer* out, char c);
+void out_int(OutputBuffer* out, long long value);
+void out_padded(OutputBuffer* out, const char* text, size_t length, size_t width);
+void out_int_padded(OutputBuffer* out, long long value, int width);
+void out_varint(OutputBuffer* out, uint64_t value);
+size_t out_position(OutputBuffer* out);
+
+char* read_file(const char* filename, size_t* size);
+bool output_name(char* name, size_t size, const char* source_filename, const char* suffix);
+void free_file(char* data, size_t size);
+int write_file(const char* filename, const char* data, size_t size);
+uint64_t hash_bytes(const void* data, size_t length, uint64_t seed);
 
-void init_symbol_table(SymbolTable* table);
+void write_lex_header(OutputBuffer* out);
+void write_lex_entry(OutputBuffer* out, TokenType type, const char* lexeme, int64_t line, int64_t column);
+void write_console_entry(OutputBuffer* out, TokenType type, const char* lexeme, int64_t line, int64_t column);
+
+void init_string_pool(StringPool* pool);
+void free_string_pool(StringPool* pool);
+uint32_t intern_string(StringPool* pool, const char* text, size_t length);
+void init_binary_writer(BinaryWriter* writer);
+void free_binary_writer(BinaryWriter* writer);
+void binary_add_token(BinaryWriter* writer, const Token* token);
+void binary_add_event(BinaryWriter* writer, uint32_t event);
+void binary_use_symbol_order(BinaryWriter* writer, SymbolTable* table);
+int write_binary_file(BinaryWriter* writer, const char* filename);
+int dump_binary_file(const char* filename);
+
+int analyze_file(const char* source_filename, OutputBuffer* console, AnalysisTranscript* transcript);
+int analyze_with_cache(const char* source_filename, OutputBuffer* console);
+void print_cache_stats(const char* cache_dir);
+
+void init_interner(Interner* interner);
+void free_interner(Interner* interner);
+const InternedName* intern_name(Interner* interner, const char* name, uint32_t length, uint32_t hash);
+void init_symbol_table(SymbolTable* table, Interner* interner);
+void free_symbol_table(SymbolTable* table);
 int insert_symbol(SymbolTable* table, const char* name, TokenType type);
 Symbol* find_symbol(SymbolTable* table, const char* name);
-void print_symbol_table(SymbolTable* table);
+void print_symbol_table(OutputBuffer* out, SymbolTable* table);
 
-Lexer* init_lexer(FILE* file, const char* filename);
+Lexer* init_lexer(int fd, const char* filename, Interner* interner);
 void free_lexer(Lexer* lexer);
 Token get_next_token(Lexer* lexer);
 void skip_whitespace(Lexer* lexer);
-char peek_char(Lexer* lexer);
+int peek_char(Lexer* lexer);
+int read_char(Lexer* lexer);
 bool is_valid_operator_combination(char current, char next);
 bool is_valid_single_char_operator(char c);
 bool is_valid_operator_start(char c);
@@ -75,33 +598,149 @@ void handle_unclosed_comment(Lexer* lexer, Token* token);
 
 void to_lower_case(char* str);
 
+TokenPipeline* start_pipeline(Lexer* lexer);
+void stop_pipeline(TokenPipeline* pipeline);
+Token pipeline_next_token(TokenPipeline* pipeline);
+
 Lexer* global_lexer = NULL;
+TokenPipeline* global_pipeline = NULL;
+Options options = {0};
+Stats stats = {0};
+OutputBuffer* parser_output = NULL;
+BinaryWriter* binary_output = NULL;
+
+// Modo fluxo: lexico e sintatico numa unica passada; cada token consumido
+// pelo parser vai para o terminal e para o .lex
+typedef struct {
+    OutputBuffer* console;
+    OutputBuffer* lex;
+    bool has_errors;
+} TokenTap;
+
+TokenTap* token_tap = NULL;
+AnalysisOutputs* memory_outputs = NULL;
+
+#define PRODUCTION(text) { text, sizeof(text) - 1 }
+const ProductionText production_text[RULE_COUNT] = {
+    PRODUCTION("programa -> program ID ; bloco .\n"),
+    PRODUCTION("bloco -> parte_declaracoes_variaveis comando_composto\n"),
+    PRODUCTION("parte_declaracoes_variaveis -> var declaracao_variaveis { ; declaracao_variaveis }\n"),
+    PRODUCTION("declaracao_variaveis -> lista_identificadores : tipo\n"),
+    PRODUCTION("lista_identificadores -> ID { , ID }\n"),
+    PRODUCTION("tipo -> integer | real\n"),
+    PRODUCTION("comando_composto -> begin comando ; { comando ; } end\n"),
+    PRODUCTION("comando -> atribuicao | comando_composto | comando_condicional | comando_repetitivo\n"),
+    PRODUCTION("atribuicao -> variavel := expressao\n"),
+    PRODUCTION("comando_condicional -> if expressao then comando [ else comando ]\n"),
+    PRODUCTION("comando_repetitivo -> while expressao do comando\n"),
+    PRODUCTION("expressao -> expressao_simples [ relacao expressao_simples ]\n"),
+    PRODUCTION("relacao -> = | < | <= | >= | > | <>\n"),
+    PRODUCTION("expressao_simples -> [+ | -] termo { (+ | - ) termo }\n"),
+    PRODUCTION("termo -> fator { (* | / | mod) fator }\n"),
+    PRODUCTION("fator -> variavel | numero | ( expressao )\n"),
+    PRODUCTION("variavel -> ID\n"),
+};
+char token_name_columns[TOK_ERROR + 1][TOKEN_NAME_WIDTH + 1];
+OutputBuffer console_output, lex_output, syntax_output;
 Token current_token;
 int has_syntax_errors = 0;
 char* current_filename = NULL;
 
+// Contabilidade de memoria: toda alocacao que cresce com a entrada passa por
+// mem_realloc/mem_free com o tamanho antigo e o novo. O total e comparado
+// com --max-memory antes de alocar; estourar o limite (ou o malloc falhar)
+// termina o analisador com um diagnostico e EXIT_MEMORY. Atomicos porque
+// a thread do lexer (--pipeline) tambem aloca
+static const char* const memory_subsystem_names[MEMORY_SUBSYSTEMS] = {
+    "fonte", "tokens", "simbolos", "analise", "saida", "execucao"
+};
+_Atomic uint64_t memory_used[MEMORY_SUBSYSTEMS];
+_Atomic uint64_t memory_peak[MEMORY_SUBSYSTEMS];
+_Atomic uint64_t memory_total;
+_Atomic uint64_t memory_total_peak;
+atomic_bool memory_failing;
+
+static void memory_raise_peak(_Atomic uint64_t* peak, uint64_t value) {
+    uint64_t current = atomic_load_explicit(peak, memory_order_relaxed);
+    while (value > current &&
+           !atomic_compare_exchange_weak_explicit(peak, &current, value, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+// Sem alocar: a mensagem sai por write() direto no stderr
+static void memory_exhausted(MemorySubsystem subsystem, size_t size, bool over_budget) {
+    // Uma segunda falha (outra thread, ou alocacao durante o flush abaixo)
+    // so encerra
+    if (atomic_exchange(&memory_failing, true)) _exit(EXIT_MEMORY);
+    // Com --pipeline a outra thread pode estar escrevendo no terminal
+    if (console_output.data != NULL && !options.pipeline) out_flush(&console_output);
+
+    char line[256];
+    int length;
+    if (over_budget) {
+        length = snprintf(line, sizeof(line),
+                          "\nERRO: limite de memoria excedido (--max-memory %.2f MB): %s pediu mais %zu bytes com %llu em uso\n",
+                          (double)options.max_memory / (1024.0 * 1024.0), memory_subsystem_names[subsystem], size,
+                          (unsigned long long)atomic_load(&memory_total));
+    } else {
+        length = snprintf(line, sizeof(line), "\nERRO: sem memoria: %s nao conseguiu alocar %zu bytes com %llu em uso\n",
+                          memory_subsystem_names[subsystem], size, (unsigned long long)atomic_load(&memory_total));
+    }
+    if (write(STDERR_FILENO, line, (size_t)length) < 0) {}
+    for (int i = 0; i < MEMORY_SUBSYSTEMS; i++) {
+        length = snprintf(line, sizeof(line), "  %-10s %14llu bytes (pico %llu)\n", memory_subsystem_names[i],
+                          (unsigned long long)atomic_load(&memory_used[i]), (unsigned long long)atomic_load(&memory_peak[i]));
+        if (write(STDERR_FILENO, line, (size_t)length) < 0) {}
+    }
+    exit(EXIT_MEMORY);
+}
+
+// Conta size bytes em subsystem; falha antes de passar de --max-memory
+void memory_charge(MemorySubsystem subsystem, size_t size) {
+    uint64_t total = atomic_fetch_add_explicit(&memory_total, size, memory_order_relaxed) + size;
+    if (options.max_memory != 0 && total > options.max_memory &&
+        !atomic_load_explicit(&memory_failing, memory_order_relaxed)) {
+        atomic_fetch_sub_explicit(&memory_total, size, memory_order_relaxed);
+        memory_exhausted(subsystem, size, true);
+    }
+    uint64_t used = atomic_fetch_add_explicit(&memory_used[subsystem], size, memory_order_relaxed) + size;
+    memory_raise_peak(&memory_peak[subsystem], used);
+    memory_raise_peak(&memory_total_peak, total);
+}
+
+void memory_release(MemorySubsystem subsystem, size_t size) {
+    atomic_fetch_sub_explicit(&memory_used[subsystem], size, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&memory_total, size, memory_order_relaxed);
+}
+
+// realloc contabilizado: data tinha old_size bytes e passa a ter new_size
+void* mem_realloc(MemorySubsystem subsystem, void* data, size_t old_size, size_t new_size) {
+    if (new_size > old_size) memory_charge(subsystem, new_size - old_size);
+    void* result = realloc(data, new_size);
+    if (result == NULL && new_size > 0) memory_exhausted(subsystem, new_size, false);
+    if (new_size < old_size) memory_release(subsystem, old_size - new_size);
+    return result;
+}
+
+void* mem_calloc(MemorySubsystem subsystem, size_t count, size_t size) {
+    memory_charge(subsystem, count * size);
+    void* result = calloc(count, size);
+    if (result == NULL && count * size > 0) memory_exhausted(subsystem, count * size, false);
+    return result;
+}
+
+void mem_free(MemorySubsystem subsystem, void* data, size_t size) {
+    if (data == NULL) return;
+    free(data);
+    memory_release(subsystem, size);
+}
+
+Token next_token(void);
 void TokenHouse(TokenType tipo_esperado);
 void SyntacticError(const char* mensagem);
+void trace_text(const char* text, size_t length);
 void EndFile();
-void ShowError();
-
-void Program();
-void Block();
-void PartVariableDeclarations();
-void VariableDeclararion();
-void ListIdentifiers();
-void Type();
-void CompoundCommand();
-void Command();
-void Assignment();
-void AdditionalCommand();
-void RepetitiveCommand();
-void Expression();
-void Relation();
-void SimpleExpression();
-void Term();
-void Factor();
-void Variable();
+void ShowError(OutputBuffer* out);
 
 const char* token_type_to_string(TokenType type) {
     switch (type) {
@@ -152,8 +791,471 @@ const char* token_type_to_string(TokenType type) {
     }
 }
 
-void init_symbol_table(SymbolTable* table) {
+// Nomes dos tokens ja alinhados em TOKEN_NAME_WIDTH colunas ("%-15s")
+void init_token_name_columns(void) {
+    for (int type = 0; type <= TOK_ERROR; type++) {
+        const char* name = token_type_to_string(type);
+        size_t length = strlen(name);
+        memset(token_name_columns[type], ' ', TOKEN_NAME_WIDTH);
+        memcpy(token_name_columns[type], name, length);
+        token_name_columns[type][TOKEN_NAME_WIDTH] = '\0';
+    }
+}
+
+void out_init(OutputBuffer* out, int fd) {
+    out->fd = fd;
+    out->length = 0;
+    out->capacity = fd == OUT_MEMORY ? 4096 : OUTPUT_BUFFER_SIZE;
+    out->data = mem_alloc(MEMORY_OUTPUT, out->capacity);
+    out->capture = NULL;
+}
+
+void out_free(OutputBuffer* out) {
+    mem_free(MEMORY_OUTPUT, out->data, out->capacity);
+    out->data = NULL;
+    out->length = out->capacity = 0;
+}
+
+static void out_reserve(OutputBuffer* out, size_t length) {
+    size_t old_capacity = out->capacity;
+    while (out->length + length > out->capacity) out->capacity *= 2;
+    out->data = mem_realloc(MEMORY_OUTPUT, out->data, old_capacity, out->capacity);
+}
+
+static double monotonic_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void write_all(int fd, struct iovec* iov, int count) {
+    double start = options.stats ? monotonic_seconds() : 0;
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        stats.bytes_written += (uint64_t)written;
+        while (count > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+    if (options.stats) stats.phase_seconds[STATS_PHASE_OUTPUT] += monotonic_seconds() - start;
+}
+
+// Copia do terminal para o transcript do cache. Passando de --cache-max a
+// entrada nao seria guardada: a copia para (capture NULL) e a memoria volta
+static void out_capture(OutputBuffer* out, const char* text, size_t length) {
+    if (out->capture == NULL) return;
+    if (out->capture->length + length > options.cache_max_bytes) {
+        out_free(out->capture);
+        out->capture = NULL;
+        return;
+    }
+    out_write(out->capture, text, length);
+}
+
+void out_flush(OutputBuffer* out) {
+    if (out->length == 0 || out->fd == OUT_MEMORY) return;
+    out_capture(out, out->data, out->length);
+    struct iovec iov = { out->data, out->length };
+    write_all(out->fd, &iov, 1);
+    out->length = 0;
+}
+
+void out_write(OutputBuffer* out, const char* text, size_t length) {
+    if (out->length + length > out->capacity && out->fd == OUT_MEMORY) {
+        out_reserve(out, length);
+    }
+    if (out->length + length <= out->capacity) {
+        memcpy(out->data + out->length, text, length);
+        out->length += length;
+        return;
+    }
+    // Buffer cheio: descarrega o buffer e o texto novo em uma unica chamada
+    out_capture(out, out->data, out->length);
+    out_capture(out, text, length);
+    struct iovec iov[2] = {
+        { out->data, out->length },
+        { (void*)text, length }
+    };
+    write_all(out->fd, iov, 2);
+    out->length = 0;
+}
+
+void out_str(OutputBuffer* out, const char* text) {
+    out_write(out, text, strlen(text));
+}
+
+void out_char(OutputBuffer* out, char c) {
+    if (out->length == out->capacity) {
+        if (out->fd == OUT_MEMORY) out_reserve(out, 1);
+        else out_flush(out);
+    }
+    out->data[out->length++] = c;
+}
+
+static size_t format_int(char* digits, long long value) {
+    char reversed[24];
+    size_t count = 0;
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    
+    do {
+        reversed[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    
+    size_t length = 0;
+    if (value < 0) digits[length++] = '-';
+    while (count > 0) digits[length++] = reversed[--count];
+    return length;
+}
+
+void out_int(OutputBuffer* out, long long value) {
+    char digits[24];
+    out_write(out, digits, format_int(digits, value));
+}
+
+// Equivalente a "%-Ns": alinha a esquerda sem truncar
+void out_padded(OutputBuffer* out, const char* text, size_t length, size_t width) {
+    static const char spaces[] = "                                ";
+    out_write(out, text, length);
+    while (length < width) {
+        size_t fill = width - length;
+        if (fill > sizeof(spaces) - 1) fill = sizeof(spaces) - 1;
+        out_write(out, spaces, fill);
+        length += fill;
+    }
+}
+
+void out_int_padded(OutputBuffer* out, long long value, int width) {
+    char digits[24];
+    out_padded(out, digits, format_int(digits, value), (size_t)width);
+}
+
+// LEB128: 7 bits por byte, bit alto indica continuacao
+void out_varint(OutputBuffer* out, uint64_t value) {
+    char bytes[10];
+    size_t length = 0;
+    while (value >= 0x80) {
+        bytes[length++] = (char)(value | 0x80);
+        value >>= 7;
+    }
+    bytes[length++] = (char)value;
+    out_write(out, bytes, length);
+}
+
+// Total de bytes escritos ate aqui (so faz sentido com capture ou OUT_MEMORY)
+size_t out_position(OutputBuffer* out) {
+    return (out->capture != NULL ? out->capture->length : 0) + out->length;
+}
+
+char* read_file(const char* filename, size_t* size) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+    
+    size_t capacity = 65536, length = 0;
+    char* data = mem_alloc(MEMORY_SOURCE, capacity);
+    for (;;) {
+        if (length == capacity) {
+            capacity *= 2;
+            data = mem_realloc(MEMORY_SOURCE, data, capacity / 2, capacity);
+        }
+        ssize_t count = read(fd, data + length, capacity - length);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) {
+            mem_free(MEMORY_SOURCE, data, capacity);
+            close(fd);
+            return NULL;
+        }
+        if (count == 0) break;
+        length += (size_t)count;
+        stats.bytes_read += (uint64_t)count;
+    }
+    close(fd);
+    *size = length;
+    // Fica com o tamanho exato (+1) para free_file saber quanto descontar
+    return mem_realloc(MEMORY_SOURCE, data, capacity, length + 1);
+}
+
+// Libera o que read_file devolveu
+void free_file(char* data, size_t size) {
+    mem_free(MEMORY_SOURCE, data, size + 1);
+}
+
+// Nome de arquivo de saida: fonte + sufixo. false se nao couber, para um
+// nome truncado nunca voltar a ser o do proprio fonte
+bool output_name(char* name, size_t size, const char* source_filename, const char* suffix) {
+    int length = snprintf(name, size, "%s%s", source_filename, suffix);
+    return length >= 0 && (size_t)length < size;
+}
+
+int write_file(const char* filename, const char* data, size_t size) {
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) return -1;
+    struct iovec iov = { (void*)data, size };
+    write_all(fd, &iov, 1);
+    return close(fd);
+}
+
+// XXH64
+#define HASH_PRIME1 11400714785074694791ULL
+#define HASH_PRIME2 14029467366897019727ULL
+#define HASH_PRIME3 1609587929392839161ULL
+#define HASH_PRIME4 9650029242287828579ULL
+#define HASH_PRIME5 2870177450012600261ULL
+
+static inline uint64_t rotate_left(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t read_u64(const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t hash_round(uint64_t accumulator, uint64_t input) {
+    accumulator += input * HASH_PRIME2;
+    return rotate_left(accumulator, 31) * HASH_PRIME1;
+}
+
+static inline uint64_t hash_merge(uint64_t accumulator, uint64_t value) {
+    accumulator ^= hash_round(0, value);
+    return accumulator * HASH_PRIME1 + HASH_PRIME4;
+}
+
+uint64_t hash_bytes(const void* data, size_t length, uint64_t seed) {
+    const uint8_t* p = data;
+    const uint8_t* end = p + length;
+    uint64_t hash;
+    
+    if (length >= 32) {
+        uint64_t v1 = seed + HASH_PRIME1 + HASH_PRIME2;
+        uint64_t v2 = seed + HASH_PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - HASH_PRIME1;
+        do {
+            v1 = hash_round(v1, read_u64(p));
+            v2 = hash_round(v2, read_u64(p + 8));
+            v3 = hash_round(v3, read_u64(p + 16));
+            v4 = hash_round(v4, read_u64(p + 24));
+            p += 32;
+        } while (p + 32 <= end);
+        hash = rotate_left(v1, 1) + rotate_left(v2, 7) + rotate_left(v3, 12) + rotate_left(v4, 18);
+        hash = hash_merge(hash, v1);
+        hash = hash_merge(hash, v2);
+        hash = hash_merge(hash, v3);
+        hash = hash_merge(hash, v4);
+    } else {
+        hash = seed + HASH_PRIME5;
+    }
+    hash += (uint64_t)length;
+    
+    for (; p + 8 <= end; p += 8) {
+        hash ^= hash_round(0, read_u64(p));
+        hash = rotate_left(hash, 27) * HASH_PRIME1 + HASH_PRIME4;
+    }
+    if (p + 4 <= end) {
+        uint32_t word;
+        memcpy(&word, p, sizeof(word));
+        hash ^= (uint64_t)word * HASH_PRIME1;
+        hash = rotate_left(hash, 23) * HASH_PRIME2 + HASH_PRIME3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        hash ^= (*p) * HASH_PRIME5;
+        hash = rotate_left(hash, 11) * HASH_PRIME1;
+    }
+    
+    hash ^= hash >> 33;
+    hash *= HASH_PRIME2;
+    hash ^= hash >> 29;
+    hash *= HASH_PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+void write_lex_header(OutputBuffer* out) {
+    out_literal(out, "\t\t=== TOKENS RECONHECIDOS ===\n");
+    out_literal(out, "TOKEN           LEXEMA             LINHA    COLUNA  \n");
+    out_literal(out, "--------------------------------------------------\n");
+}
+
+void write_lex_entry(OutputBuffer* out, TokenType type, const char* lexeme, int64_t line, int64_t column) {
+    if (type == TOK_ERROR) {
+        out_literal(out, "ERRO (Linha ");
+        out_int(out, line);
+        out_literal(out, ", Coluna ");
+        out_int(out, column);
+        out_literal(out, "): ");
+        out_str(out, lexeme);
+        out_char(out, '\n');
+        return;
+    }
+    out_write(out, token_name_columns[type], TOKEN_NAME_WIDTH);
+    out_char(out, ' ');
+    out_padded(out, lexeme, strlen(lexeme), 20);
+    out_char(out, ' ');
+    out_int_padded(out, line, 8);
+    out_char(out, ' ');
+    out_int_padded(out, column, 8);
+    out_char(out, '\n');
+}
+
+void write_console_entry(OutputBuffer* out, TokenType type, const char* lexeme, int64_t line, int64_t column) {
+    if (type == TOK_ERROR) {
+        out_literal(out, "\033[1;31mERRO\033[0m (Linha ");
+        out_int(out, line);
+        out_literal(out, ", Coluna ");
+        out_int(out, column);
+        out_literal(out, "): ");
+        out_str(out, lexeme);
+        out_char(out, '\n');
+        return;
+    }
+    out_literal(out, "\033[1;33m");
+    out_write(out, token_name_columns[type], TOKEN_NAME_WIDTH);
+    out_literal(out, "\033[0m ");
+    out_padded(out, lexeme, strlen(lexeme), 20);
+    out_char(out, ' ');
+    out_int_padded(out, line, 8);
+    out_char(out, ' ');
+    out_int_padded(out, column, 8);
+    out_char(out, '\n');
+}
+
+static uint32_t hash_string(const char* text, size_t length);
+
+static void* name_chunk_alloc(NameChunk** chunks, size_t size) {
+    size = (size + 7) & ~(size_t)7;
+    NameChunk* chunk = *chunks;
+    if (chunk == NULL || chunk->used + size > chunk->size) {
+        size_t chunk_size = size > NAME_CHUNK_SIZE ? size : NAME_CHUNK_SIZE;
+        NameChunk* fresh = mem_alloc(MEMORY_SYMBOLS, sizeof(NameChunk) + chunk_size);
+        fresh->previous = chunk;
+        fresh->size = chunk_size;
+        fresh->used = 0;
+        *chunks = chunk = fresh;
+    }
+    void* result = chunk->data + chunk->used;
+    chunk->used += size;
+    return result;
+}
+
+static void free_name_chunks(NameChunk** chunks) {
+    while (*chunks != NULL) {
+        NameChunk* previous = (*chunks)->previous;
+        mem_free(MEMORY_SYMBOLS, *chunks, sizeof(NameChunk) + (*chunks)->size);
+        *chunks = previous;
+    }
+}
+
+static InternerSlots* new_interner_slots(uint32_t slot_count) {
+    InternerSlots* table = mem_calloc(MEMORY_SYMBOLS, 1, sizeof(InternerSlots) + slot_count * sizeof(table->slots[0]));
+    table->mask = slot_count - 1;
+    return table;
+}
+
+void init_interner(Interner* interner) {
+    memset(interner, 0, sizeof(*interner));
+    for (int i = 0; i < INTERNER_SHARDS; i++) {
+        atomic_init(&interner->shards[i].table, new_interner_slots(INTERNER_SHARD_INITIAL));
+        pthread_mutex_init(&interner->shards[i].lock, NULL);
+    }
+}
+
+void free_interner(Interner* interner) {
+    for (int i = 0; i < INTERNER_SHARDS; i++) {
+        InternerShard* shard = &interner->shards[i];
+        InternerSlots* table = atomic_load(&shard->table);
+        while (table != NULL) {
+            InternerSlots* retired = table->retired;
+            mem_free(MEMORY_SYMBOLS, table, sizeof(InternerSlots) + ((size_t)table->mask + 1) * sizeof(table->slots[0]));
+            table = retired;
+        }
+        free_name_chunks(&shard->names);
+        pthread_mutex_destroy(&shard->lock);
+    }
+    memset(interner, 0, sizeof(*interner));
+}
+
+// O nome, ou NULL com *position no slot vazio onde ele entraria
+static const InternedName* interner_probe(InternerSlots* table, const char* name, uint32_t length, uint32_t hash,
+                                          uint32_t* position) {
+    uint32_t slot = hash & table->mask;
+    for (;;) {
+        const InternedName* entry = atomic_load_explicit(&table->slots[slot], memory_order_acquire);
+        if (entry == NULL) {
+            *position = slot;
+            return NULL;
+        }
+        if (entry->hash == hash && entry->length == length && memcmp(entry->name, name, length) == 0) return entry;
+        slot = (slot + 1) & table->mask;
+    }
+}
+
+// Chamado com a trava da parte: copia para uma tabela com o dobro de slots
+// e publica; os leitores passam a ver a nova na proxima busca
+static void grow_interner_shard(InternerShard* shard) {
+    InternerSlots* old = atomic_load_explicit(&shard->table, memory_order_relaxed);
+    InternerSlots* table = new_interner_slots((old->mask + 1) * 2);
+    for (uint32_t i = 0; i <= old->mask; i++) {
+        const InternedName* entry = atomic_load_explicit(&old->slots[i], memory_order_relaxed);
+        if (entry == NULL) continue;
+        uint32_t slot = entry->hash & table->mask;
+        while (atomic_load_explicit(&table->slots[slot], memory_order_relaxed) != NULL) slot = (slot + 1) & table->mask;
+        atomic_store_explicit(&table->slots[slot], entry, memory_order_relaxed);
+    }
+    table->retired = old;
+    atomic_store_explicit(&shard->table, table, memory_order_release);
+}
+
+const InternedName* intern_name(Interner* interner, const char* name, uint32_t length, uint32_t hash) {
+    InternerShard* shard = &interner->shards[hash >> (32 - INTERNER_SHARD_BITS)];
+    uint32_t slot;
+    const InternedName* entry = interner_probe(atomic_load_explicit(&shard->table, memory_order_acquire), name, length, hash, &slot);
+    if (entry != NULL) return entry;
+
+    if (pthread_mutex_trylock(&shard->lock) != 0) {
+        atomic_fetch_add_explicit(&interner->lock_waits, 1, memory_order_relaxed);
+        pthread_mutex_lock(&shard->lock);
+    }
+    // Outra thread pode ter inserido (ou crescido a tabela) antes da trava
+    InternerSlots* table = atomic_load_explicit(&shard->table, memory_order_relaxed);
+    entry = interner_probe(table, name, length, hash, &slot);
+    if (entry == NULL) {
+        InternedName* fresh = name_chunk_alloc(&shard->names, sizeof(InternedName) + length + 1);
+        fresh->hash = hash;
+        fresh->length = length;
+        memcpy(fresh->name, name, length);
+        fresh->name[length] = '\0';
+        atomic_store_explicit(&table->slots[slot], fresh, memory_order_release);
+        entry = fresh;
+        atomic_fetch_add_explicit(&interner->count, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&interner->bytes, length + 1, memory_order_relaxed);
+        if (++shard->count * 2 > table->mask) grow_interner_shard(shard);
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return entry;
+}
+
+// interner NULL: a tabela guarda os proprios nomes
+void init_symbol_table(SymbolTable* table, Interner* interner) {
     table->count = 0;
+    table->capacity = SYMBOL_TABLE_INITIAL;
+    table->symbols = mem_alloc(MEMORY_SYMBOLS, table->capacity * sizeof(Symbol));
+    table->slot_mask = SYMBOL_TABLE_INITIAL * 2 - 1;
+    table->slots = mem_calloc(MEMORY_SYMBOLS, table->slot_mask + 1, sizeof(uint32_t));
+    table->names = NULL;
+    table->interner = interner;
     insert_symbol(table, "program", TOK_PROGRAM);
     insert_symbol(table, "var", TOK_VAR);
     insert_symbol(table, "integer", TOK_INTEGER);
@@ -168,55 +1270,99 @@ void init_symbol_table(SymbolTable* table) {
     insert_symbol(table, "mod", OP_MOD);
 }
 
-int insert_symbol(SymbolTable* table, const char* name, TokenType type) {
+// Os nomes no interner compartilhado ficam; so os da propria tabela saem
+void free_symbol_table(SymbolTable* table) {
+    mem_free(MEMORY_SYMBOLS, table->symbols, (size_t)table->capacity * sizeof(Symbol));
+    mem_free(MEMORY_SYMBOLS, table->slots, ((size_t)table->slot_mask + 1) * sizeof(uint32_t));
+    free_name_chunks(&table->names);
+    table->symbols = NULL;
+    table->slots = NULL;
+    table->count = table->capacity = 0;
+}
+
+static void grow_symbol_slots(SymbolTable* table) {
+    mem_free(MEMORY_SYMBOLS, table->slots, ((size_t)table->slot_mask + 1) * sizeof(uint32_t));
+    table->slot_mask = table->slot_mask * 2 + 1;
+    table->slots = mem_calloc(MEMORY_SYMBOLS, (size_t)table->slot_mask + 1, sizeof(uint32_t));
     for (int i = 0; i < table->count; i++) {
-        if (strcmp(table->symbols[i].name, name) == 0) {
-            return 0;
-        }
+        uint32_t slot = table->symbols[i].hash & table->slot_mask;
+        while (table->slots[slot] != 0) slot = (slot + 1) & table->slot_mask;
+        table->slots[slot] = (uint32_t)i + 1;
+    }
+}
+
+// Posicao de name no indice: a do simbolo, ou a vazia onde ele entraria.
+// A busca e sempre na propria tabela: nome repetido no arquivo nao chega
+// ao interner compartilhado
+static uint32_t* symbol_slot(SymbolTable* table, const char* name, uint32_t length, uint32_t hash) {
+    uint32_t slot = hash & table->slot_mask;
+    STAT_ADD(symbol_lookups, 1);
+    while (table->slots[slot] != 0) {
+        const Symbol* symbol = &table->symbols[table->slots[slot] - 1];
+        STAT_ADD(symbol_probes, 1);
+        if (symbol->hash == hash && symbol->length == length && memcmp(symbol->name, name, length) == 0) break;
+        STAT_ADD(symbol_collisions, 1);
+        slot = (slot + 1) & table->slot_mask;
+    }
+    return &table->slots[slot];
+}
+
+// 1 se inseriu, 0 se ja existia
+int insert_symbol(SymbolTable* table, const char* name, TokenType type) {
+    uint32_t length = (uint32_t)strlen(name);
+    uint32_t hash = hash_string(name, length);
+    uint32_t* slot = symbol_slot(table, name, length, hash);
+    if (*slot != 0) return 0;
+    
+    if (table->count == table->capacity) {
+        table->capacity *= 2;
+        table->symbols = mem_realloc(MEMORY_SYMBOLS, table->symbols, (size_t)table->capacity / 2 * sizeof(Symbol),
+                                     (size_t)table->capacity * sizeof(Symbol));
+    }
+    Symbol* symbol = &table->symbols[table->count];
+    if (table->interner != NULL) {
+        symbol->name = intern_name(table->interner, name, length, hash)->name;
+    } else {
+        char* copy = name_chunk_alloc(&table->names, length + 1);
+        memcpy(copy, name, length + 1);
+        symbol->name = copy;
     }
+    symbol->length = length;
+    symbol->hash = hash;
+    symbol->type = type;
+    *slot = (uint32_t)++table->count;
     
-    if (table->count < MAX_SYMBOLS) {
-        strcpy(table->symbols[table->count].name, name);
-        table->symbols[table->count].type = type;
-        table->count++;
-        return 1;
-    }  
-    return -1; 
+    if ((uint32_t)table->count * 2 > table->slot_mask) grow_symbol_slots(table);
+    return 1;
 }
 
 Symbol* find_symbol(SymbolTable* table, const char* name) {
-    for (int i = 0; i < table->count; i++) {
-        if (strcmp(table->symbols[i].name, name) == 0) {
-            return &table->symbols[i];
-        }
-    }
-    return NULL;
+    uint32_t length = (uint32_t)strlen(name);
+    uint32_t* slot = symbol_slot(table, name, length, hash_string(name, length));
+    return *slot != 0 ? &table->symbols[*slot - 1] : NULL;
 }
 
-void print_symbol_table(SymbolTable* table) {
-    printf("\n=== TABELA DE SIMBOLOS ===\n");
-    printf("%-20s %-15s\n", "Nome", "Tipo");
-    printf("--------------------------------\n");
+void print_symbol_table(OutputBuffer* out, SymbolTable* table) {
+    out_literal(out, "\n=== TABELA DE SIMBOLOS ===\n");
+    out_literal(out, "Nome                 Tipo           \n");
+    out_literal(out, "--------------------------------\n");
     
     for (int i = 0; i < table->count; i++) {
-        printf("%-20s ", table->symbols[i].name);
+        out_padded(out, table->symbols[i].name, table->symbols[i].length, 20);
+        out_char(out, ' ');
         
+        const char* type_name;
         switch (table->symbols[i].type) {
-            case TOK_PROGRAM: printf("\033[1;33m%-15s\033[0m", "PROGRAM"); break;
-            case TOK_VAR: printf("\033[1;33m%-15s\033[0m", "VAR"); break;
-            case TOK_INTEGER: printf("\033[1;33m%-15s\033[0m", "INTEGER"); break;
-            case TOK_REAL: printf("\033[1;33m%-15s\033[0m", "REAL"); break;
-            case TOK_BEGIN: printf("\033[1;33m%-15s\033[0m", "BEGIN"); break;
-            case TOK_END: printf("\033[1;33m%-15s\033[0m", "END"); break;
-            case TOK_IF: printf("\033[1;33m%-15s\033[0m", "IF"); break;
-            case TOK_THEN: printf("\033[1;33m%-15s\033[0m", "THEN"); break;
-            case TOK_ELSE: printf("\033[1;33m%-15s\033[0m", "ELSE"); break;
-            case TOK_WHILE: printf("\033[1;33m%-15s\033[0m", "WHILE"); break;
-            case TOK_DO: printf("\033[1;33m%-15s\033[0m", "DO"); break;
-            case ID: printf("\033[1;33m%-15s\033[0m", "ID"); break;
-            default: printf("\033[1;33m%-15s\033[0m", "UNKNOWN"); break;
+            case TOK_PROGRAM: case TOK_VAR: case TOK_INTEGER: case TOK_REAL:
+            case TOK_BEGIN: case TOK_END: case TOK_IF: case TOK_THEN:
+            case TOK_ELSE: case TOK_WHILE: case TOK_DO: case ID:
+                type_name = token_name_columns[table->symbols[i].type];
+                break;
+            default: type_name = "UNKNOWN        "; break;
         }
-        printf("\n");
+        out_literal(out, "\033[1;33m");
+        out_write(out, type_name, TOKEN_NAME_WIDTH);
+        out_literal(out, "\033[0m\n");
     }
 }
 
@@ -251,8 +1397,8 @@ bool is_valid_operator_combination(char current, char next) {
 }
 
 void handle_unclosed_comment(Lexer* lexer, Token* token) {
-    int start_line = lexer->line;
-    int start_column = lexer->column;
+    int64_t start_line = lexer->line;
+    int64_t start_column = lexer->column;
     
     while (lexer->current_char != EOF && lexer->current_char != '}') {
         if (lexer->current_char == '\n') {
@@ -261,52 +1407,91 @@ void handle_unclosed_comment(Lexer* lexer, Token* token) {
         } else {
             lexer->column++;
         }
-        lexer->current_char = fgetc(lexer->file);
+        lexer->current_char = read_char(lexer);
     }
     
     if (lexer->current_char == '}') {
         token->type = TOK_ERROR;
         sprintf(token->lexeme, "Conteudo entre { } nao permitido (comentarios nao suportados)");
-        lexer->current_char = fgetc(lexer->file);
+        lexer->current_char = read_char(lexer);
         lexer->column++;
     } else {
 
         token->type = TOK_ERROR;
-        sprintf(token->lexeme, "Comentario nao fechado iniciado na linha %d, coluna %d", 
-                start_line, start_column);
+        sprintf(token->lexeme, "Comentario nao fechado iniciado na linha %lld, coluna %lld", 
+                (long long)start_line, (long long)start_column);
     }
 }
 
-Lexer* init_lexer(FILE* file, const char* filename) {
-    Lexer* lexer = malloc(sizeof(Lexer));
-    lexer->file = file;
-    lexer->current_char = fgetc(file);
+Lexer* init_lexer(int fd, const char* filename, Interner* interner) {
+    Lexer* lexer = mem_alloc(MEMORY_SOURCE, sizeof(Lexer));
+    struct stat info;
+    lexer->fd = fd;
+    lexer->seekable = fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
+    lexer->buffer = mem_alloc(MEMORY_SOURCE, LEXER_HISTORY + LEXER_READ_SIZE);
+    lexer->length = 0;
+    lexer->position = 0;
+    lexer->buffer_offset = 0;
+    lexer->at_end = false;
+    lexer->current_char = read_char(lexer);
     lexer->line = 1;
     lexer->column = 1;
-    lexer->filename = malloc(strlen(filename) + 1);
+    lexer->filename = mem_alloc(MEMORY_SOURCE, strlen(filename) + 1);
     strcpy(lexer->filename, filename);
-    init_symbol_table(&lexer->symbol_table);
+    init_symbol_table(&lexer->symbol_table, interner);
     return lexer;
 }
 
 void free_lexer(Lexer* lexer) {
-    fclose(lexer->file);
-    free(lexer->filename);
-    free(lexer);
+    close(lexer->fd);
+    free_symbol_table(&lexer->symbol_table);
+    mem_free(MEMORY_SOURCE, lexer->buffer, LEXER_HISTORY + LEXER_READ_SIZE);
+    mem_free(MEMORY_SOURCE, lexer->filename, strlen(lexer->filename) + 1);
+    mem_free(MEMORY_SOURCE, lexer, sizeof(Lexer));
 }
 
-char peek_char(Lexer* lexer) {
-    if (feof(lexer->file)) return '\0';
+// Le mais um bloco, descartando o que ja foi consumido alem do historico
+static bool fill_buffer(Lexer* lexer) {
+    if (lexer->at_end) return false;
+    
+    if (lexer->position > LEXER_HISTORY) {
+        size_t discard = lexer->position - LEXER_HISTORY;
+        memmove(lexer->buffer, lexer->buffer + discard, lexer->length - discard);
+        lexer->length -= discard;
+        lexer->position -= discard;
+        lexer->buffer_offset += discard;
+    }
+    
+    size_t room = LEXER_HISTORY + LEXER_READ_SIZE - lexer->length;
+    if (room == 0) return false;
     
-    long current_pos = ftell(lexer->file);
-    char next_char = fgetc(lexer->file);
-    fseek(lexer->file, current_pos, SEEK_SET);
+    ssize_t count;
+    do {
+        count = read(lexer->fd, lexer->buffer + lexer->length, room);
+    } while (count < 0 && errno == EINTR);
     
-    return next_char;
+    if (count <= 0) {
+        lexer->at_end = true;
+        return false;
+    }
+    lexer->length += (size_t)count;
+    stats.bytes_read += (uint64_t)count;
+    return true;
 }
 
-void skip_whitespace(Lexer* lexer) {
-    while (lexer->current_char != EOF && 
+int read_char(Lexer* lexer) {
+    if (lexer->position == lexer->length && !fill_buffer(lexer)) return EOF;
+    return lexer->buffer[lexer->position++];
+}
+
+int peek_char(Lexer* lexer) {
+    STAT_ADD(peek_calls, 1);
+    if (lexer->position == lexer->length && !fill_buffer(lexer)) return EOF;
+    return lexer->buffer[lexer->position];
+}
+
+void skip_whitespace(Lexer* lexer) {
+    while (lexer->current_char != EOF && 
            (lexer->current_char == ' ' || 
             lexer->current_char == '\t' || 
             lexer->current_char == '\n')) {
@@ -318,8 +1503,81 @@ void skip_whitespace(Lexer* lexer) {
             lexer->column++;
         }
         
-        lexer->current_char = fgetc(lexer->file);
+        lexer->current_char = read_char(lexer);
+    }
+}
+
+// Literais numericos: o lexer acumula ate 19 digitos significativos num
+// uint64 enquanto copia o lexema. Inteiros sao exatos (mais de 19 digitos
+// ou acima de 2^63 - 1 e erro lexico). Reais usam a divisao/multiplicacao
+// exata por 10^q quando os dois operandos cabem no double (Clinger) e, fora
+// disso, Eisel-Lemire com a tabela de potencias de 5 em 128 bits; os casos
+// que o algoritmo nao decide (empate exato, subnormal, estouro, mais de 19
+// digitos) caem no strtod do lexema. --literais-strtod converte tudo com
+// strtoll/strtod, para comparar no benchmark.
+#define LITERAL_DIGITS 19
+#include "tabela_pot5.h"
+
+static const double exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// digits * 10^exponent com digits != 0 e exponent dentro da tabela; false
+// quando os bits do produto nao bastam para arredondar com certeza
+static bool eisel_lemire(uint64_t digits, int64_t exponent, bool negative, double* result) {
+    int shift = __builtin_clzll(digits);
+    uint64_t w = digits << shift;
+    const uint64_t* power = &pow5_128[2 * (exponent - POW5_MIN_EXPONENT)];
+
+    unsigned __int128 product = (unsigned __int128)w * power[0];
+    uint64_t upper = (uint64_t)(product >> 64), lower = (uint64_t)product;
+    // Os 9 bits abaixo da mantissa todos ligados: a parte baixa da potencia
+    // ainda pode mudar o arredondamento
+    if ((upper & 0x1FF) == 0x1FF) {
+        unsigned __int128 second = (unsigned __int128)w * power[1];
+        uint64_t carry = (uint64_t)(second >> 64);
+        lower += carry;
+        if (carry > lower) upper++;
+        if ((upper & 0x1FF) == 0x1FF && (lower + w < lower || lower == UINT64_MAX)) return false;
+    }
+
+    uint64_t upper_bit = upper >> 63;
+    uint64_t mantissa = upper >> (upper_bit + 9);
+    shift += (int)(1 ^ upper_bit);
+    // Exatamente no meio de dois doubles: o desempate fica com o strtod
+    if (lower == 0 && (upper & 0x1FF) == 0 && (mantissa & 3) == 1) return false;
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (1ULL << 53)) {
+        mantissa = 1ULL << 52;
+        shift--;
+    }
+    mantissa &= ~(1ULL << 52);
+
+    // floor(exponent * log2(10)) + bias + 63
+    int64_t binary_exponent = (((152170 + 65536) * exponent) >> 16) + 1024 + 63 - shift;
+    if (binary_exponent < 1 || binary_exponent > 2046) return false;
+    uint64_t bits = mantissa | (uint64_t)binary_exponent << 52 | (uint64_t)negative << 63;
+    memcpy(result, &bits, sizeof(bits));
+    return true;
+}
+
+static double literal_real(uint64_t digits, int64_t exponent, bool negative, int significant, const char* lexeme) {
+    double value;
+    if (significant > LITERAL_DIGITS) return strtod(lexeme, NULL);
+    if (digits == 0) return negative ? -0.0 : 0.0;
+    if (digits <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+        value = (double)digits;
+        value = exponent < 0 ? value / exact_powers_of_ten[-exponent] : value * exact_powers_of_ten[exponent];
+        return negative ? -value : value;
     }
+    // Com no maximo 19 digitos, abaixo de 10^-342 arredonda para zero e
+    // acima de 10^308 estoura
+    if (exponent < POW5_MIN_EXPONENT) return negative ? -0.0 : 0.0;
+    if (exponent > POW5_MAX_EXPONENT) return negative ? -INFINITY : INFINITY;
+    if (eisel_lemire(digits, exponent, negative, &value)) return value;
+    return strtod(lexeme, NULL);
 }
 
 Token get_next_token(Lexer* lexer) {
@@ -340,12 +1598,12 @@ Token get_next_token(Lexer* lexer) {
         int i = 0;
 
         token.lexeme[i++] = tolower(lexer->current_char);
-        lexer->current_char = fgetc(lexer->file);
+        lexer->current_char = read_char(lexer);
         lexer->column++;
         
         while ((isalnum(lexer->current_char) || lexer->current_char == '_') && i < MAX_LEXEME - 1) {
             token.lexeme[i++] = tolower(lexer->current_char);
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
         }
         token.lexeme[i] = '\0';
@@ -376,28 +1634,50 @@ Token get_next_token(Lexer* lexer) {
         int i = 0;
         int is_real = 0;
         int has_exponent = 0;
-        
+        bool negative = false;
+        uint64_t digits = 0;
+        int significant = 0;
+        int64_t exponent = 0;
+
         if (lexer->current_char == '+' || lexer->current_char == '-') {
+            negative = lexer->current_char == '-';
             token.lexeme[i++] = lexer->current_char;
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
         }
         
+        // Zeros a esquerda nao contam; digitos alem do 19o so deslocam o expoente
         while (isdigit(lexer->current_char) && i < MAX_LEXEME - 1) {
+            int digit = lexer->current_char - '0';
+            if (significant < LITERAL_DIGITS) {
+                digits = digits * 10 + (uint64_t)digit;
+                if (digits != 0) significant++;
+            } else {
+                significant++;
+                exponent++;
+            }
             token.lexeme[i++] = lexer->current_char;
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
         }
         
         if (lexer->current_char == '.') {
             is_real = 1;
             token.lexeme[i++] = lexer->current_char;
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
             
             while (isdigit(lexer->current_char) && i < MAX_LEXEME - 1) {
+                int digit = lexer->current_char - '0';
+                if (significant < LITERAL_DIGITS) {
+                    digits = digits * 10 + (uint64_t)digit;
+                    if (digits != 0) significant++;
+                    exponent--;
+                } else {
+                    significant++;
+                }
                 token.lexeme[i++] = lexer->current_char;
-                lexer->current_char = fgetc(lexer->file);
+                lexer->current_char = read_char(lexer);
                 lexer->column++;
             }
         }
@@ -405,21 +1685,28 @@ Token get_next_token(Lexer* lexer) {
         if (lexer->current_char == 'E' || lexer->current_char == 'e') {
             is_real = 1;
             has_exponent = 1;
+            bool exponent_negative = false;
+            int64_t written = 0;
             token.lexeme[i++] = 'E';
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
             
             if (lexer->current_char == '+' || lexer->current_char == '-') {
+                exponent_negative = lexer->current_char == '-';
                 token.lexeme[i++] = lexer->current_char;
-                lexer->current_char = fgetc(lexer->file);
+                lexer->current_char = read_char(lexer);
                 lexer->column++;
             }
             
+            // O lexema limita os digitos, entao o expoente escrito nao estoura
             while (isdigit(lexer->current_char) && i < MAX_LEXEME - 1) {
+                written = written * 10 + (lexer->current_char - '0');
+                if (written > 100000000) written = 100000000;
                 token.lexeme[i++] = lexer->current_char;
-                lexer->current_char = fgetc(lexer->file);
+                lexer->current_char = read_char(lexer);
                 lexer->column++;
             }
+            exponent += exponent_negative ? -written : written;
         }
         
         token.lexeme[i] = '\0';
@@ -431,6 +1718,30 @@ Token get_next_token(Lexer* lexer) {
         } else {
             token.type = LIT_INT;
         }
+
+        if (options.literals_strtod) {
+            if (is_real) {
+                token.real = strtod(token.lexeme, NULL);
+            } else {
+                errno = 0;
+                token.integer = strtoll(token.lexeme, NULL, 10);
+                if (errno == ERANGE) significant = LITERAL_DIGITS + 1;
+            }
+        } else if (is_real) {
+            token.real = literal_real(digits, exponent, negative, significant, token.lexeme);
+        } else if (significant <= LITERAL_DIGITS && digits <= (uint64_t)INT64_MAX + negative) {
+            // -(digits - 1) - 1 tambem vale para -2^63
+            token.integer = negative && digits > 0 ? -(int64_t)(digits - 1) - 1 : (int64_t)digits;
+        } else {
+            significant = LITERAL_DIGITS + 1;
+        }
+
+        if (!is_real && significant > LITERAL_DIGITS) {
+            char text[MAX_LEXEME];
+            memcpy(text, token.lexeme, (size_t)i + 1);
+            token.type = TOK_ERROR;
+            snprintf(token.lexeme, MAX_LEXEME, "Inteiro fora do intervalo de 64 bits: %.50s", text);
+        }
         
         return token;
     }
@@ -442,12 +1753,12 @@ Token get_next_token(Lexer* lexer) {
             token.type = TOK_ERROR;
             if (is_valid_operator_start(next_char)) {
                 sprintf(token.lexeme, "Operador invalido: '%c%c'", lexer->current_char, next_char);
-                lexer->current_char = fgetc(lexer->file);
+                lexer->current_char = read_char(lexer);
                 lexer->column++;
             } else {
                 sprintf(token.lexeme, "Operador invalido: '%c'", lexer->current_char);
             }
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
             return token;
         }
@@ -456,14 +1767,14 @@ Token get_next_token(Lexer* lexer) {
     switch (lexer->current_char) {
         case ':':
             token.lexeme[0] = lexer->current_char;
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
             
             if (lexer->current_char == '=') {
                 token.lexeme[1] = '=';
                 token.lexeme[2] = '\0';
                 token.type = OP_ASS;
-                lexer->current_char = fgetc(lexer->file);
+                lexer->current_char = read_char(lexer);
                 lexer->column++;
             } else {
                 token.lexeme[1] = '\0';
@@ -475,7 +1786,7 @@ Token get_next_token(Lexer* lexer) {
             token.lexeme[0] = lexer->current_char;
             token.lexeme[1] = '\0';
             token.type = SMB_DOT;
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
             break;
             
@@ -483,13 +1794,13 @@ Token get_next_token(Lexer* lexer) {
             token.type = TOK_ERROR;
             strcpy(token.lexeme, " O caracter \" nao e permitido");
             while (lexer->current_char != EOF && lexer->current_char != '"' && lexer->current_char != '\n') {
-                lexer->current_char = fgetc(lexer->file);
+                lexer->current_char = read_char(lexer);
                 lexer->column++;
             }
             if (lexer->current_char == '\n') {
                 sprintf(token.lexeme, "String nao fechada antes da quebra de linha");
             } else if (lexer->current_char == '"') {
-                lexer->current_char = fgetc(lexer->file);
+                lexer->current_char = read_char(lexer);
                 lexer->column++;
             }
             break;
@@ -503,26 +1814,26 @@ Token get_next_token(Lexer* lexer) {
             token.lexeme[0] = lexer->current_char;
             token.lexeme[1] = '\0';
             token.type = SMB_OBC;
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
             break;
             
         case '<':
             token.lexeme[0] = lexer->current_char;
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
             
             if (lexer->current_char == '=') {
                 token.lexeme[1] = '=';
                 token.lexeme[2] = '\0';
                 token.type = OP_LE;
-                lexer->current_char = fgetc(lexer->file);
+                lexer->current_char = read_char(lexer);
                 lexer->column++;
             } else if (lexer->current_char == '>') {
                 token.lexeme[1] = '>';
                 token.lexeme[2] = '\0';
                 token.type = OP_NE;
-                lexer->current_char = fgetc(lexer->file);
+                lexer->current_char = read_char(lexer);
                 lexer->column++;
             } else {
                 token.lexeme[1] = '\0';
@@ -532,14 +1843,14 @@ Token get_next_token(Lexer* lexer) {
             
         case '>':
             token.lexeme[0] = lexer->current_char;
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
             
             if (lexer->current_char == '=') {
                 token.lexeme[1] = '=';
                 token.lexeme[2] = '\0';
                 token.type = OP_GE;
-                lexer->current_char = fgetc(lexer->file);
+                lexer->current_char = read_char(lexer);
                 lexer->column++;
             } else {
                 token.lexeme[1] = '\0';
@@ -551,7 +1862,7 @@ Token get_next_token(Lexer* lexer) {
             token.lexeme[0] = lexer->current_char;
             token.lexeme[1] = '\0';
             token.type = OP_EQ;
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
             break;
             
@@ -559,7 +1870,7 @@ Token get_next_token(Lexer* lexer) {
             token.lexeme[0] = lexer->current_char;
             token.lexeme[1] = '\0';
             token.type = OP_AD;
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
             break;
             
@@ -567,7 +1878,7 @@ Token get_next_token(Lexer* lexer) {
             token.lexeme[0] = lexer->current_char;
             token.lexeme[1] = '\0';
             token.type = OP_MIN;
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
             break;
             
@@ -575,7 +1886,7 @@ Token get_next_token(Lexer* lexer) {
             token.lexeme[0] = lexer->current_char;
             token.lexeme[1] = '\0';
             token.type = OP_MUL;
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
             break;
             
@@ -583,7 +1894,7 @@ Token get_next_token(Lexer* lexer) {
             token.lexeme[0] = lexer->current_char;
             token.lexeme[1] = '\0';
             token.type = OP_DIV;
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
             break;
             
@@ -591,7 +1902,7 @@ Token get_next_token(Lexer* lexer) {
             token.lexeme[0] = lexer->current_char;
             token.lexeme[1] = '\0';
             token.type = SMB_CBC;
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
             break;
             
@@ -599,7 +1910,7 @@ Token get_next_token(Lexer* lexer) {
             token.lexeme[0] = lexer->current_char;
             token.lexeme[1] = '\0';
             token.type = SMB_OPA;
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
             break;
             
@@ -607,7 +1918,7 @@ Token get_next_token(Lexer* lexer) {
             token.lexeme[0] = lexer->current_char;
             token.lexeme[1] = '\0';
             token.type = SMB_CPA;
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
             break;
             
@@ -615,7 +1926,7 @@ Token get_next_token(Lexer* lexer) {
             token.lexeme[0] = lexer->current_char;
             token.lexeme[1] = '\0';
             token.type = SMB_COM;
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
             break;
             
@@ -623,28 +1934,28 @@ Token get_next_token(Lexer* lexer) {
             token.lexeme[0] = lexer->current_char;
             token.lexeme[1] = '\0';
             token.type = SMB_SEM;
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
             break;
 
         case '\'': {
-        int start_line = lexer->line;
-        int start_column = lexer->column;
+        int64_t start_line = lexer->line;
+        int64_t start_column = lexer->column;
         int i = 0;
 
         token.lexeme[i++] = '\''; 
 
-        lexer->current_char = fgetc(lexer->file);
+        lexer->current_char = read_char(lexer);
         lexer->column++;
 
         while (lexer->current_char != '\'' && lexer->current_char != EOF && lexer->current_char != '\n') {
             if (i >= MAX_LEXEME - 2) { 
                 token.type = TOK_ERROR;
-                sprintf(token.lexeme, "String muito longa na linha %d, coluna %d", start_line, start_column);
+                sprintf(token.lexeme, "String muito longa na linha %lld, coluna %lld", (long long)start_line, (long long)start_column);
                 return token;
             }
                 token.lexeme[i++] = lexer->current_char;
-                lexer->current_char = fgetc(lexer->file);
+                lexer->current_char = read_char(lexer);
                 lexer->column++;
             }
 
@@ -652,12 +1963,12 @@ Token get_next_token(Lexer* lexer) {
                 token.lexeme[i++] = '\''; 
                 token.lexeme[i] = '\0';
                 token.type = TOK_STRING;
-                lexer->current_char = fgetc(lexer->file); 
+                lexer->current_char = read_char(lexer); 
                 lexer->column++;
             } else {
                 token.lexeme[i] = '\0';
                 token.type = TOK_ERROR;
-                sprintf(token.lexeme, "String nao fechada na linha %d, coluna %d", start_line, start_column);
+                sprintf(token.lexeme, "String nao fechada na linha %lld, coluna %lld", (long long)start_line, (long long)start_column);
                 }
             }
             break;
@@ -665,64 +1976,532 @@ Token get_next_token(Lexer* lexer) {
         default:
             token.type = TOK_ERROR;
             sprintf(token.lexeme, "Caractere desconhecido: '%c'", lexer->current_char);
-            lexer->current_char = fgetc(lexer->file);
+            lexer->current_char = read_char(lexer);
             lexer->column++;
             break;
     }
     return token;
 }
 
+// Espera *counter sair de seen (ou o pedido de parada). waiting e os
+// contadores usam ordem sequencial: se o outro lado nao viu waiting, esta
+// thread ve o contador novo antes de dormir
+static void pipeline_wait(TokenPipeline* pipeline, _Atomic size_t* counter, size_t seen) {
+    for (int i = 0; i < PIPELINE_SPINS; i++) {
+        if (atomic_load_explicit(counter, memory_order_acquire) != seen ||
+            atomic_load_explicit(&pipeline->stop, memory_order_relaxed)) return;
+        sched_yield();
+    }
+    pthread_mutex_lock(&pipeline->lock);
+    atomic_fetch_add(&pipeline->waiting, 1);
+    while (atomic_load(counter) == seen && !atomic_load(&pipeline->stop)) {
+        pthread_cond_wait(&pipeline->changed, &pipeline->lock);
+    }
+    atomic_fetch_sub(&pipeline->waiting, 1);
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+static void pipeline_notify(TokenPipeline* pipeline) {
+    if (atomic_load(&pipeline->waiting) == 0) return;
+    pthread_mutex_lock(&pipeline->lock);
+    pthread_cond_broadcast(&pipeline->changed);
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+static void* pipeline_producer(void* arg) {
+    TokenPipeline* pipeline = arg;
+    size_t head = 0, tail;
+    bool done = false;
+
+    while (!done) {
+        while (head - (tail = atomic_load_explicit(&pipeline->tail, memory_order_acquire)) >= PIPELINE_SLOTS) {
+            if (atomic_load_explicit(&pipeline->stop, memory_order_relaxed)) return NULL;
+            pipeline_wait(pipeline, &pipeline->tail, tail);
+        }
+        if (atomic_load_explicit(&pipeline->stop, memory_order_relaxed)) return NULL;
+
+        TokenBatch* batch = &pipeline->slots[head % PIPELINE_SLOTS];
+        batch->count = 0;
+        while (batch->count < TOKEN_BATCH_SIZE) {
+            Token* token = &batch->tokens[batch->count++];
+            *token = get_next_token(pipeline->lexer);
+            if (token->type == TOK_EOF) {
+                done = true;
+                break;
+            }
+        }
+        atomic_store(&pipeline->head, ++head);
+        pipeline_notify(pipeline);
+    }
+    return NULL;
+}
+
+TokenPipeline* start_pipeline(Lexer* lexer) {
+    TokenPipeline* pipeline = mem_alloc(MEMORY_TOKENS, sizeof(TokenPipeline));
+    pipeline->lexer = lexer;
+    atomic_init(&pipeline->head, 0);
+    atomic_init(&pipeline->tail, 0);
+    atomic_init(&pipeline->stop, 0);
+    atomic_init(&pipeline->waiting, 0);
+    pthread_mutex_init(&pipeline->lock, NULL);
+    pthread_cond_init(&pipeline->changed, NULL);
+    pipeline->position = 0;
+    pipeline->finished = false;
+
+    if (pthread_create(&pipeline->thread, NULL, pipeline_producer, pipeline) != 0) {
+        pthread_cond_destroy(&pipeline->changed);
+        pthread_mutex_destroy(&pipeline->lock);
+        mem_free(MEMORY_TOKENS, pipeline, sizeof(TokenPipeline));
+        return NULL;
+    }
+    return pipeline;
+}
+
+void stop_pipeline(TokenPipeline* pipeline) {
+    atomic_store(&pipeline->stop, 1);
+    pipeline_notify(pipeline);
+    pthread_join(pipeline->thread, NULL);
+    pthread_cond_destroy(&pipeline->changed);
+    pthread_mutex_destroy(&pipeline->lock);
+    mem_free(MEMORY_TOKENS, pipeline, sizeof(TokenPipeline));
+}
+
+Token pipeline_next_token(TokenPipeline* pipeline) {
+    // Depois do EOF o parser continua recebendo EOF, como em get_next_token
+    if (pipeline->finished) return pipeline->last_token;
+
+    size_t tail = atomic_load_explicit(&pipeline->tail, memory_order_relaxed);
+
+    while (atomic_load_explicit(&pipeline->head, memory_order_acquire) == tail) {
+        pipeline_wait(pipeline, &pipeline->head, tail);
+    }
+
+    TokenBatch* batch = &pipeline->slots[tail % PIPELINE_SLOTS];
+    pipeline->last_token = batch->tokens[pipeline->position++];
+    pipeline->finished = pipeline->last_token.type == TOK_EOF;
+
+    if (pipeline->position == (size_t)batch->count) {
+        pipeline->position = 0;
+        atomic_store(&pipeline->tail, tail + 1);
+        pipeline_notify(pipeline);
+    }
+    return pipeline->last_token;
+}
+
+void init_string_pool(StringPool* pool) {
+    pool->blob_capacity = 4096;
+    pool->blob = mem_alloc(MEMORY_TOKENS, pool->blob_capacity);
+    pool->blob_size = 0;
+    pool->capacity = 256;
+    pool->offsets = mem_alloc(MEMORY_TOKENS, pool->capacity * sizeof(uint32_t));
+    pool->count = 0;
+    pool->slot_mask = 511;
+    pool->slots = mem_calloc(MEMORY_TOKENS, pool->slot_mask + 1, sizeof(uint32_t));
+}
+
+void free_string_pool(StringPool* pool) {
+    mem_free(MEMORY_TOKENS, pool->blob, pool->blob_capacity);
+    mem_free(MEMORY_TOKENS, pool->offsets, pool->capacity * sizeof(uint32_t));
+    mem_free(MEMORY_TOKENS, pool->slots, ((size_t)pool->slot_mask + 1) * sizeof(uint32_t));
+}
+
+static uint32_t hash_string(const char* text, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)text[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void grow_string_slots(StringPool* pool) {
+    mem_free(MEMORY_TOKENS, pool->slots, ((size_t)pool->slot_mask + 1) * sizeof(uint32_t));
+    pool->slot_mask = pool->slot_mask * 2 + 1;
+    pool->slots = mem_calloc(MEMORY_TOKENS, (size_t)pool->slot_mask + 1, sizeof(uint32_t));
+    for (uint32_t id = 0; id < pool->count; id++) {
+        const char* text = pool->blob + pool->offsets[id];
+        uint32_t slot = hash_string(text, strlen(text)) & pool->slot_mask;
+        while (pool->slots[slot] != 0) slot = (slot + 1) & pool->slot_mask;
+        pool->slots[slot] = id + 1;
+    }
+}
+
+// Devolve o indice da string, inserindo-a se ainda nao existir
+uint32_t intern_string(StringPool* pool, const char* text, size_t length) {
+    uint32_t slot = hash_string(text, length) & pool->slot_mask;
+    while (pool->slots[slot] != 0) {
+        uint32_t id = pool->slots[slot] - 1;
+        const char* existing = pool->blob + pool->offsets[id];
+        if (strncmp(existing, text, length) == 0 && existing[length] == '\0') return id;
+        slot = (slot + 1) & pool->slot_mask;
+    }
+    
+    if (pool->count == pool->capacity) {
+        pool->capacity *= 2;
+        pool->offsets = mem_realloc(MEMORY_TOKENS, pool->offsets, pool->capacity / 2 * sizeof(uint32_t),
+                                    pool->capacity * sizeof(uint32_t));
+    }
+    size_t old_blob_capacity = pool->blob_capacity;
+    while (pool->blob_size + length + 1 > pool->blob_capacity) pool->blob_capacity *= 2;
+    if (pool->blob_capacity != old_blob_capacity) {
+        pool->blob = mem_realloc(MEMORY_TOKENS, pool->blob, old_blob_capacity, pool->blob_capacity);
+    }
+    uint32_t id = pool->count++;
+    pool->offsets[id] = (uint32_t)pool->blob_size;
+    memcpy(pool->blob + pool->blob_size, text, length);
+    pool->blob[pool->blob_size + length] = '\0';
+    pool->blob_size += length + 1;
+    pool->slots[slot] = id + 1;
+    
+    if (pool->count * 2 > pool->slot_mask) grow_string_slots(pool);
+    return id;
+}
+
+void init_binary_writer(BinaryWriter* writer) {
+    init_string_pool(&writer->strings);
+    writer->token_capacity = 1024;
+    writer->tokens = mem_alloc(MEMORY_TOKENS, writer->token_capacity * sizeof(BinaryToken));
+    writer->token_count = 0;
+    writer->event_capacity = 1024;
+    writer->events = mem_alloc(MEMORY_PARSE, writer->event_capacity * sizeof(uint32_t));
+    writer->event_count = 0;
+}
+
+void free_binary_writer(BinaryWriter* writer) {
+    free_string_pool(&writer->strings);
+    mem_free(MEMORY_TOKENS, writer->tokens, writer->token_capacity * sizeof(BinaryToken));
+    mem_free(MEMORY_PARSE, writer->events, writer->event_capacity * sizeof(uint32_t));
+}
+
+void binary_add_token(BinaryWriter* writer, const Token* token) {
+    if (writer->token_count == writer->token_capacity) {
+        writer->token_capacity *= 2;
+        writer->tokens = mem_realloc(MEMORY_TOKENS, writer->tokens, writer->token_capacity / 2 * sizeof(BinaryToken),
+                                     writer->token_capacity * sizeof(BinaryToken));
+    }
+    BinaryToken* entry = &writer->tokens[writer->token_count++];
+    entry->type = token->type;
+    entry->string_id = intern_string(&writer->strings, token->lexeme, strlen(token->lexeme));
+    entry->line = token->line;
+    entry->column = token->column;
+}
 
-void ShowError() {
-    if (global_lexer == NULL || global_lexer->file == NULL) return;
+void binary_add_event(BinaryWriter* writer, uint32_t event) {
+    if (writer->event_count == writer->event_capacity) {
+        writer->event_capacity *= 2;
+        writer->events = mem_realloc(MEMORY_PARSE, writer->events, writer->event_capacity / 2 * sizeof(uint32_t),
+                                     writer->event_capacity * sizeof(uint32_t));
+    }
+    writer->events[writer->event_count++] = event;
+}
+
+// Reordena a tabela de strings para que as entradas da tabela de simbolos
+// venham primeiro, na mesma ordem (indice da string == indice do simbolo)
+void binary_use_symbol_order(BinaryWriter* writer, SymbolTable* table) {
+    StringPool ordered;
+    init_string_pool(&ordered);
+    for (int i = 0; i < table->count; i++) {
+        intern_string(&ordered, table->symbols[i].name, strlen(table->symbols[i].name));
+    }
     
-    long current_pos = ftell(global_lexer->file);
+    size_t remap_size = ((size_t)writer->strings.count + 1) * sizeof(uint32_t);
+    uint32_t* remap = mem_alloc(MEMORY_TOKENS, remap_size);
+    for (uint32_t id = 0; id < writer->strings.count; id++) {
+        const char* text = writer->strings.blob + writer->strings.offsets[id];
+        remap[id] = intern_string(&ordered, text, strlen(text));
+    }
+    for (size_t i = 0; i < writer->token_count; i++) {
+        writer->tokens[i].string_id = remap[writer->tokens[i].string_id];
+    }
+    mem_free(MEMORY_TOKENS, remap, remap_size);
     
-    FILE* file = fopen(global_lexer->filename, "r");
-    if (!file) return;
+    free_string_pool(&writer->strings);
+    writer->strings = ordered;
+}
+
+static uint64_t align_section(OutputBuffer* out) {
+    while (out->length % 8 != 0) out_char(out, '\0');
+    return out->length;
+}
+
+int write_binary_file(BinaryWriter* writer, const char* filename) {
+    BinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
     
-    char linha[MAX_LINE_LENGTH];
-    int linha_atual = 1;
+    OutputBuffer file;
+    out_init(&file, OUT_MEMORY);
+    out_write(&file, (const char*)&header, sizeof(header));
     
-    while (linha_atual < current_token.line && fgets(linha, sizeof(linha), file)) {
-        linha_atual++;
+    header.string_count = writer->strings.count;
+    header.string_index_offset = align_section(&file);
+    out_write(&file, (const char*)writer->strings.offsets, writer->strings.count * sizeof(uint32_t));
+    header.string_blob_offset = align_section(&file);
+    header.string_blob_size = writer->strings.blob_size;
+    out_write(&file, writer->strings.blob, writer->strings.blob_size);
+    
+    // Tokens: tipo, delta da linha, coluna e indice do lexema, todos em varint
+    header.token_count = writer->token_count;
+    header.token_offset = align_section(&file);
+    int64_t previous_line = 0;
+    for (size_t i = 0; i < writer->token_count; i++) {
+        BinaryToken* token = &writer->tokens[i];
+        out_varint(&file, (uint64_t)token->type);
+        out_varint(&file, (uint64_t)(token->line - previous_line));
+        out_varint(&file, (uint64_t)token->column);
+        out_varint(&file, token->string_id);
+        previous_line = token->line;
+    }
+    header.token_size = file.length - header.token_offset;
+    
+    header.event_count = writer->event_count;
+    header.event_offset = align_section(&file);
+    for (size_t i = 0; i < writer->event_count; i++) {
+        out_varint(&file, writer->events[i]);
+    }
+    header.event_size = file.length - header.event_offset;
+    memcpy(file.data, &header, sizeof(header));
+    
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        out_free(&file);
+        return -1;
     }
+    file.fd = fd;
+    out_flush(&file);
+    close(fd);
+    out_free(&file);
+    return 0;
+}
 
-    if (linha_atual == current_token.line && fgets(linha, sizeof(linha), file)) {
-        linha[strcspn(linha, "\n")] = '\0';
-        
-        printf("     Linha %d: %s\n", current_token.line, linha);
-        
-        printf("     ");
-        for (int i = 1; i < current_token.column; i++) {
-            if (i < (int)strlen(linha) && linha[i-1] == '\t') {
-                printf("\t"); 
-            } else {
-                printf(" ");
-            }
+static bool read_varint(const uint8_t** cursor, const uint8_t* end, uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; *cursor < end && shift < 64; shift += 7) {
+        uint8_t byte = *(*cursor)++;
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+static bool section_fits(uint64_t offset, uint64_t size, size_t file_size) {
+    return offset <= file_size && size <= file_size - offset;
+}
+
+// Converte um arquivo .bin de volta para os textos .lex e .syntax
+int dump_binary_file(const char* filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        printf("Erro ao abrir arquivo: %s\n", filename);
+        return 1;
+    }
+    struct stat info;
+    fstat(fd, &info);
+    size_t file_size = (size_t)info.st_size;
+    const uint8_t* base = file_size >= sizeof(BinaryHeader)
+        ? mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    
+    if (base != MAP_FAILED) memory_charge(MEMORY_SOURCE, file_size);
+    
+    const BinaryHeader* header = (const BinaryHeader*)base;
+    if (base == MAP_FAILED || memcmp(header->magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0 ||
+        header->version != BINARY_VERSION ||
+        header->string_count > UINT32_MAX ||
+        !section_fits(header->string_index_offset, header->string_count * sizeof(uint32_t), file_size) ||
+        !section_fits(header->string_blob_offset, header->string_blob_size, file_size) ||
+        !section_fits(header->token_offset, header->token_size, file_size) ||
+        !section_fits(header->event_offset, header->event_size, file_size)) {
+        printf("Arquivo binario invalido: %s\n", filename);
+        if (base != MAP_FAILED) {
+            munmap((void*)base, file_size);
+            memory_release(MEMORY_SOURCE, file_size);
+        }
+        return 1;
+    }
+    
+    const uint32_t* string_index = (const uint32_t*)(base + header->string_index_offset);
+    const char* blob = (const char*)(base + header->string_blob_offset);
+    
+    char base_filename[256];
+    size_t name_length = strlen(filename);
+    if (name_length > 4 && strcmp(filename + name_length - 4, ".bin") == 0) name_length -= 4;
+    if (name_length >= sizeof(base_filename) - 8) name_length = sizeof(base_filename) - 8;
+    memcpy(base_filename, filename, name_length);
+    
+    init_token_name_columns();
+    int status = 0;
+    
+    strcpy(base_filename + name_length, ".lex");
+    OutputBuffer out;
+    out_init(&out, open(base_filename, O_WRONLY | O_CREAT | O_TRUNC, 0666));
+    write_lex_header(&out);
+    const uint8_t* cursor = base + header->token_offset;
+    const uint8_t* end = cursor + header->token_size;
+    uint64_t line = 0;
+    for (uint64_t i = 0; i < header->token_count && status == 0; i++) {
+        uint64_t type, delta, column, string_id;
+        if (!read_varint(&cursor, end, &type) || !read_varint(&cursor, end, &delta) ||
+            !read_varint(&cursor, end, &column) || !read_varint(&cursor, end, &string_id) ||
+            type > TOK_ERROR || string_id >= header->string_count) {
+            status = 1;
+            break;
+        }
+        line += delta;
+        write_lex_entry(&out, (TokenType)type, blob + string_index[string_id], (int64_t)line, (int64_t)column);
+    }
+    out_flush(&out);
+    if (out.fd >= 0) close(out.fd);
+    out_free(&out);
+    if (status == 0) printf("Tokens salvos em: %s\n", base_filename);
+    
+    strcpy(base_filename + name_length, ".syntax");
+    out_init(&out, open(base_filename, O_WRONLY | O_CREAT | O_TRUNC, 0666));
+    out_literal(&out, "=== SEQUENCIA DE REGRAS DE PRODUCAO ===\n");
+    cursor = base + header->event_offset;
+    end = cursor + header->event_size;
+    for (uint64_t i = 0; i < header->event_count && status == 0; i++) {
+        uint64_t event, string_id;
+        if (!read_varint(&cursor, end, &event)) {
+            status = 1;
+        } else if (event < RULE_COUNT) {
+            out_write(&out, production_text[event].text, production_text[event].length);
+        } else if (event == EVENT_SUCCESS) {
+            out_literal(&out, "Programa analisado com sucesso!\n");
+        } else if (event == EVENT_ERROR && read_varint(&cursor, end, &string_id) &&
+                   string_id < header->string_count) {
+            out_str(&out, blob + string_index[string_id]);
+            i++;
+        } else {
+            status = 1;
         }
-        printf("\033[1;31m^\033[0m\n");
-        for (int i = 1; i < current_token.column; i++) {
-            printf(" ");
+    }
+    out_flush(&out);
+    if (out.fd >= 0) close(out.fd);
+    out_free(&out);
+    if (status == 0) printf("Regras de producao salvas em: %s\n", base_filename);
+    
+    munmap((void*)base, file_size);
+    memory_release(MEMORY_SOURCE, file_size);
+    if (status != 0) printf("Arquivo binario corrompido: %s\n", filename);
+    return status;
+}
+
+// Procura a linha do token atual no historico que o lexer mantem em memoria.
+// Devolve false se a linha ja saiu do buffer
+static bool find_error_line(Lexer* lexer, int64_t line, char* text, size_t* length) {
+    size_t end = lexer->current_char == EOF ? lexer->length : lexer->position - 1;
+    int64_t skip = lexer->line - line;
+    size_t start = end;
+    
+    if (skip < 0) return false;
+    while (start > 0) {
+        if (lexer->buffer[start - 1] == '\n') {
+            if (skip == 0) break;
+            skip--;
         }
-        printf("\033[1;33mO Erro esta nesta linha acima\033[0m\n");
+        start--;
+    }
+    if (start == 0 && (skip > 0 || lexer->buffer_offset > 0)) return false;
+    
+    size_t count = 0;
+    while (start + count < lexer->length && count < MAX_LINE_LENGTH - 1 &&
+           lexer->buffer[start + count] != '\n') {
+        text[count] = (char)lexer->buffer[start + count];
+        count++;
+    }
+    // Linha vazia no fim do arquivo: nao ha o que mostrar
+    if (count == 0 && start == lexer->length) return false;
+    
+    text[count] = '\0';
+    *length = count;
+    return true;
+}
+
+// Caminho antigo para arquivos comuns: rele o arquivo ate a linha do erro
+static bool reread_error_line(const char* filename, int64_t line, char* text, size_t* length) {
+    FILE* file = fopen(filename, "r");
+    if (!file) return false;
+    
+    // Conta os '\n' de verdade: linhas maiores que o buffer nao contam a mais
+    int64_t linha_atual = 1;
+    int c = EOF;
+    while (linha_atual < line && (c = getc(file)) != EOF) {
+        if (c == '\n') linha_atual++;
     }
     
+    size_t count = 0;
+    c = linha_atual == line ? getc(file) : EOF;
+    bool found = c != EOF;
+    while (c != EOF && c != '\n') {
+        if (count < MAX_LINE_LENGTH - 1) text[count++] = (char)c;
+        c = getc(file);
+    }
     fclose(file);
+    if (!found) return false;
+    
+    text[count] = '\0';
+    *length = count;
+    return true;
+}
+
+void ShowError(OutputBuffer* out) {
+    if (global_lexer == NULL) return;
     
-    fseek(global_lexer->file, current_pos, SEEK_SET);
+    double start = options.stats ? monotonic_seconds() : 0;
+    char linha[MAX_LINE_LENGTH];
+    size_t length = 0;
+    // Com o pipeline o lexer esta em outra thread e o historico nao e estavel
+    bool found = global_pipeline == NULL &&
+                 find_error_line(global_lexer, current_token.line, linha, &length);
+    
+    if (!found && global_lexer->seekable) {
+        found = reread_error_line(global_lexer->filename, current_token.line, linha, &length);
+    }
+    if (options.stats) stats.phase_seconds[STATS_PHASE_DIAGNOSTICS] += monotonic_seconds() - start;
+    if (!found) return;
+    
+    out_literal(out, "     Linha ");
+    out_int(out, current_token.line);
+    out_literal(out, ": ");
+    out_write(out, linha, length);
+    out_char(out, '\n');
+    
+    out_literal(out, "     ");
+    for (int64_t i = 1; i < current_token.column; i++) {
+        out_char(out, i < (int64_t)length && linha[i-1] == '\t' ? '\t' : ' ');
+    }
+    out_literal(out, "\033[1;31m^\033[0m\n");
+    out_padded(out, "", 0, current_token.column > 1 ? (size_t)(current_token.column - 1) : 0);
+    out_literal(out, "\033[1;33mO Erro esta nesta linha acima\033[0m\n");
 }
 
 void SyntacticError(const char* mensagem) {
-    printf("\033[1;31mERRO SINTATICO (Linha %d): %s", current_token.line, mensagem);
+    OutputBuffer diagnostic;
+    out_init(&diagnostic, OUT_MEMORY);
+    
+    out_literal(&diagnostic, "\033[1;31mERRO SINTATICO (Linha ");
+    out_int(&diagnostic, current_token.line);
+    out_literal(&diagnostic, "): ");
+    out_str(&diagnostic, mensagem);
     
     if (current_token.type == TOK_EOF) {
-        printf(" - fim de arquivo encontrado\033[0m\n");
+        out_literal(&diagnostic, " - fim de arquivo encontrado\033[0m\n");
     } else {
-        printf(" - encontrado [%s]\033[0m\n", current_token.lexeme);
+        out_literal(&diagnostic, " - encontrado [");
+        out_str(&diagnostic, current_token.lexeme);
+        out_literal(&diagnostic, "]\033[0m\n");
     }
     
-    ShowError();
+    ShowError(&diagnostic);
+    
+    trace_text(diagnostic.data, diagnostic.length);
+    if (token_tap != NULL) out_write(token_tap->console, diagnostic.data, diagnostic.length);
+    if (binary_output != NULL) {
+        binary_add_event(binary_output, EVENT_ERROR);
+        binary_add_event(binary_output, intern_string(&binary_output->strings, diagnostic.data, diagnostic.length));
+    }
+    out_free(&diagnostic);
     
     has_syntax_errors = 1;
 }
@@ -733,390 +2512,3758 @@ void EndFile() {
     }
 }
 
+// Rastro das producoes: o parser so grava o id da regra (4 bytes); o texto
+// e gerado em lote quando o anel enche, antes de cada diagnostico e no fim
+uint32_t trace_ring[TRACE_RING_SIZE];
+size_t trace_count = 0;
+// Segundo destino do texto do rastro (o .syntax), alem de parser_output
+OutputBuffer* trace_file = NULL;
+
+void trace_flush(void) {
+    for (size_t i = 0; i < trace_count; i++) {
+        const ProductionText* text = &production_text[trace_ring[i]];
+        if (parser_output != NULL) out_write(parser_output, text->text, text->length);
+        if (trace_file != NULL) out_write(trace_file, text->text, text->length);
+        if (binary_output != NULL) binary_add_event(binary_output, trace_ring[i]);
+    }
+    trace_count = 0;
+}
+
+static inline void trace_push(ProductionRule rule) {
+    if (trace_count == TRACE_RING_SIZE) trace_flush();
+    trace_ring[trace_count++] = rule;
+}
+
+// Texto fora das producoes (diagnosticos, mensagem de sucesso), na ordem certa
+void trace_text(const char* text, size_t length) {
+    trace_flush();
+    if (parser_output != NULL) out_write(parser_output, text, length);
+    if (trace_file != NULL) out_write(trace_file, text, length);
+}
+
+#define trace_literal(text) trace_text(text, sizeof(text) - 1)
+
+Token next_token(void) {
+    Token token = global_pipeline != NULL
+        ? pipeline_next_token(global_pipeline)
+        : get_next_token(global_lexer);
+    
+    if (token_tap != NULL && token.type != TOK_EOF) {
+        STAT_ADD(tokens[token.type], 1);
+        if (token.type == TOK_ERROR) token_tap->has_errors = true;
+        write_console_entry(token_tap->console, token.type, token.lexeme, token.line, token.column);
+        write_lex_entry(token_tap->lex, token.type, token.lexeme, token.line, token.column);
+    }
+    return token;
+}
+
 void TokenHouse(TokenType tipo_esperado) {
     if (current_token.type == tipo_esperado) {
-        current_token = get_next_token(global_lexer);
+        current_token = next_token();
     } else {
         SyntacticError("token nao esperado");
         if (current_token.type != TOK_EOF && current_token.type != TOK_ERROR) {
-            current_token = get_next_token(global_lexer);
+            current_token = next_token();
         }
     }
 }
 
-void Program() {
-    printf("programa -> program ID ; bloco .\n");
-    TokenHouse(TOK_PROGRAM);
-    if (has_syntax_errors) return;
-    TokenHouse(ID);
-    if (has_syntax_errors) return;
-    TokenHouse(SMB_SEM);
-    if (has_syntax_errors) return;
-    Block();
-    if (has_syntax_errors) return;
-    TokenHouse(SMB_DOT);
-    if (!has_syntax_errors) {
-        printf("Programa analisado com sucesso!\n");
-    }
-    
-    EndFile();
-}
+// Um nivel por '(' aberto; true quando o nivel ja teve um operador relacional
+bool* expression_levels = NULL;
+size_t expression_capacity = 0;
 
-void Block() {
-    if (has_syntax_errors) return;
-    printf("bloco -> parte_declaracoes_variaveis comando_composto\n");
-    PartVariableDeclarations();
-    if (has_syntax_errors) return;
-    CompoundCommand();
+static void expression_reserve(size_t depth) {
+    if (depth < expression_capacity) return;
+    size_t old_capacity = expression_capacity;
+    expression_capacity = expression_capacity == 0 ? 64 : expression_capacity * 2;
+    expression_levels = mem_realloc(MEMORY_PARSE, expression_levels, old_capacity * sizeof(bool),
+                                    expression_capacity * sizeof(bool));
 }
 
-void PartVariableDeclarations() {
-    if (has_syntax_errors) return;
-    printf("parte_declaracoes_variaveis -> var declaracao_variaveis { ; declaracao_variaveis }\n");
-    if (current_token.type == TOK_VAR) {
-        TokenHouse(TOK_VAR);
-        if (has_syntax_errors) return;
-        VariableDeclararion();
-        while (current_token.type == SMB_SEM && !has_syntax_errors) {
-            TokenHouse(SMB_SEM);
-            if (has_syntax_errors) break;
-            if (current_token.type == TOK_BEGIN || current_token.type == TOK_EOF) break;
-            VariableDeclararion();
-        }
+// 3: * / mod, 2: + -, 1: relacionais, 0: nao e operador de expressao
+static inline int operator_power(TokenType type) {
+    switch (type) {
+        case OP_MUL: case OP_DIV: case OP_MOD: return 3;
+        case OP_AD: case OP_MIN: return 2;
+        case OP_EQ: case OP_NE: case OP_LT: case OP_LE: case OP_GT: case OP_GE: return 1;
+        default: return 0;
     }
 }
 
-void VariableDeclararion() {
-    if (has_syntax_errors) return;
-    printf("declaracao_variaveis -> lista_identificadores : tipo\n");
-    ListIdentifiers();
-    if (has_syntax_errors) return;
-    TokenHouse(SMB_COLON);
-    if (has_syntax_errors) return;
-    Type();
-}
+#define PARSER(name) name##Traced
+#define TRACE_RULE(rule) trace_push(rule)
+#include "sintatico.inc"
+#undef PARSER
+#undef TRACE_RULE
 
-void ListIdentifiers() {
-    if (has_syntax_errors) return;
-    printf("lista_identificadores -> ID { , ID }\n");
-    TokenHouse(ID);
-    while (current_token.type == SMB_COM && !has_syntax_errors) {
-        TokenHouse(SMB_COM);
-        if (has_syntax_errors) break;
-        TokenHouse(ID);
-    }
-}
+#define PARSER(name) name
+#define TRACE_RULE(rule) ((void)0)
+#include "sintatico.inc"
+#undef PARSER
+#undef TRACE_RULE
 
-void Type() {
-    if (has_syntax_errors) return;
-    printf("tipo -> integer | real\n");
-    if (current_token.type == TOK_INTEGER) {
-        TokenHouse(TOK_INTEGER);
-    } else if (current_token.type == TOK_REAL) {
-        TokenHouse(TOK_REAL);
-    } else {
-        SyntacticError("tipo esperado (integer ou real)");
-    }
-}
+// --ll1: parser preditivo dirigido pela tabela gerada de gramatica.ll1
+// (ll1gen.c). A pilha de simbolos fica no heap, entao o aninhamento de
+// begin/if/while/parenteses nao consome pilha de C.
+#include "tabela_ll1.h"
 
-void CompoundCommand() {
-    if (has_syntax_errors) return;
-    printf("comando_composto -> begin comando ; { comando ; } end\n");
-    TokenHouse(TOK_BEGIN);
-    if (has_syntax_errors) return;
+int16_t* ll1_stack = NULL;
+size_t ll1_capacity = 0;
 
-    if (current_token.type == TOK_EOF) {
-        SyntacticError("comando esperado apos begin");
-        return;
+static void ll1_reserve(size_t depth) {
+    while (depth > ll1_capacity) {
+        size_t old_capacity = ll1_capacity;
+        ll1_capacity = ll1_capacity == 0 ? 256 : ll1_capacity * 2;
+        ll1_stack = mem_realloc(MEMORY_PARSE, ll1_stack, old_capacity * sizeof(int16_t), ll1_capacity * sizeof(int16_t));
     }
-    
-    Command();
-    if (has_syntax_errors) return;
-    TokenHouse(SMB_SEM);
-    if (has_syntax_errors) return;
+}
 
-    while (current_token.type != TOK_END && current_token.type != TOK_EOF && !has_syntax_errors) {
-        Command();
-        if (has_syntax_errors) break;
-        if (current_token.type == TOK_END || current_token.type == TOK_EOF) break;
-        TokenHouse(SMB_SEM);
-        if (has_syntax_errors) break;
+// Chamado com traced constante, como as duas copias de sintatico.inc
+static inline void ll1_parse(bool traced) {
+    size_t depth = 0, peak = 1;
+    ll1_reserve(1);
+    ll1_stack[depth++] = LL1_START;
+    
+    while (depth > 0) {
+        int16_t symbol = ll1_stack[--depth];
+        
+        if (symbol >= 0) {
+            if (current_token.type != (TokenType)symbol) {
+                SyntacticError("token nao esperado");
+                break;
+            }
+            current_token = next_token();
+            continue;
+        }
+        
+        int nonterminal = -1 - symbol;
+        if (traced && ll1_trace_rule[nonterminal] >= 0) trace_push(ll1_trace_rule[nonterminal]);
+        
+        uint8_t entry = ll1_table[nonterminal][current_token.type];
+        if (entry == 0) entry = ll1_default[nonterminal];
+        if (entry == 0) {
+            SyntacticError(ll1_error_message[nonterminal]);
+            break;
+        }
+        
+        const LL1Production* production = &ll1_productions[entry - 1];
+        ll1_reserve(depth + production->length);
+        for (int i = production->length - 1; i >= 0; i--) {
+            ll1_stack[depth++] = ll1_rhs[production->rhs + i];
+        }
+        if (depth > peak) peak = depth;
     }
     
+    stats.ll1_stack_peak = peak;
     if (!has_syntax_errors) {
-        TokenHouse(TOK_END);
+        trace_literal("Programa analisado com sucesso!\n");
+        if (binary_output != NULL) binary_add_event(binary_output, EVENT_SUCCESS);
     }
+    EndFile();
 }
 
-void Command() {
-    if (has_syntax_errors || current_token.type == TOK_EOF) return;
+void run_parser(Lexer* lexer) {
+    global_lexer = lexer;
+    global_pipeline = options.pipeline ? start_pipeline(lexer) : NULL;
     
-    printf("comando -> atribuicao | comando_composto | comando_condicional | comando_repetitivo\n");
+    current_token = next_token();
+    has_syntax_errors = 0;
     
-    if (current_token.type == TOK_EOF) {
-        SyntacticError("comando esperado");
-        return;
+    if (options.ll1) {
+        if (options.no_trace) {
+            ll1_parse(false);
+        } else {
+            ll1_parse(true);
+            trace_flush();
+        }
+    } else if (options.no_trace) {
+        Program();
+    } else {
+        ProgramTraced();
+        trace_flush();
     }
     
-    if (current_token.type == ID) {
-        Assignment();
-    } else if (current_token.type == TOK_BEGIN) {
-        CompoundCommand();
-    } else if (current_token.type == TOK_IF) {
-        AdditionalCommand();
-    } else if (current_token.type == TOK_WHILE) {
-        RepetitiveCommand();
-    } else {
-        SyntacticError("comando esperado");
-        if (current_token.type != TOK_EOF && current_token.type != TOK_ERROR) {
-            current_token = get_next_token(global_lexer);
-        }
-    }
-}
-
-void Assignment() {
-    if (has_syntax_errors) return;
-    printf("atribuicao -> variavel := expressao\n");
-    Variable();
-    if (has_syntax_errors) return;
-    TokenHouse(OP_ASS);
-    if (has_syntax_errors) return;
-    Expression();
-}
-
-void AdditionalCommand() {
-    if (has_syntax_errors) return;
-    printf("comando_condicional -> if expressao then comando [ else comando ]\n");
-    TokenHouse(TOK_IF);
-    if (has_syntax_errors) return;
-    Expression();
-    if (has_syntax_errors) return;
-    TokenHouse(TOK_THEN);
-    if (has_syntax_errors) return;
-    Command();
-    if (current_token.type == TOK_ELSE && !has_syntax_errors) {
-        TokenHouse(TOK_ELSE);
-        if (has_syntax_errors) return;
-        Command();
-    }
-}
-
-void RepetitiveCommand() {
-    if (has_syntax_errors) return;
-    printf("comando_repetitivo -> while expressao do comando\n");
-    TokenHouse(TOK_WHILE);
-    if (has_syntax_errors) return;
-    Expression();
-    if (has_syntax_errors) return;
-    TokenHouse(TOK_DO);
-    if (has_syntax_errors) return;
-    Command();
-}
-
-void Expression() {
-    if (has_syntax_errors) return;
-    printf("expressao -> expressao_simples [ relacao expressao_simples ]\n");
-    SimpleExpression();
-    if (!has_syntax_errors && 
-        (current_token.type == OP_EQ || current_token.type == OP_NE || 
-         current_token.type == OP_LT || current_token.type == OP_LE ||
-         current_token.type == OP_GT || current_token.type == OP_GE)) {
-        Relation();
-        if (has_syntax_errors) return;
-        SimpleExpression();
-    }
-}
-
-void Relation() {
-    if (has_syntax_errors) return;
-    printf("relacao -> = | < | <= | >= | > | <>\n");
-    switch (current_token.type) {
-        case OP_EQ: TokenHouse(OP_EQ); break;
-        case OP_NE: TokenHouse(OP_NE); break;
-        case OP_LT: TokenHouse(OP_LT); break;
-        case OP_LE: TokenHouse(OP_LE); break;
-        case OP_GT: TokenHouse(OP_GT); break;
-        case OP_GE: TokenHouse(OP_GE); break;
-        default: SyntacticError("operador relacional esperado");
-    }
-}
-
-void SimpleExpression() {
-    if (has_syntax_errors) return;
-    printf("expressao_simples -> [+ | -] termo { (+ | - ) termo }\n");
-    if (current_token.type == OP_AD || current_token.type == OP_MIN) {
-        if (current_token.type == OP_AD) TokenHouse(OP_AD);
-        else TokenHouse(OP_MIN);
-    }
-    if (has_syntax_errors) return;
-    Term();
-    while (!has_syntax_errors && (current_token.type == OP_AD || current_token.type == OP_MIN)) {
-        if (current_token.type == OP_AD) TokenHouse(OP_AD);
-        else TokenHouse(OP_MIN);
-        if (has_syntax_errors) break;
-        Term();
-    }
-}
-
-void Term() {
-    if (has_syntax_errors) return;
-    printf("termo -> fator { (* | / | mod) fator }\n");
-    Factor();
-    while (!has_syntax_errors && 
-           (current_token.type == OP_MUL || current_token.type == OP_DIV || 
-            current_token.type == OP_MOD)) { 
-        if (current_token.type == OP_MUL) TokenHouse(OP_MUL);
-        else if (current_token.type == OP_DIV) TokenHouse(OP_DIV);
-        else if (current_token.type == OP_MOD) TokenHouse(OP_MOD); 
-        if (has_syntax_errors) break;
-        Factor();
-    }
-}
-
-void Factor() {
-    if (has_syntax_errors) return;
-    printf("fator -> variavel | numero | ( expressao )\n");
-    if (current_token.type == ID) {
-        Variable();
-    } else if (current_token.type == LIT_INT || current_token.type == LIT_REAL || current_token.type == LIT_REAL_EXP) {
-        if (current_token.type == LIT_INT) TokenHouse(LIT_INT);
-        else if (current_token.type == LIT_REAL) TokenHouse(LIT_REAL);
-        else TokenHouse(LIT_REAL_EXP);
-    } else if (current_token.type == SMB_OPA) {
-        TokenHouse(SMB_OPA);
-        if (has_syntax_errors) return;
-        Expression();
-        if (has_syntax_errors) return;
-        TokenHouse(SMB_CPA);
-    } else {
-        SyntacticError("fator esperado (variavel, numero ou expressao entre parenteses)");
+    // O parser para no primeiro erro; no modo fluxo o resto da entrada
+    // ainda precisa passar pelo lexico
+    if (token_tap != NULL) {
+        while (current_token.type != TOK_EOF) current_token = next_token();
+    }
+    
+    if (global_pipeline != NULL) {
+        stop_pipeline(global_pipeline);
+        global_pipeline = NULL;
     }
 }
 
-void Variable() {
-    if (has_syntax_errors) return;
-    printf("variavel -> ID\n");
-    TokenHouse(ID);
+static void cache_key(const char* source, size_t size, char* key, size_t key_size) {
+    char salt[128];
+    snprintf(salt, sizeof(salt), "mpas|%s|%d|binario=%d|rastro=%d|ll1=%d", ANALYZER_VERSION, CACHE_VERSION,
+             options.binary, !options.no_trace, options.ll1);
+    uint64_t seed = hash_bytes(salt, strlen(salt), 0);
+    snprintf(key, key_size, "%016llx%016llx",
+             (unsigned long long)hash_bytes(source, size, seed),
+             (unsigned long long)hash_bytes(source, size, seed ^ HASH_PRIME3));
 }
 
-int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        printf("Uso: %s <arquivo.mpas>\n", argv[0]);
-        return 1;
+// Contadores compartilhados entre processos: 8 bytes (uint64_t) lidos e
+// regravados sob flock; arquivo vazio (recem-criado) vale 0
+static bool read_counter(int fd, uint64_t* value) {
+    *value = 0;
+    ssize_t count = pread(fd, value, sizeof(*value), 0);
+    return count == 0 || count == (ssize_t)sizeof(*value);
+}
+
+static void cache_count(const char* cache_dir, const char* counter, OutputBuffer* console) {
+    char path[PATH_MAX];
+    uint64_t value = 0;
+    snprintf(path, sizeof(path), "%s/%s", cache_dir, counter);
+    int fd = open(path, O_RDWR | O_CREAT, 0666);
+    bool counted = fd >= 0 && flock(fd, LOCK_EX) == 0 && read_counter(fd, &value);
+    if (counted) {
+        value++;
+        counted = pwrite(fd, &value, sizeof(value), 0) == (ssize_t)sizeof(value);
     }
+    if (!counted) {
+        out_literal(console, "\033[1;33mAviso: contador do cache nao atualizado (");
+        out_str(console, path);
+        out_literal(console, "): ");
+        out_str(console, strerror(errno));
+        out_literal(console, "\033[0m\n");
+    }
+    if (fd >= 0) close(fd);  // close solta o flock
+}
+
+static void replay_saved_line(OutputBuffer* console, const char* label, const char* filename, size_t label_length) {
+    out_write(console, label, label_length);
+    out_str(console, filename);
+    out_char(console, '\n');
+}
+
+// Checksum encadeado secao a secao: quem grava nao precisa delas contiguas
+static uint64_t cache_checksum(const struct iovec* section) {
+    uint64_t checksum = 0;
+    for (int i = 0; i < CACHE_SECTIONS; i++) checksum = hash_bytes(section[i].iov_base, section[i].iov_len, checksum);
+    return checksum;
+}
+
+static bool cache_replay(const char* entry_path, const char* source_filename, OutputBuffer* console, int* status) {
+    size_t size;
+    char* entry = read_file(entry_path, &size);
+    if (entry == NULL) return false;
     
-    printf("\t\t--- ANALISE LEXICA ---\n");
-    
-    FILE* file = fopen(argv[1], "r");
-    if (!file) {
-        printf("Erro ao abrir arquivo: %s\n", argv[1]);
-        return 1;
+    CacheEntryHeader header;
+    struct iovec sections[CACHE_SECTIONS];
+    uint64_t payload_size = 0;
+    bool valid = size >= sizeof(header);
+    if (valid) {
+        memcpy(&header, entry, sizeof(header));
+        for (int i = 0; i < CACHE_SECTIONS; i++) payload_size += header.section_size[i];
+        valid = memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+                header.version == CACHE_VERSION &&
+                payload_size == size - sizeof(header);
+    }
+    if (valid) {
+        char* next = entry + sizeof(header);
+        for (int i = 0; i < CACHE_SECTIONS; i++) {
+            sections[i].iov_base = next;
+            sections[i].iov_len = header.section_size[i];
+            next += header.section_size[i];
+        }
+        valid = header.checksum == cache_checksum(sections);
+    }
+    if (!valid) {
+        free_file(entry, size);
+        return false;
     }
     
-    Lexer* lexer = init_lexer(file, argv[1]);
+    const char* section[CACHE_SECTIONS];
+    for (int i = 0; i < CACHE_SECTIONS; i++) section[i] = sections[i].iov_base;
     
-    char output_filename[100];
-    snprintf(output_filename, sizeof(output_filename), "%s.lex", argv[1]);
-    FILE* output_file = fopen(output_filename, "w");
+    char tokens_filename[PATH_MAX];
+    char syntax_filename[PATH_MAX];
+    if (!output_name(tokens_filename, sizeof(tokens_filename), source_filename, options.binary ? ".bin" : ".lex") ||
+        !output_name(syntax_filename, sizeof(syntax_filename), source_filename, ".syntax")) {
+        free_file(entry, size);
+        return false;
+    }
+    bool syntax_saved = (header.flags & CACHE_SYNTAX_SAVED) != 0;
     
-    if (!output_file) {
-        printf("Erro ao criar arquivo de saida\n");
-        free_lexer(lexer);
-        return 1;
+    if (!options.binary || syntax_saved) {
+        write_file(tokens_filename, section[CACHE_TOKENS_FILE], header.section_size[CACHE_TOKENS_FILE]);
+    }
+    if (!options.binary && syntax_saved) {
+        write_file(syntax_filename, section[CACHE_SYNTAX_FILE], header.section_size[CACHE_SYNTAX_FILE]);
     }
     
-    fprintf(output_file, "\t\t=== TOKENS RECONHECIDOS ===\n");
-    fprintf(output_file, "%-15s %-18s %-8s %-8s\n", "TOKEN", "LEXEMA", "LINHA", "COLUNA");
-    fprintf(output_file, "--------------------------------------------------\n");
+    static const char tokens_label[] = "\n\033[1;35mTokens salvos em:\033[0m ";
+    static const char syntax_label[] = "\n\033[1;35mRegras de producao salvas em:\033[0m ";
+    out_write(console, section[CACHE_LEXICAL_LOG], header.section_size[CACHE_LEXICAL_LOG]);
+    replay_saved_line(console, tokens_label, tokens_filename, sizeof(tokens_label) - 1);
+    out_write(console, section[CACHE_SYNTAX_LOG], header.section_size[CACHE_SYNTAX_LOG]);
+    if (syntax_saved) {
+        replay_saved_line(console, syntax_label, options.binary ? tokens_filename : syntax_filename,
+                          sizeof(syntax_label) - 1);
+    }
     
-    printf("\t   === TOKENS RECONHECIDOS ===\n");
-    printf("%-15s %-18s %-8s %-8s\n", "TOKEN", "LEXEMA", "LINHA", "COLUNA");
-    printf("------------------------------------------------\n");
+    *status = header.exit_code;
+    free_file(entry, size);
+    return true;
+}
 
-    Token token;
-    int has_lexical_errors = 0;
+typedef struct {
+    char name[NAME_MAX + 1];
+    off_t size;
+    time_t used;
+} CacheFile;
+
+static int compare_cache_files(const void* a, const void* b) {
+    const CacheFile* left = a;
+    const CacheFile* right = b;
+    return (left->used > right->used) - (left->used < right->used);
+}
+
+// Entradas da analise e binarios do --compilar dividem o mesmo limite
+static bool is_cache_file(const char* name) {
+    size_t length = strlen(name);
+    return (length > 6 && strcmp(name + length - 6, ".entry") == 0) ||
+           (length > 7 && strcmp(name + length - 7, ".nativo") == 0);
+}
+
+// Remove as entradas usadas ha mais tempo (mtime) ate caber em max_bytes;
+// keep (ou NULL) e o arquivo recem-criado, que fica mesmo maior que o limite
+static void cache_evict(const char* cache_dir, uint64_t max_bytes, const char* keep) {
+    DIR* dir = opendir(cache_dir);
+    if (dir == NULL) return;
     
-    do {
-        token = get_next_token(lexer);
+    size_t count = 0, capacity = 64;
+    CacheFile* files = mem_alloc(MEMORY_OUTPUT, capacity * sizeof(CacheFile));
+    uint64_t total = 0;
+    struct dirent* item;
+    
+    while ((item = readdir(dir)) != NULL) {
+        if (!is_cache_file(item->d_name)) continue;
         
-        if (token.type == TOK_ERROR) {
-            has_lexical_errors = 1;
-            printf("\033[1;31mERRO\033[0m (Linha %d, Coluna %d): %s\n", 
-                   token.line, token.column, token.lexeme);
-            fprintf(output_file, "ERRO (Linha %d, Coluna %d): %s\n", 
-                    token.line, token.column, token.lexeme);
-        } else if (token.type != TOK_EOF) {
-            printf("\033[1;33m%-15s\033[0m %-20s %-8d %-8d\n", 
-                   token_type_to_string(token.type), token.lexeme, 
-                   token.line, token.column);
-            fprintf(output_file, "%-15s %-20s %-8d %-8d\n", 
-                    token_type_to_string(token.type), token.lexeme, 
-                    token.line, token.column);
-        }
+        char path[PATH_MAX];
+        struct stat info;
+        snprintf(path, sizeof(path), "%s/%s", cache_dir, item->d_name);
+        if (stat(path, &info) != 0) continue;
         
-    } while (token.type != TOK_EOF);
-    
-    print_symbol_table(&lexer->symbol_table);
-    
-    fclose(output_file);
+        if (count == capacity) {
+            capacity *= 2;
+            files = mem_realloc(MEMORY_OUTPUT, files, capacity / 2 * sizeof(CacheFile), capacity * sizeof(CacheFile));
+        }
+        strcpy(files[count].name, item->d_name);
+        files[count].size = info.st_size;
+        files[count].used = info.st_mtime;
+        total += (uint64_t)info.st_size;
+        count++;
+    }
+    closedir(dir);
     
-    if (has_lexical_errors) {
-        printf("\nAnalise lexica concluida com \033[1;31mERROS!\033[0m\ncontinuando analise sintatica...\n");
-    } else {
-        printf("\n\033[1;32mAnalise lexica concluida com SUCESSO!\033[0m\n");
+    if (total > max_bytes) {
+        qsort(files, count, sizeof(CacheFile), compare_cache_files);
+        for (size_t i = 0; i < count && total > max_bytes; i++) {
+            if (keep != NULL && strcmp(files[i].name, keep) == 0) continue;
+            char path[PATH_MAX];
+            snprintf(path, sizeof(path), "%s/%s", cache_dir, files[i].name);
+            if (unlink(path) == 0) total -= (uint64_t)files[i].size;
+        }
     }
+    mem_free(MEMORY_OUTPUT, files, capacity * sizeof(CacheFile));
+}
+
+// Grava em arquivo temporario e renomeia: leitores concorrentes nunca veem
+// uma entrada pela metade. As secoes vao direto do transcript e dos arquivos
+// para o disco (writev), sem montar a entrada em memoria
+static void cache_store(const char* cache_dir, const char* key, const char* source_filename,
+                        AnalysisTranscript* transcript, int status) {
+    char tokens_filename[PATH_MAX];
+    char syntax_filename[PATH_MAX];
+    if (!output_name(tokens_filename, sizeof(tokens_filename), source_filename, options.binary ? ".bin" : ".lex") ||
+        !output_name(syntax_filename, sizeof(syntax_filename), source_filename, ".syntax")) return;
+    bool syntax_file_saved = !options.binary && transcript->syntax_saved;
     
-    printf("\n\033[1;35mTokens salvos em:\033[0m %s\n", output_filename);
+    // Entrada acima de --cache-max: nem le os arquivos
+    struct stat tokens_info, syntax_info;
+    uint64_t total = sizeof(CacheEntryHeader) + transcript->lexical_end + (transcript->syntax_end - transcript->syntax_start);
+    if (stat(tokens_filename, &tokens_info) != 0) return;
+    total += (uint64_t)tokens_info.st_size;
+    if (syntax_file_saved) {
+        if (stat(syntax_filename, &syntax_info) != 0) return;
+        total += (uint64_t)syntax_info.st_size;
+    }
+    if (total > options.cache_max_bytes) return;
     
-    printf("\n\t---- ANALISE SINTATICA ----\n");
+    size_t tokens_size = 0, syntax_size = 0;
+    char* tokens_file = read_file(tokens_filename, &tokens_size);
+    char* syntax_file = syntax_file_saved ? read_file(syntax_filename, &syntax_size) : NULL;
     
-    file = fopen(argv[1], "r");
-    if (!file) {
-        printf("Erro ao reabrir arquivo para analise sintatica: %s\n", argv[1]);
-        return 1;
+    CacheEntryHeader header;
+    struct iovec iov[1 + CACHE_SECTIONS] = {
+        { &header, sizeof(header) },
+        { transcript->log.data, transcript->lexical_end },
+        { transcript->log.data + transcript->syntax_start, transcript->syntax_end - transcript->syntax_start },
+        { tokens_file, tokens_size },
+        { syntax_file, syntax_size }
+    };
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.exit_code = status;
+    header.flags = transcript->syntax_saved ? CACHE_SYNTAX_SAVED : 0;
+    total = sizeof(header);
+    for (int i = 0; i < CACHE_SECTIONS; i++) {
+        header.section_size[i] = iov[1 + i].iov_len;
+        total += header.section_size[i];
     }
+    header.checksum = cache_checksum(iov + 1);
     
-    lexer = init_lexer(file, argv[1]);
-    global_lexer = lexer;
-    
-    current_token = get_next_token(lexer);
-    has_syntax_errors = 0;
+    if (tokens_file != NULL && (syntax_file != NULL || !syntax_file_saved) && total <= options.cache_max_bytes) {
+        char temporary_path[PATH_MAX];
+        char entry_path[PATH_MAX];
+        snprintf(temporary_path, sizeof(temporary_path), "%s/%s.tmp.%ld", cache_dir, key, (long)getpid());
+        snprintf(entry_path, sizeof(entry_path), "%s/%s.entry", cache_dir, key);
+        
+        int fd = open(temporary_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd >= 0) {
+            write_all(fd, iov, 1 + CACHE_SECTIONS);
+            bool written = lseek(fd, 0, SEEK_CUR) == (off_t)total;
+            if (close(fd) == 0 && written && rename(temporary_path, entry_path) == 0) {
+                cache_evict(cache_dir, options.cache_max_bytes, NULL);
+            } else {
+                unlink(temporary_path);
+            }
+        }
+    }
+    free_file(tokens_file, tokens_size);
+    free_file(syntax_file, syntax_size);
+}
+
+int analyze_with_cache(const char* source_filename, OutputBuffer* console) {
+    size_t size;
+    char* source = read_file(source_filename, &size);
+    if (source == NULL) return analyze_file(source_filename, console, NULL);
     
-    Program();
+    char key[40];
+    cache_key(source, size, key, sizeof(key));
+    free_file(source, size);
     
-    if (has_syntax_errors) {
-        printf("\n\033[1;31mAnalise sintatica concluida com ERROS!\033[0m\n");
-    } else {
-        printf("\n\033[1;32mAnalise sintatica concluida com SUCESSO!\033[0m\n");
+    mkdir(options.cache_dir, 0777);
+    char entry_path[PATH_MAX];
+    snprintf(entry_path, sizeof(entry_path), "%s/%s.entry", options.cache_dir, key);
+    
+    int status;
+    if (cache_replay(entry_path, source_filename, console, &status)) {
+        utime(entry_path, NULL);
+        cache_count(options.cache_dir, "acertos", console);
+        return status;
     }
+    cache_count(options.cache_dir, "falhas", console);
     
-    char syntax_filename[100];
-    snprintf(syntax_filename, sizeof(syntax_filename), "%s.syntax", argv[1]);
-    FILE* syntax_file = fopen(syntax_filename, "w");
+    AnalysisTranscript transcript;
+    memset(&transcript, 0, sizeof(transcript));
+    out_init(&transcript.log, OUT_MEMORY);
+    out_flush(console);
+    console->capture = &transcript.log;
     
-    if (syntax_file) {
-        int saved_stdout = dup(fileno(stdout));
-        freopen(syntax_filename, "w", stdout);
-        
-        rewind(file);
-        Lexer* syntax_lexer = init_lexer(file, argv[1]);
-        global_lexer = syntax_lexer;
-        current_token = get_next_token(syntax_lexer);
-        has_syntax_errors = 0;
-        
-        printf("=== SEQUENCIA DE REGRAS DE PRODUCAO ===\n");
-        Program();
+    status = analyze_file(source_filename, console, &transcript);
+    
+    out_flush(console);
+    // Sem capture a saida passou de --cache-max durante a analise
+    if (console->capture == NULL) transcript.complete = false;
+    console->capture = NULL;
+    if (transcript.complete) {
+        cache_store(options.cache_dir, key, source_filename, &transcript, status);
+    }
+    out_free(&transcript.log);
+    return status;
+}
+
+static off_t file_size_of(const char* cache_dir, const char* name) {
+    char path[PATH_MAX];
+    struct stat info;
+    snprintf(path, sizeof(path), "%s/%s", cache_dir, name);
+    return stat(path, &info) == 0 ? info.st_size : 0;
+}
+
+static uint64_t counter_of(const char* cache_dir, const char* name) {
+    char path[PATH_MAX];
+    uint64_t value = 0;
+    snprintf(path, sizeof(path), "%s/%s", cache_dir, name);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    if (flock(fd, LOCK_SH) != 0 || !read_counter(fd, &value)) value = 0;
+    close(fd);
+    return value;
+}
+
+void print_cache_stats(const char* cache_dir) {
+    long long entries = 0, bytes = 0;
+    DIR* dir = opendir(cache_dir);
+    if (dir != NULL) {
+        struct dirent* item;
+        while ((item = readdir(dir)) != NULL) {
+            if (!is_cache_file(item->d_name)) continue;
+            entries++;
+            bytes += file_size_of(cache_dir, item->d_name);
+        }
+        closedir(dir);
+    }
+    printf("Cache: %s\n", cache_dir);
+    printf("  acertos:  %llu\n", (unsigned long long)counter_of(cache_dir, "acertos"));
+    printf("  falhas:   %llu\n", (unsigned long long)counter_of(cache_dir, "falhas"));
+    printf("  entradas: %lld (%lld bytes)\n", entries, bytes);
+}
+
+int analyze_file(const char* source_filename, OutputBuffer* console, AnalysisTranscript* transcript) {
+    char output_filename[PATH_MAX];
+    char syntax_filename[PATH_MAX];
+    if (!output_name(output_filename, sizeof(output_filename), source_filename, options.binary ? ".bin" : ".lex") ||
+        !output_name(syntax_filename, sizeof(syntax_filename), source_filename, ".syntax")) {
+        out_literal(console, "Caminho longo demais para os arquivos de saida: ");
+        out_str(console, source_filename);
+        out_char(console, '\n');
+        return 1;
+    }
+    out_literal(console, "\t\t--- ANALISE LEXICA ---\n");
+    
+    double phase_start = monotonic_seconds();
+    int file = open(source_filename, O_RDONLY);
+    if (file < 0) {
+        out_literal(console, "Erro ao abrir arquivo: ");
+        out_str(console, source_filename);
+        out_char(console, '\n');
+        return 1;
+    }
+    
+    Interner* interner = memory_outputs != NULL ? memory_outputs->interner : NULL;
+    Lexer* lexer = init_lexer(file, source_filename, interner);
+    
+    BinaryWriter binary_writer;
+    int output_fd = -1;
+    OutputBuffer* output_file = &lex_output;
+    
+    if (options.binary) {
+        init_binary_writer(&binary_writer);
+    } else if (memory_outputs != NULL) {
+        output_file = &memory_outputs->lex;
+        out_init(output_file, OUT_MEMORY);
+        write_lex_header(output_file);
+    } else {
+        output_fd = open(output_filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
         
-        fflush(stdout);
-        dup2(saved_stdout, fileno(stdout));
-        close(saved_stdout);
+        if (output_fd < 0) {
+            out_literal(console, "Erro ao criar arquivo de saida\n");
+                free_lexer(lexer);
+            return 1;
+        }
+        out_init(output_file, output_fd);
+        write_lex_header(output_file);
+    }
+    
+    out_literal(console, "\t   === TOKENS RECONHECIDOS ===\n");
+    out_literal(console, "TOKEN           LEXEMA             LINHA    COLUNA  \n");
+    out_literal(console, "------------------------------------------------\n");
+
+    Token token;
+    int has_lexical_errors = 0;
+    
+    do {
+        token = get_next_token(lexer);
         
-        fclose(syntax_file);
-        free_lexer(syntax_lexer);
+        if (token.type == TOK_EOF) break;
+        if (token.type == TOK_ERROR) has_lexical_errors = 1;
+        STAT_ADD(tokens[token.type], 1);
+        if (memory_outputs != NULL) memory_outputs->tokens++;
         
-        printf("\n\033[1;35mRegras de producao salvas em:\033[0m %s\n", syntax_filename);
+        write_console_entry(console, token.type, token.lexeme, token.line, token.column);
+        if (options.binary) {
+            binary_add_token(&binary_writer, &token);
+        } else {
+            write_lex_entry(output_file, token.type, token.lexeme, token.line, token.column);
+        }
+    } while (token.type != TOK_EOF);
+    
+    print_symbol_table(console, &lexer->symbol_table);
+    
+    if (options.binary) {
+        binary_use_symbol_order(&binary_writer, &lexer->symbol_table);
+    } else if (memory_outputs != NULL) {
+        memory_outputs->symbols = lexer->symbol_table;
+        memset(&lexer->symbol_table, 0, sizeof(lexer->symbol_table));
+    } else {
+        out_flush(output_file);
+        close(output_fd);
+        out_free(output_file);
+    }
+    free_lexer(lexer);
+    stats.phase_seconds[STATS_PHASE_LEXICAL] += monotonic_seconds() - phase_start;
+    
+    if (has_lexical_errors) {
+        out_literal(console, "\nAnalise lexica concluida com \033[1;31mERROS!\033[0m\ncontinuando analise sintatica...\n");
+    } else {
+        out_literal(console, "\n\033[1;32mAnalise lexica concluida com SUCESSO!\033[0m\n");
+    }
+    
+    if (transcript != NULL) transcript->lexical_end = out_position(console);
+    out_literal(console, "\n\033[1;35mTokens salvos em:\033[0m ");
+    out_str(console, output_filename);
+    out_char(console, '\n');
+    
+    if (transcript != NULL) transcript->syntax_start = out_position(console);
+    out_literal(console, "\n\t---- ANALISE SINTATICA ----\n");
+    
+    file = open(source_filename, O_RDONLY);
+    if (file < 0) {
+        out_literal(console, "Erro ao reabrir arquivo para analise sintatica: ");
+        out_str(console, source_filename);
+        out_char(console, '\n');
+        return 1;
     }
     
+    // O .syntax sai na mesma passada: o rastro vai para o terminal e para o arquivo
+    int syntax_fd = -1;
+    if (!options.binary && !options.no_trace) {
+        if (memory_outputs != NULL) {
+            trace_file = &memory_outputs->syntax;
+            out_init(trace_file, OUT_MEMORY);
+        } else if ((syntax_fd = open(syntax_filename, O_WRONLY | O_CREAT | O_TRUNC, 0666)) >= 0) {
+            out_init(&syntax_output, syntax_fd);
+            trace_file = &syntax_output;
+        }
+        if (trace_file != NULL) out_literal(trace_file, "=== SEQUENCIA DE REGRAS DE PRODUCAO ===\n");
+    }
+    
+    phase_start = monotonic_seconds();
+    lexer = init_lexer(file, source_filename, interner);
+    parser_output = console;
+    // No modo binario a sequencia de producoes e gravada ja nesta passada
+    binary_output = options.binary ? &binary_writer : NULL;
+    run_parser(lexer);
+    binary_output = NULL;
+    trace_file = NULL;
     free_lexer(lexer);
+    stats.phase_seconds[STATS_PHASE_PARSE] += monotonic_seconds() - phase_start;
+    
+    if (has_syntax_errors) {
+        out_literal(console, "\n\033[1;31mAnalise sintatica concluida com ERROS!\033[0m\n");
+    } else {
+        out_literal(console, "\n\033[1;32mAnalise sintatica concluida com SUCESSO!\033[0m\n");
+    }
+    if (transcript != NULL) transcript->syntax_end = out_position(console);
+    
+    if (options.binary) {
+        phase_start = monotonic_seconds();
+        int binary_status = write_binary_file(&binary_writer, output_filename);
+        stats.phase_seconds[STATS_PHASE_SYNTAX_FILE] += monotonic_seconds() - phase_start;
+        if (binary_status == 0) {
+            if (transcript != NULL) transcript->syntax_saved = true;
+            out_literal(console, "\n\033[1;35mRegras de producao salvas em:\033[0m ");
+            out_str(console, output_filename);
+            out_char(console, '\n');
+        } else {
+            out_literal(console, "Erro ao criar arquivo de saida\n");
+        }
+        free_binary_writer(&binary_writer);
+        if (transcript != NULL) transcript->complete = transcript->syntax_saved;
+        return has_syntax_errors || has_lexical_errors;
+    }
+    
+    if (syntax_fd >= 0) {
+        phase_start = monotonic_seconds();
+        out_flush(&syntax_output);
+        close(syntax_fd);
+        out_free(&syntax_output);
+        stats.phase_seconds[STATS_PHASE_SYNTAX_FILE] += monotonic_seconds() - phase_start;
+        
+        if (transcript != NULL) transcript->syntax_saved = true;
+        out_literal(console, "\n\033[1;35mRegras de producao salvas em:\033[0m ");
+        out_str(console, syntax_filename);
+        out_char(console, '\n');
+    }
+    
+    if (transcript != NULL) transcript->complete = true;
     return has_syntax_errors || has_lexical_errors;
-}
\ No newline at end of file
+}
+
+// Entrada sem tamanho conhecido (stdin, pipe, FIFO): uma unica passada com
+// memoria limitada. O terminal recebe os tokens e os erros sintaticos na
+// ordem em que aparecem; as producoes vao apenas para o .syntax
+int analyze_stream(const char* source_filename, OutputBuffer* console) {
+    const char* base = options.output_base;
+    int source = strcmp(source_filename, "-") == 0 ? dup(STDIN_FILENO) : open(source_filename, O_RDONLY);
+    
+    if (base == NULL) base = strcmp(source_filename, "-") == 0 ? "stdin" : source_filename;
+    if (source < 0) {
+        out_literal(console, "Erro ao abrir arquivo: ");
+        out_str(console, source_filename);
+        out_char(console, '\n');
+        return 1;
+    }
+    
+    char lex_filename[PATH_MAX];
+    char syntax_filename[PATH_MAX];
+    snprintf(lex_filename, sizeof(lex_filename), "%s.lex", base);
+    snprintf(syntax_filename, sizeof(syntax_filename), "%s.syntax", base);
+    int lex_fd = open(lex_filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    int syntax_fd = options.no_trace ? -2 : open(syntax_filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    
+    if (lex_fd < 0 || syntax_fd == -1) {
+        out_literal(console, "Erro ao criar arquivo de saida\n");
+        if (lex_fd >= 0) close(lex_fd);
+        if (syntax_fd >= 0) close(syntax_fd);
+        close(source);
+        return 1;
+    }
+    
+    out_init(&lex_output, lex_fd);
+    write_lex_header(&lex_output);
+    if (syntax_fd >= 0) {
+        out_init(&syntax_output, syntax_fd);
+        out_literal(&syntax_output, "=== SEQUENCIA DE REGRAS DE PRODUCAO ===\n");
+    }
+    
+    out_literal(console, "\t\t--- ANALISE LEXICA ---\n");
+    out_literal(console, "\t   === TOKENS RECONHECIDOS ===\n");
+    out_literal(console, "TOKEN           LEXEMA             LINHA    COLUNA  \n");
+    out_literal(console, "------------------------------------------------\n");
+    
+    // Sem o pipeline: ShowError precisa do historico do lexer, que a outra
+    // thread estaria sobrescrevendo
+    options.pipeline = false;
+    double phase_start = monotonic_seconds();
+    Lexer* lexer = init_lexer(source, base, NULL);
+    TokenTap tap = { console, &lex_output, false };
+    token_tap = &tap;
+    parser_output = syntax_fd >= 0 ? &syntax_output : NULL;
+    run_parser(lexer);
+    parser_output = console;
+    token_tap = NULL;
+    
+    print_symbol_table(console, &lexer->symbol_table);
+    free_lexer(lexer);
+    out_flush(&lex_output);
+    close(lex_fd);
+    out_free(&lex_output);
+    if (syntax_fd >= 0) {
+        out_flush(&syntax_output);
+        close(syntax_fd);
+        out_free(&syntax_output);
+    }
+    stats.phase_seconds[STATS_PHASE_STREAM] += monotonic_seconds() - phase_start;
+    
+    if (tap.has_errors) {
+        out_literal(console, "\nAnalise lexica concluida com \033[1;31mERROS!\033[0m\n");
+    } else {
+        out_literal(console, "\n\033[1;32mAnalise lexica concluida com SUCESSO!\033[0m\n");
+    }
+    out_literal(console, "\n\033[1;35mTokens salvos em:\033[0m ");
+    out_str(console, lex_filename);
+    out_char(console, '\n');
+    
+    out_literal(console, "\n\t---- ANALISE SINTATICA ----\n");
+    if (has_syntax_errors) {
+        out_literal(console, "\n\033[1;31mAnalise sintatica concluida com ERROS!\033[0m\n");
+    } else {
+        out_literal(console, "\n\033[1;32mAnalise sintatica concluida com SUCESSO!\033[0m\n");
+    }
+    if (syntax_fd >= 0) {
+        out_literal(console, "\n\033[1;35mRegras de producao salvas em:\033[0m ");
+        out_str(console, syntax_filename);
+        out_char(console, '\n');
+    }
+    
+    return has_syntax_errors || tap.has_errors;
+}
+
+// Arvore de execucao: uma segunda leitura do arquivo ja aceito pelo parser,
+// entao aqui nao ha erro sintatico a tratar. Os limites sao o aninhamento
+// e a altura das expressoes (recursao em C) e variaveis usadas sem declaracao
+typedef struct {
+    Lexer* lexer;
+    Token token;
+    ProgramTree* tree;
+    int depth;
+    bool failed;
+    int64_t error_line;
+    char error[160];
+    // Fim do ultimo token consumido: o fim do trecho de cada no
+    int64_t end_line;
+    int64_t end_column;
+} TreeBuilder;
+
+// Token.line/column sao a posicao antes dos espacos que precedem o token;
+// pulando os espacos antes, o perfil mostra onde cada comando comeca
+static void builder_advance(TreeBuilder* builder) {
+    builder->end_line = builder->token.line;
+    builder->end_column = builder->token.column + (int64_t)strlen(builder->token.lexeme) - 1;
+    skip_whitespace(builder->lexer);
+    builder->token = get_next_token(builder->lexer);
+}
+
+static void builder_fail(TreeBuilder* builder, const char* message, const char* detail) {
+    if (builder->failed) return;
+    builder->failed = true;
+    builder->error_line = builder->token.line;
+    snprintf(builder->error, sizeof(builder->error), "%s%s", message, detail);
+}
+
+static void* grow_array(void* data, int32_t count, int32_t* capacity, size_t item_size) {
+    if (count < *capacity) return data;
+    size_t old_size = (size_t)*capacity * item_size;
+    *capacity = *capacity == 0 ? 64 : *capacity * 2;
+    return mem_realloc(MEMORY_PARSE, data, old_size, (size_t)*capacity * item_size);
+}
+
+static int32_t add_expression(ProgramTree* tree, ExpressionKind kind) {
+    int32_t capacity = tree->expression_capacity;
+    tree->expressions = grow_array(tree->expressions, tree->expression_count, &tree->expression_capacity, sizeof(ExpressionNode));
+    if (tree->expression_capacity != capacity) {
+        tree->expression_spans = mem_realloc(MEMORY_PARSE, tree->expression_spans, (size_t)capacity * sizeof(SourceSpan),
+                                             (size_t)tree->expression_capacity * sizeof(SourceSpan));
+    }
+    ExpressionNode* node = &tree->expressions[tree->expression_count];
+    memset(node, 0, sizeof(*node));
+    node->kind = kind;
+    node->left = node->right = node->variable = -1;
+    node->height = 1;
+    return tree->expression_count++;
+}
+
+static int32_t add_statement(ProgramTree* tree, StatementKind kind, int32_t parent, const Token* token) {
+    tree->statements = grow_array(tree->statements, tree->statement_count, &tree->statement_capacity, sizeof(StatementNode));
+    StatementNode* node = &tree->statements[tree->statement_count];
+    node->kind = kind;
+    node->parent = parent;
+    node->next = node->variable = node->expression = node->body = node->alternative = node->loop = -1;
+    node->line = node->end_line = token->line;
+    node->column = node->end_column = token->column;
+    return tree->statement_count++;
+}
+
+// O no vai de start ate o fim do ultimo token consumido
+static int32_t builder_span(TreeBuilder* builder, int32_t node, const Token* start) {
+    if (node < 0) return node;
+    SourceSpan* span = &builder->tree->expression_spans[node];
+    span->line = start->line;
+    span->column = start->column;
+    span->end_line = builder->end_line;
+    span->end_column = builder->end_column;
+    return node;
+}
+
+static int32_t declare_variable(ProgramTree* tree, const char* name) {
+    for (int32_t i = 0; i < tree->variable_count; i++) {
+        if (strcmp(tree->variables[i].name, name) == 0) return i;
+    }
+    tree->variables = grow_array(tree->variables, tree->variable_count, &tree->variable_capacity, sizeof(ProgramVariable));
+    ProgramVariable* variable = &tree->variables[tree->variable_count];
+    snprintf(variable->name, sizeof(variable->name), "%s", name);
+    variable->real = false;
+    variable->declared = false;
+    return tree->variable_count++;
+}
+
+static int32_t builder_variable(TreeBuilder* builder) {
+    int32_t variable = declare_variable(builder->tree, builder->token.lexeme);
+    if (!builder->tree->variables[variable].declared) builder_fail(builder, "variavel nao declarada: ", builder->token.lexeme);
+    builder_advance(builder);
+    return variable;
+}
+
+static int32_t build_expression(TreeBuilder* builder);
+
+// Uma cadeia a + b + c ... sem parenteses tambem aprofunda a arvore (um
+// nivel por operando), e evaluate/emit_c_expression recursam nela
+static int32_t builder_height(TreeBuilder* builder, int32_t node) {
+    ExpressionNode* expressions = builder->tree->expressions;
+    const ExpressionNode* expression = &expressions[node];
+    int32_t left = expression->left >= 0 ? expressions[expression->left].height : 0;
+    int32_t right = expression->right >= 0 ? expressions[expression->right].height : 0;
+    expressions[node].height = 1 + (left > right ? left : right);
+    if (expressions[node].height > EXECUTION_MAX_DEPTH) builder_fail(builder, "aninhamento grande demais para executar", "");
+    return node;
+}
+
+static int32_t build_binary(TreeBuilder* builder, TokenType op, int32_t left, int32_t right) {
+    if (left < 0 || right < 0) return -1;
+    int32_t node = add_expression(builder->tree, EXPR_BINARY);
+    builder->tree->expressions[node].op = op;
+    builder->tree->expressions[node].left = left;
+    builder->tree->expressions[node].right = right;
+    return builder_height(builder, node);
+}
+
+// fator -> variavel | numero | ( expressao )
+static int32_t build_factor(TreeBuilder* builder) {
+    ProgramTree* tree = builder->tree;
+    Token start = builder->token;
+    int32_t node = -1;
+
+    switch (builder->token.type) {
+        case ID:
+            node = add_expression(tree, EXPR_VARIABLE);
+            tree->expressions[node].variable = builder_variable(builder);
+            return builder_span(builder, node, &start);
+        case LIT_INT:
+            node = add_expression(tree, EXPR_INTEGER);
+            tree->expressions[node].integer = builder->token.integer;
+            break;
+        case LIT_REAL:
+        case LIT_REAL_EXP:
+            node = add_expression(tree, EXPR_REAL);
+            tree->expressions[node].real = builder->token.real;
+            break;
+        case SMB_OPA:
+            if (++builder->depth > EXECUTION_MAX_DEPTH) {
+                builder_fail(builder, "aninhamento grande demais para executar", "");
+                return -1;
+            }
+            builder_advance(builder);
+            node = build_expression(builder);
+            builder->depth--;
+            // O trecho da expressao entre parenteses nao inclui os parenteses
+            builder_advance(builder);
+            return node;
+        default:
+            builder_fail(builder, "fator inesperado: ", builder->token.lexeme);
+            return -1;
+    }
+    builder_advance(builder);
+    return builder_span(builder, node, &start);
+}
+
+// termo -> fator { (* | / | mod) fator }
+static int32_t build_term(TreeBuilder* builder) {
+    Token start = builder->token;
+    int32_t node = build_factor(builder);
+    while (!builder->failed && (builder->token.type == OP_MUL || builder->token.type == OP_DIV || builder->token.type == OP_MOD)) {
+        TokenType op = builder->token.type;
+        builder_advance(builder);
+        int32_t right = build_factor(builder);
+        node = builder_span(builder, build_binary(builder, op, node, right), &start);
+    }
+    return node;
+}
+
+// expressao_simples -> [+ | -] termo { (+ | -) termo }; o sinal vale para o
+// primeiro termo inteiro (-a * b = -(a * b))
+static int32_t build_simple_expression(TreeBuilder* builder) {
+    Token start = builder->token;
+    TokenType sign = builder->token.type;
+    if (sign == OP_AD || sign == OP_MIN) builder_advance(builder);
+
+    int32_t node = build_term(builder);
+    if (sign == OP_MIN && !builder->failed) {
+        int32_t negate = add_expression(builder->tree, EXPR_NEGATE);
+        builder->tree->expressions[negate].left = node;
+        node = builder_span(builder, builder_height(builder, negate), &start);
+    }
+    while (!builder->failed && (builder->token.type == OP_AD || builder->token.type == OP_MIN)) {
+        TokenType op = builder->token.type;
+        builder_advance(builder);
+        int32_t right = build_term(builder);
+        node = builder_span(builder, build_binary(builder, op, node, right), &start);
+    }
+    return node;
+}
+
+// expressao -> expressao_simples [ relacao expressao_simples ]
+static int32_t build_expression(TreeBuilder* builder) {
+    Token start = builder->token;
+    int32_t node = build_simple_expression(builder);
+    if (!builder->failed && operator_power(builder->token.type) == 1) {
+        TokenType op = builder->token.type;
+        builder_advance(builder);
+        int32_t right = build_simple_expression(builder);
+        node = builder_span(builder, build_binary(builder, op, node, right), &start);
+    }
+    return node;
+}
+
+static int32_t build_statement(TreeBuilder* builder, int32_t parent);
+
+// comando_composto -> begin comando ; { comando ; } end
+static int32_t build_compound(TreeBuilder* builder, int32_t parent) {
+    ProgramTree* tree = builder->tree;
+    int32_t id = add_statement(tree, STMT_COMPOUND, parent, &builder->token);
+    int32_t last = -1;
+
+    builder_advance(builder);
+    while (!builder->failed && builder->token.type != TOK_END) {
+        if (builder->token.type == SMB_SEM) {
+            builder_advance(builder);
+            continue;
+        }
+        int32_t child = build_statement(builder, id);
+        if (child < 0) break;
+        if (last < 0) tree->statements[id].body = child;
+        else tree->statements[last].next = child;
+        last = child;
+    }
+    builder_advance(builder);
+    return id;
+}
+
+static int32_t build_statement(TreeBuilder* builder, int32_t parent) {
+    ProgramTree* tree = builder->tree;
+    int32_t id = -1;
+
+    if (builder->failed) return -1;
+    if (++builder->depth > EXECUTION_MAX_DEPTH) {
+        builder_fail(builder, "aninhamento grande demais para executar", "");
+        return -1;
+    }
+
+    switch (builder->token.type) {
+        case ID: {
+            id = add_statement(tree, STMT_ASSIGNMENT, parent, &builder->token);
+            int32_t variable = builder_variable(builder);
+            builder_advance(builder);
+            int32_t expression = build_expression(builder);
+            tree->statements[id].variable = variable;
+            tree->statements[id].expression = expression;
+            break;
+        }
+        case TOK_BEGIN:
+            id = build_compound(builder, parent);
+            break;
+        case TOK_IF: {
+            id = add_statement(tree, STMT_CONDITIONAL, parent, &builder->token);
+            builder_advance(builder);
+            int32_t condition = build_expression(builder);
+            builder_advance(builder);
+            int32_t then_branch = build_statement(builder, id);
+            int32_t else_branch = -1;
+            if (!builder->failed && builder->token.type == TOK_ELSE) {
+                builder_advance(builder);
+                else_branch = build_statement(builder, id);
+            }
+            tree->statements[id].expression = condition;
+            tree->statements[id].body = then_branch;
+            tree->statements[id].alternative = else_branch;
+            break;
+        }
+        case TOK_WHILE: {
+            id = add_statement(tree, STMT_REPETITIVE, parent, &builder->token);
+            builder_advance(builder);
+            int32_t condition = build_expression(builder);
+            builder_advance(builder);
+            int32_t body = build_statement(builder, id);
+            tree->statements[id].expression = condition;
+            tree->statements[id].body = body;
+            break;
+        }
+        default:
+            builder_fail(builder, "comando inesperado: ", builder->token.lexeme);
+            break;
+    }
+    builder->depth--;
+    if (builder->failed) return -1;
+    tree->statements[id].end_line = builder->end_line;
+    tree->statements[id].end_column = builder->end_column;
+    return id;
+}
+
+// program ID ; [var lista : tipo ; ...] comando_composto .
+static void build_declarations(TreeBuilder* builder) {
+    ProgramTree* tree = builder->tree;
+    if (builder->token.type != TOK_VAR) return;
+    builder_advance(builder);
+
+    int32_t* names = NULL;
+    int32_t capacity = 0;
+    while (builder->token.type == ID) {
+        int32_t count = 0;
+        while (builder->token.type == ID) {
+            names = grow_array(names, count, &capacity, sizeof(int32_t));
+            names[count] = declare_variable(tree, builder->token.lexeme);
+            ProgramVariable* variable = &tree->variables[names[count++]];
+            if (!variable->declared) {
+                variable->span.line = variable->span.end_line = builder->token.line;
+                variable->span.column = builder->token.column;
+                variable->span.end_column = builder->token.column + (int64_t)strlen(builder->token.lexeme) - 1;
+            }
+            builder_advance(builder);
+            if (builder->token.type == SMB_COM) builder_advance(builder);
+        }
+        builder_advance(builder);
+        for (int32_t i = 0; i < count; i++) {
+            tree->variables[names[i]].real = builder->token.type == TOK_REAL;
+            tree->variables[names[i]].declared = true;
+        }
+        builder_advance(builder);
+        if (builder->token.type == SMB_SEM) builder_advance(builder);
+    }
+    mem_free(MEMORY_PARSE, names, (size_t)capacity * sizeof(int32_t));
+}
+
+// Analise dos lacos contados. Os comandos estao em pre-ordem (pai antes dos
+// filhos, cada subarvore contigua), entao o corpo de um while s sao os ids
+// de s + 1 ate o fim da subarvore
+// Voltas por bloco em LOOP_BATCHED e profundidade maxima das expressoes
+// avaliadas em faixas (cada nivel usa LOOP_LANES valores na pilha)
+#define LOOP_LANES 64
+#define LOOP_LANE_DEPTH 32
+
+// Grau da expressao em v, ou -1 se ela nao pode ser avaliada fora de ordem:
+// le real, usa /, mod ou relacional, ou le outra variavel que o corpo altera
+// (fora v e o alvo da propria acumulacao, que conta como 0)
+static int32_t loop_degree(const ProgramTree* tree, int32_t id, int32_t induction, int32_t target,
+                           const uint32_t* writes, int32_t depth) {
+    const ExpressionNode* node = &tree->expressions[id];
+    if (depth > LOOP_LANE_DEPTH) return -1;
+    switch (node->kind) {
+        case EXPR_INTEGER:
+            return 0;
+        case EXPR_REAL:
+            return -1;
+        case EXPR_VARIABLE:
+            if (tree->variables[node->variable].real) return -1;
+            if (node->variable == induction) return 1;
+            if (node->variable == target) return 0;
+            return writes[node->variable] > 0 ? -1 : 0;
+        case EXPR_NEGATE:
+            return loop_degree(tree, node->left, induction, target, writes, depth + 1);
+        case EXPR_BINARY:
+            break;
+    }
+    if (node->op != OP_AD && node->op != OP_MIN && node->op != OP_MUL) return -1;
+    int32_t left = loop_degree(tree, node->left, induction, target, writes, depth + 1);
+    int32_t right = loop_degree(tree, node->right, induction, target, writes, depth + 1);
+    if (left < 0 || right < 0) return -1;
+    if (node->op == OP_MUL) return left + right < 64 ? left + right : 64;
+    return left > right ? left : right;
+}
+
+static int32_t count_reads(const ProgramTree* tree, int32_t id, int32_t variable) {
+    const ExpressionNode* node = &tree->expressions[id];
+    switch (node->kind) {
+        case EXPR_VARIABLE: return node->variable == variable;
+        case EXPR_NEGATE: return count_reads(tree, node->left, variable);
+        case EXPR_BINARY: return count_reads(tree, node->left, variable) + count_reads(tree, node->right, variable);
+        default: return 0;
+    }
+}
+
+// t so entra somando: caminho da raiz ate t so por '+' e lado esquerdo de '-'
+static bool additive_read(const ProgramTree* tree, int32_t id, int32_t variable) {
+    const ExpressionNode* node = &tree->expressions[id];
+    if (node->kind == EXPR_VARIABLE) return node->variable == variable;
+    if (node->kind != EXPR_BINARY) return false;
+    if (node->op == OP_AD) return additive_read(tree, node->left, variable) || additive_read(tree, node->right, variable);
+    return node->op == OP_MIN && additive_read(tree, node->left, variable);
+}
+
+// v op limite com v integer e limite literal ou variavel integer fora de writes
+static bool loop_condition(const ProgramTree* tree, const StatementNode* node, const uint32_t* writes, CountedLoop* loop) {
+    const ExpressionNode* condition = &tree->expressions[node->expression];
+    if (condition->kind != EXPR_BINARY) return false;
+    if (condition->op != OP_LT && condition->op != OP_LE && condition->op != OP_GT && condition->op != OP_GE &&
+        condition->op != OP_NE) {
+        return false;
+    }
+    const ExpressionNode* left = &tree->expressions[condition->left];
+    const ExpressionNode* right = &tree->expressions[condition->right];
+    if (left->kind != EXPR_VARIABLE || tree->variables[left->variable].real) return false;
+    if (right->kind == EXPR_VARIABLE) {
+        if (tree->variables[right->variable].real || right->variable == left->variable || writes[right->variable] > 0) return false;
+    } else if (right->kind != EXPR_INTEGER) {
+        return false;
+    }
+    loop->variable = left->variable;
+    loop->op = condition->op;
+    loop->limit = condition->right;
+    return true;
+}
+
+// v := v + k, k + v ou v - k com k literal diferente de zero
+static bool loop_induction(const ProgramTree* tree, const StatementNode* node, int32_t variable, int64_t* step) {
+    if (node->kind != STMT_ASSIGNMENT || node->variable != variable) return false;
+    const ExpressionNode* value = &tree->expressions[node->expression];
+    if (value->kind != EXPR_BINARY || (value->op != OP_AD && value->op != OP_MIN)) return false;
+    const ExpressionNode* left = &tree->expressions[value->left];
+    const ExpressionNode* right = &tree->expressions[value->right];
+    if (left->kind == EXPR_VARIABLE && left->variable == variable && right->kind == EXPR_INTEGER) {
+        if (right->integer == 0 || (value->op == OP_MIN && right->integer == INT64_MIN)) return false;
+        *step = value->op == OP_AD ? right->integer : -right->integer;
+        return true;
+    }
+    if (value->op == OP_AD && right->kind == EXPR_VARIABLE && right->variable == variable && left->kind == EXPR_INTEGER) {
+        *step = left->integer;
+        return *step != 0;
+    }
+    return false;
+}
+
+// Classifica o corpo de um laco contado (loop->kind e as atribuicoes)
+static void classify_loop_body(ProgramTree* tree, CountedLoop* loop, const uint32_t* writes) {
+    const StatementNode* body = &tree->statements[tree->statements[loop->statement].body];
+    int32_t first = body->kind == STMT_COMPOUND ? body->body : tree->statements[loop->statement].body;
+    int32_t count = 0;
+    bool batched = true, closed = true, after = false;
+
+    for (int32_t child = first; child >= 0; child = body->kind == STMT_COMPOUND ? tree->statements[child].next : -1) {
+        if (tree->statements[child].kind != STMT_ASSIGNMENT) return;
+        count++;
+    }
+    loop->kind = LOOP_STRAIGHT;
+    loop->first_assignment = tree->loop_assignment_count;
+    loop->assignment_count = count;
+    loop->steps_per_iteration = (uint32_t)count + (body->kind == STMT_COMPOUND);
+
+    for (int32_t child = first; child >= 0; child = body->kind == STMT_COMPOUND ? tree->statements[child].next : -1) {
+        const StatementNode* node = &tree->statements[child];
+        int32_t target = node->variable;
+        tree->loop_assignments = grow_array(tree->loop_assignments, tree->loop_assignment_count,
+                                            &tree->loop_assignment_capacity, sizeof(LoopAssignment));
+        LoopAssignment* assignment = &tree->loop_assignments[tree->loop_assignment_count++];
+        assignment->statement = child;
+        assignment->after_induction = after;
+        assignment->degree = -1;
+
+        if (target == loop->variable) {
+            assignment->role = LOOP_INDUCTION;
+            after = true;
+            continue;
+        }
+        assignment->role = LOOP_OTHER;
+        if (!tree->variables[target].real && writes[target] == 1) {
+            int32_t reads = count_reads(tree, node->expression, target);
+            if (reads == 0) assignment->role = LOOP_SET;
+            else if (reads == 1 && additive_read(tree, node->expression, target)) assignment->role = LOOP_ACCUMULATE;
+            if (assignment->role != LOOP_OTHER) {
+                assignment->degree = loop_degree(tree, node->expression, loop->variable, target, writes, 0);
+                if (assignment->degree < 0) assignment->role = LOOP_OTHER;
+            }
+        }
+        if (assignment->role == LOOP_OTHER) batched = closed = false;
+        if (assignment->role == LOOP_ACCUMULATE && assignment->degree > 1) closed = false;
+    }
+    if (closed) loop->kind = LOOP_CLOSED;
+    else if (batched) loop->kind = LOOP_BATCHED;
+}
+
+void analyze_loops(ProgramTree* tree) {
+    int32_t count = tree->statement_count;
+    int32_t* subtree_end = mem_alloc(MEMORY_PARSE, sizeof(int32_t) * ((size_t)count + 1));
+    uint32_t* writes = mem_calloc(MEMORY_PARSE, (size_t)tree->variable_count + 1, sizeof(uint32_t));
+
+    for (int32_t id = 0; id < count; id++) subtree_end[id] = id + 1;
+    for (int32_t id = count - 1; id >= 0; id--) {
+        int32_t parent = tree->statements[id].parent;
+        if (parent >= 0 && subtree_end[id] > subtree_end[parent]) subtree_end[parent] = subtree_end[id];
+    }
+
+    for (int32_t id = 0; id < count; id++) {
+        StatementNode* node = &tree->statements[id];
+        if (node->kind != STMT_REPETITIVE || node->body < 0) continue;
+        for (int32_t child = id + 1; child < subtree_end[id]; child++) {
+            if (tree->statements[child].kind == STMT_ASSIGNMENT) writes[tree->statements[child].variable]++;
+        }
+
+        CountedLoop loop = { 0 };
+        loop.statement = id;
+        loop.first_assignment = -1;
+        if (loop_condition(tree, node, writes, &loop) && writes[loop.variable] == 1) {
+            // A unica escrita de v tem que ser o passo, no nivel de cima do corpo
+            const StatementNode* body = &tree->statements[node->body];
+            int32_t first = body->kind == STMT_COMPOUND ? body->body : node->body;
+            bool found = false;
+            for (int32_t child = first; child >= 0 && !found; child = body->kind == STMT_COMPOUND ? tree->statements[child].next : -1) {
+                found = loop_induction(tree, &tree->statements[child], loop.variable, &loop.step);
+            }
+            if (found) {
+                loop.kind = LOOP_COUNTED;
+                classify_loop_body(tree, &loop, writes);
+                tree->loops = grow_array(tree->loops, tree->loop_count, &tree->loop_capacity, sizeof(CountedLoop));
+                tree->loops[tree->loop_count] = loop;
+                node->loop = tree->loop_count++;
+            }
+        }
+
+        for (int32_t child = id + 1; child < subtree_end[id]; child++) {
+            if (tree->statements[child].kind == STMT_ASSIGNMENT) writes[tree->statements[child].variable] = 0;
+        }
+    }
+    mem_free(MEMORY_PARSE, subtree_end, sizeof(int32_t) * ((size_t)count + 1));
+    mem_free(MEMORY_PARSE, writes, ((size_t)tree->variable_count + 1) * sizeof(uint32_t));
+}
+
+// Numero de voltas de v op limite com v somando step a cada volta; false
+// se o laco nao termina ou v estouraria o int64 antes do fim (ai o laco
+// normal reproduz o estouro modular)
+static bool loop_trip_count(const CountedLoop* loop, int64_t start, int64_t limit, uint64_t* trips) {
+    __int128 from = start, to = limit, step = loop->step, count = 0;
+    bool up = step > 0;
+
+    switch (loop->op) {
+        case OP_LT: if (from < to) count = up ? (to - from + step - 1) / step : -1; break;
+        case OP_LE: if (from <= to) count = up ? (to - from) / step + 1 : -1; break;
+        case OP_GT: if (from > to) count = up ? -1 : (from - to - step - 1) / -step; break;
+        case OP_GE: if (from >= to) count = up ? -1 : (from - to) / -step + 1; break;
+        case OP_NE:
+            if (from != to) count = (to - from) % step == 0 && (to - from) / step > 0 ? (to - from) / step : -1;
+            break;
+        default: return false;
+    }
+    if (count < 0) return false;
+    __int128 last = from + count * step;
+    if (last > INT64_MAX || last < INT64_MIN) return false;
+    *trips = (uint64_t)count;
+    return true;
+}
+
+bool build_program_tree(const char* source_filename, ProgramTree* tree, TreeBuilder* builder) {
+    memset(tree, 0, sizeof(*tree));
+    memset(builder, 0, sizeof(*builder));
+    tree->body = -1;
+
+    int file = open(source_filename, O_RDONLY);
+    if (file < 0) {
+        builder_fail(builder, "erro ao reabrir arquivo: ", source_filename);
+        return false;
+    }
+    builder->lexer = init_lexer(file, source_filename, NULL);
+    builder->tree = tree;
+
+    builder_advance(builder);
+    builder_advance(builder);
+    snprintf(tree->name, sizeof(tree->name), "%s", builder->token.lexeme);
+    builder_advance(builder);
+    builder_advance(builder);
+    build_declarations(builder);
+    tree->body = build_statement(builder, -1);
+    if (!builder->failed && !options.plain_loops) analyze_loops(tree);
+
+    free_lexer(builder->lexer);
+    builder->lexer = NULL;
+    return !builder->failed;
+}
+
+void free_program_tree(ProgramTree* tree) {
+    mem_free(MEMORY_PARSE, tree->variables, (size_t)tree->variable_capacity * sizeof(ProgramVariable));
+    mem_free(MEMORY_PARSE, tree->expressions, (size_t)tree->expression_capacity * sizeof(ExpressionNode));
+    mem_free(MEMORY_PARSE, tree->expression_spans, (size_t)tree->expression_capacity * sizeof(SourceSpan));
+    mem_free(MEMORY_PARSE, tree->statements, (size_t)tree->statement_capacity * sizeof(StatementNode));
+    mem_free(MEMORY_PARSE, tree->loops, (size_t)tree->loop_capacity * sizeof(CountedLoop));
+    mem_free(MEMORY_PARSE, tree->loop_assignments, (size_t)tree->loop_assignment_capacity * sizeof(LoopAssignment));
+    memset(tree, 0, sizeof(*tree));
+}
+
+// Valores: integer em int64_t com aritmetica modular (sem UB no estouro),
+// real em double. '/' sempre da real; mod so com inteiros, com o sinal do
+// dividendo; relacionais dao 1 ou 0, e if/while testam valor diferente de 0
+static inline bool value_is_true(Value value) {
+    return value.real ? value.real_value != 0.0 : value.integer != 0;
+}
+
+static inline double value_as_real(Value value) {
+    return value.real ? value.real_value : (double)value.integer;
+}
+
+static void execution_fail(Execution* run, const char* message) {
+    if (run->stopped) return;
+    run->stopped = true;
+    run->error = message;
+}
+
+static Value apply_operator(Execution* run, TokenType op, Value left, Value right) {
+    Value result = { false, 0, 0.0 };
+    bool real = left.real || right.real;
+    double a = value_as_real(left), b = value_as_real(right);
+    uint64_t x = (uint64_t)left.integer, y = (uint64_t)right.integer;
+
+    switch (op) {
+        case OP_AD:
+        case OP_MIN:
+        case OP_MUL:
+            result.real = real;
+            if (real) result.real_value = op == OP_AD ? a + b : op == OP_MIN ? a - b : a * b;
+            else result.integer = (int64_t)(op == OP_AD ? x + y : op == OP_MIN ? x - y : x * y);
+            break;
+        case OP_DIV:
+            if (b == 0.0) {
+                execution_fail(run, "divisao por zero");
+                break;
+            }
+            result.real = true;
+            result.real_value = a / b;
+            break;
+        case OP_MOD:
+            if (real) {
+                execution_fail(run, "mod exige operandos inteiros");
+            } else if (right.integer == 0) {
+                execution_fail(run, "mod por zero");
+            } else {
+                result.integer = right.integer == -1 ? 0 : left.integer % right.integer;
+            }
+            break;
+        case OP_EQ: result.integer = real ? a == b : left.integer == right.integer; break;
+        case OP_NE: result.integer = real ? a != b : left.integer != right.integer; break;
+        case OP_LT: result.integer = real ? a < b : left.integer < right.integer; break;
+        case OP_LE: result.integer = real ? a <= b : left.integer <= right.integer; break;
+        case OP_GT: result.integer = real ? a > b : left.integer > right.integer; break;
+        case OP_GE: result.integer = real ? a >= b : left.integer >= right.integer; break;
+        default: break;
+    }
+    return result;
+}
+
+Value evaluate(Execution* run, int32_t id) {
+    const ExpressionNode* node = &run->tree->expressions[id];
+    Value result = { false, 0, 0.0 };
+
+    switch (node->kind) {
+        case EXPR_INTEGER:
+            result.integer = node->integer;
+            break;
+        case EXPR_REAL:
+            result.real = true;
+            result.real_value = node->real;
+            break;
+        case EXPR_VARIABLE:
+            return run->values[node->variable];
+        case EXPR_NEGATE:
+            result = evaluate(run, node->left);
+            if (result.real) result.real_value = -result.real_value;
+            else result.integer = (int64_t)(0 - (uint64_t)result.integer);
+            break;
+        case EXPR_BINARY: {
+            Value left = evaluate(run, node->left);
+            Value right = evaluate(run, node->right);
+            return apply_operator(run, node->op, left, right);
+        }
+    }
+    return result;
+}
+
+// Real atribuido a integer e truncado em direcao a zero
+static inline void assign(Execution* run, int32_t variable, Value value) {
+    Value* target = &run->values[variable];
+    if (target->real) {
+        target->real_value = value_as_real(value);
+    } else if (!value.real) {
+        target->integer = value.integer;
+    } else if (value.real_value > -9223372036854775808.0 && value.real_value < 9223372036854775808.0) {
+        target->integer = (int64_t)value.real_value;
+    } else {
+        execution_fail(run, "valor real fora do intervalo de integer");
+    }
+}
+
+// Com orcamento de tempo (--avaliar) max_steps e so o proximo ponto em que
+// o relogio e consultado, a cada EVALUATION_CHECK_STEPS comandos; sem ele
+// (deadline 0) passar de max_steps para a execucao
+static bool execution_continue(Execution* run) {
+    if (run->deadline == 0.0 || run->steps > run->step_limit) return false;
+    if (monotonic_seconds() >= run->deadline) {
+        run->timed_out = true;
+        return false;
+    }
+    run->max_steps = run->step_limit - run->steps > EVALUATION_CHECK_STEPS
+        ? run->steps + EVALUATION_CHECK_STEPS : run->step_limit;
+    return true;
+}
+
+// Lacos contados com corpo so de atribuicoes, sem o laco normal: a condicao
+// nao e avaliada (as voltas ja sao conhecidas) e os passos do corpo entram
+// de uma vez. Valores inteiros sao modulares, entao as somas abaixo dao o
+// mesmo resultado bit a bit que as voltas uma por uma.
+
+// n * (n - 1) / 2 modulo 2^64, dividindo o fator par
+static uint64_t loop_triangle(uint64_t n) {
+    return n % 2 == 0 ? (n / 2) * (n - 1) : n * ((n - 1) / 2);
+}
+
+// v que a atribuicao le na volta j (0 = primeira)
+static int64_t loop_induction_value(const CountedLoop* loop, int64_t start, uint64_t j, bool after_induction) {
+    return (int64_t)((uint64_t)start + (j + after_induction) * (uint64_t)loop->step);
+}
+
+// e com v = x e o alvo da acumulacao valendo 0
+static uint64_t loop_evaluate_at(Execution* run, const CountedLoop* loop, int32_t expression, int32_t target, int64_t x) {
+    run->values[loop->variable].integer = x;
+    if (target >= 0) run->values[target].integer = 0;
+    return (uint64_t)evaluate(run, expression).integer;
+}
+
+// e para LOOP_LANES valores de v de uma vez: cada no vira um laco sobre as
+// faixas, que o compilador vetoriza; so +, -, * e negacao inteiros
+static void evaluate_lanes(const Execution* run, int32_t id, int32_t induction, int32_t target,
+                           const uint64_t* v, uint64_t* out) {
+    const ExpressionNode* node = &run->tree->expressions[id];
+    uint64_t right[LOOP_LANES];
+
+    switch (node->kind) {
+        case EXPR_INTEGER:
+            for (int lane = 0; lane < LOOP_LANES; lane++) out[lane] = (uint64_t)node->integer;
+            return;
+        case EXPR_VARIABLE:
+            if (node->variable == induction) {
+                memcpy(out, v, sizeof(uint64_t) * LOOP_LANES);
+            } else {
+                uint64_t value = node->variable == target ? 0 : (uint64_t)run->values[node->variable].integer;
+                for (int lane = 0; lane < LOOP_LANES; lane++) out[lane] = value;
+            }
+            return;
+        case EXPR_NEGATE:
+            evaluate_lanes(run, node->left, induction, target, v, out);
+            for (int lane = 0; lane < LOOP_LANES; lane++) out[lane] = 0 - out[lane];
+            return;
+        default:
+            break;
+    }
+    evaluate_lanes(run, node->left, induction, target, v, out);
+    evaluate_lanes(run, node->right, induction, target, v, right);
+    if (node->op == OP_AD) {
+        for (int lane = 0; lane < LOOP_LANES; lane++) out[lane] += right[lane];
+    } else if (node->op == OP_MIN) {
+        for (int lane = 0; lane < LOOP_LANES; lane++) out[lane] -= right[lane];
+    } else {
+        for (int lane = 0; lane < LOOP_LANES; lane++) out[lane] *= right[lane];
+    }
+}
+
+// Soma de e nas voltas 0..trips-1: afim pelas diferencas finitas, grau maior
+// em blocos de LOOP_LANES voltas (as faixas que passam de trips valem 0)
+static uint64_t loop_sum(Execution* run, const CountedLoop* loop, const LoopAssignment* assignment,
+                         int64_t start, uint64_t trips) {
+    const StatementNode* node = &run->tree->statements[assignment->statement];
+    int32_t target = node->variable;
+    if (assignment->degree <= 1) {
+        uint64_t first = loop_evaluate_at(run, loop, node->expression, target,
+                                          loop_induction_value(loop, start, 0, assignment->after_induction));
+        uint64_t second = loop_evaluate_at(run, loop, node->expression, target,
+                                           loop_induction_value(loop, start, 1, assignment->after_induction));
+        return trips * first + (second - first) * loop_triangle(trips);
+    }
+
+    uint64_t v[LOOP_LANES], values[LOOP_LANES], sum = 0;
+    for (uint64_t j = 0; j < trips; j += LOOP_LANES) {
+        uint64_t lanes = trips - j < LOOP_LANES ? trips - j : LOOP_LANES;
+        for (int lane = 0; lane < LOOP_LANES; lane++) {
+            v[lane] = (uint64_t)loop_induction_value(loop, start, j + (uint64_t)lane, assignment->after_induction);
+        }
+        evaluate_lanes(run, node->expression, loop->variable, target, v, values);
+        for (uint64_t lane = 0; lane < lanes; lane++) sum += values[lane];
+    }
+    return sum;
+}
+
+// Devolve false (sem ter mudado nada) quando o laco normal tem que rodar:
+// corpo com controle, numero de voltas desconhecido ou passos que nao
+// cabem antes do proximo ponto de parada, onde o laco normal para no
+// comando certo
+static bool execute_counted_loop(Execution* run, const CountedLoop* loop) {
+    const ProgramTree* tree = run->tree;
+    uint64_t trips;
+
+    if (loop->kind == LOOP_COUNTED) return false;
+    int64_t start = run->values[loop->variable].integer;
+    if (!loop_trip_count(loop, start, evaluate(run, loop->limit).integer, &trips)) return false;
+    // Com --avaliar so a forma fechada (tempo constante) passa do proximo
+    // ponto em que o relogio e consultado
+    uint64_t limit = run->deadline != 0.0 && loop->kind == LOOP_CLOSED ? run->step_limit : run->max_steps;
+    if (run->steps > limit || trips > (limit - run->steps) / loop->steps_per_iteration) return false;
+
+    const LoopAssignment* assignments = &tree->loop_assignments[loop->first_assignment];
+    if (loop->kind == LOOP_STRAIGHT) {
+        bool compound = loop->steps_per_iteration > (uint32_t)loop->assignment_count;
+        for (uint64_t j = 0; j < trips && !run->stopped; j++) {
+            run->steps += compound;
+            for (int32_t i = 0; i < loop->assignment_count; i++) {
+                const StatementNode* node = &tree->statements[assignments[i].statement];
+                run->steps++;
+                Value value = evaluate(run, node->expression);
+                if (!run->stopped) assign(run, node->variable, value);
+                if (run->stopped) {
+                    run->error_statement = assignments[i].statement;
+                    break;
+                }
+            }
+        }
+    } else {
+        // Os alvos sao independentes: nenhuma expressao le outro alvo
+        for (int32_t i = 0; i < loop->assignment_count; i++) {
+            const StatementNode* node = &tree->statements[assignments[i].statement];
+            Value* target = &run->values[node->variable];
+            if (assignments[i].role == LOOP_ACCUMULATE) {
+                int64_t initial = target->integer;
+                uint64_t sum = loop_sum(run, loop, &assignments[i], start, trips);
+                target->integer = (int64_t)((uint64_t)initial + sum);
+            } else if (assignments[i].role == LOOP_SET && trips > 0) {
+                int64_t x = loop_induction_value(loop, start, trips - 1, assignments[i].after_induction);
+                target->integer = (int64_t)loop_evaluate_at(run, loop, node->expression, -1, x);
+            }
+        }
+        run->values[loop->variable].integer = loop_induction_value(loop, start, trips, false);
+        run->steps += trips * loop->steps_per_iteration;
+    }
+    if (run->steps > run->max_steps) run->max_steps = run->steps;
+    return true;
+}
+
+// --perfil: contagem exata de execucoes por comando e amostras do SIGPROF
+// (tempo de CPU) atribuidas ao comando corrente
+uint64_t* profile_counts = NULL;
+uint32_t* profile_samples = NULL;
+volatile sig_atomic_t profile_current = -1;
+volatile sig_atomic_t profile_outside = 0;
+// O kernel pode entregar o SIGPROF menos vezes que o pedido (granularidade
+// do tick); o tempo de cada amostra vem do tempo de CPU medido
+double profile_cpu_seconds = 0.0;
+
+static void profile_tick(int signal_number) {
+    (void)signal_number;
+    int32_t current = profile_current;
+    if (current >= 0) profile_samples[current]++;
+    else profile_outside++;
+}
+
+#define EXECUTOR(name) name##Profiled
+#define PROFILE_ENTER(id) (profile_counts[id]++, profile_current = (id))
+#define PROFILE_RESUME(id) (profile_current = (id))
+#define COUNTED_LOOPS 0
+#include "execucao.inc"
+#undef EXECUTOR
+#undef PROFILE_ENTER
+#undef PROFILE_RESUME
+#undef COUNTED_LOOPS
+
+#define EXECUTOR(name) name
+#define PROFILE_ENTER(id) ((void)0)
+#define PROFILE_RESUME(id) ((void)0)
+#define COUNTED_LOOPS 1
+#include "execucao.inc"
+#undef EXECUTOR
+#undef PROFILE_ENTER
+#undef PROFILE_RESUME
+#undef COUNTED_LOOPS
+
+void format_value(char* text, size_t size, Value value) {
+    if (value.real) snprintf(text, size, "%.15g", value.real_value);
+    else snprintf(text, size, "%lld", (long long)value.integer);
+}
+
+static const char* statement_name(StatementKind kind) {
+    switch (kind) {
+        case STMT_ASSIGNMENT: return "atribuicao";
+        case STMT_COMPOUND: return "begin";
+        case STMT_CONDITIONAL: return "if";
+        case STMT_REPETITIVE: return "while";
+    }
+    return "?";
+}
+
+// Quadro do folded stack / linha do relatorio: "a:=@6:5", "while@5:3"
+static void statement_label(const ProgramTree* tree, int32_t id, char* text, size_t size) {
+    const StatementNode* node = &tree->statements[id];
+    if (node->kind == STMT_ASSIGNMENT) {
+        snprintf(text, size, "%s:=@%lld:%lld", tree->variables[node->variable].name,
+                 (long long)node->line, (long long)node->column);
+    } else {
+        snprintf(text, size, "%s@%lld:%lld", statement_name(node->kind), (long long)node->line, (long long)node->column);
+    }
+}
+
+static const char* operator_text(TokenType op);
+
+// --lacos: os lacos contados que a analise reconheceu e o que cada um vira
+static void print_loop_report(OutputBuffer* console, const ProgramTree* tree) {
+    static const char* const kinds[] = { "contado", "direto", "em lotes", "forma fechada" };
+    char line[2 * MAX_LEXEME + 128], position[48], condition[2 * MAX_LEXEME + 32];
+
+    out_literal(console, "\n\t---- LACOS ----\n");
+    if (tree->loop_count == 0) {
+        out_literal(console, "Nenhum laco contado\n");
+        return;
+    }
+    snprintf(line, sizeof(line), "%-14s %-30s %20s %10s %s\n", "LINHA:COLUNA", "CONDICAO", "PASSO", "POR VOLTA", "EXECUCAO");
+    out_str(console, line);
+    for (int32_t i = 0; i < tree->loop_count; i++) {
+        const CountedLoop* loop = &tree->loops[i];
+        const StatementNode* node = &tree->statements[loop->statement];
+        const ExpressionNode* limit = &tree->expressions[loop->limit];
+        snprintf(position, sizeof(position), "%lld:%lld", (long long)node->line, (long long)node->column);
+        if (limit->kind == EXPR_VARIABLE) {
+            snprintf(condition, sizeof(condition), "%s %s %s", tree->variables[loop->variable].name,
+                     operator_text(loop->op), tree->variables[limit->variable].name);
+        } else {
+            snprintf(condition, sizeof(condition), "%s %s %lld", tree->variables[loop->variable].name,
+                     operator_text(loop->op), (long long)limit->integer);
+        }
+        if (loop->kind == LOOP_COUNTED) {
+            snprintf(line, sizeof(line), "%-14s %-30.30s %20lld %10s %s\n", position, condition, (long long)loop->step, "-", kinds[loop->kind]);
+        } else {
+            snprintf(line, sizeof(line), "%-14s %-30.30s %20lld %10u %s\n", position, condition, (long long)loop->step,
+                     loop->steps_per_iteration, kinds[loop->kind]);
+        }
+        out_str(console, line);
+    }
+}
+
+typedef struct {
+    int64_t line;
+    uint64_t count;
+    uint64_t samples;
+} LineProfile;
+
+const ProgramTree* profile_tree = NULL;
+uint64_t* profile_inclusive = NULL;
+
+static int compare_hot_statements(const void* a, const void* b) {
+    int32_t x = *(const int32_t*)a, y = *(const int32_t*)b;
+    if (profile_samples[x] != profile_samples[y]) return profile_samples[x] < profile_samples[y] ? 1 : -1;
+    if (profile_counts[x] != profile_counts[y]) return profile_counts[x] < profile_counts[y] ? 1 : -1;
+    return x - y;
+}
+
+static int compare_statement_lines(const void* a, const void* b) {
+    const StatementNode* x = &profile_tree->statements[*(const int32_t*)a];
+    const StatementNode* y = &profile_tree->statements[*(const int32_t*)b];
+    return (x->line > y->line) - (x->line < y->line);
+}
+
+static int compare_hot_lines(const void* a, const void* b) {
+    const LineProfile* x = a;
+    const LineProfile* y = b;
+    if (x->samples != y->samples) return x->samples < y->samples ? 1 : -1;
+    if (x->count != y->count) return x->count < y->count ? 1 : -1;
+    return (x->line > y->line) - (x->line < y->line);
+}
+
+static double process_cpu_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void profile_start(const ProgramTree* tree) {
+    struct sigaction action;
+    struct itimerval timer = { { 0, PROFILE_INTERVAL_USEC }, { 0, PROFILE_INTERVAL_USEC } };
+
+    profile_tree = tree;
+    profile_counts = mem_calloc(MEMORY_EXECUTION, (size_t)tree->statement_count + 1, sizeof(uint64_t));
+    profile_samples = mem_calloc(MEMORY_EXECUTION, (size_t)tree->statement_count + 1, sizeof(uint32_t));
+    profile_current = -1;
+    profile_outside = 0;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = profile_tick;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, NULL);
+    profile_cpu_seconds = process_cpu_seconds();
+    setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+static void profile_stop(void) {
+    struct itimerval timer = { { 0, 0 }, { 0, 0 } };
+    setitimer(ITIMER_PROF, &timer, NULL);
+    profile_cpu_seconds = process_cpu_seconds() - profile_cpu_seconds;
+    signal(SIGPROF, SIG_DFL);
+    profile_current = -1;
+}
+
+// Folded stacks (flamegraph.pl, speedscope): programa;quadro;...;quadro N.
+// Sem procedimentos, a pilha dinamica e a cadeia de comandos que contem o
+// comando amostrado
+static bool write_folded_stacks(const ProgramTree* tree, const char* filename) {
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) return false;
+
+    OutputBuffer out;
+    int32_t* chain = mem_alloc(MEMORY_EXECUTION, sizeof(int32_t) * (EXECUTION_MAX_DEPTH + 1));
+    char label[MAX_LEXEME + 64];
+    out_init(&out, fd);
+
+    if (profile_outside > 0) {
+        out_str(&out, tree->name);
+        out_char(&out, ' ');
+        out_int(&out, profile_outside);
+        out_char(&out, '\n');
+    }
+    for (int32_t id = 0; id < tree->statement_count; id++) {
+        if (profile_samples[id] == 0) continue;
+        int depth = 0;
+        for (int32_t frame = id; frame >= 0 && depth <= EXECUTION_MAX_DEPTH; frame = tree->statements[frame].parent) {
+            chain[depth++] = frame;
+        }
+        out_str(&out, tree->name);
+        while (depth > 0) {
+            statement_label(tree, chain[--depth], label, sizeof(label));
+            out_char(&out, ';');
+            out_str(&out, label);
+        }
+        out_char(&out, ' ');
+        out_int(&out, profile_samples[id]);
+        out_char(&out, '\n');
+    }
+    out_flush(&out);
+    out_free(&out);
+    mem_free(MEMORY_EXECUTION, chain, sizeof(int32_t) * (EXECUTION_MAX_DEPTH + 1));
+    close(fd);
+    return true;
+}
+
+static void print_profile(OutputBuffer* console, const ProgramTree* tree, const char* source_filename) {
+    int32_t count = tree->statement_count;
+    uint64_t total = profile_outside;
+    char line[256], label[MAX_LEXEME + 64], position[48];
+
+    // Inclusivo: as amostras proprias de cada comando sobem pela cadeia de pais
+    profile_inclusive = mem_calloc(MEMORY_EXECUTION, (size_t)count + 1, sizeof(uint64_t));
+    for (int32_t id = 0; id < count; id++) {
+        total += profile_samples[id];
+        for (int32_t frame = id; frame >= 0 && profile_samples[id] > 0; frame = tree->statements[frame].parent) {
+            profile_inclusive[frame] += profile_samples[id];
+        }
+    }
+    double percent = total > 0 ? 100.0 / (double)total : 0.0;
+    double sample_seconds = total > 0 ? profile_cpu_seconds / (double)total : 0.0;
+
+    out_literal(console, "\n\t---- PERFIL ----\n");
+    snprintf(line, sizeof(line), "%llu amostras em %.6f s de CPU (intervalo pedido: %d us), %lld fora dos comandos\n",
+             (unsigned long long)total, profile_cpu_seconds, PROFILE_INTERVAL_USEC, (long long)profile_outside);
+    out_str(console, line);
+
+    int32_t* order = mem_alloc(MEMORY_EXECUTION, sizeof(int32_t) * ((size_t)count + 1));
+    for (int32_t id = 0; id < count; id++) order[id] = id;
+    qsort(order, (size_t)count, sizeof(int32_t), compare_hot_statements);
+
+    out_literal(console, "\nComandos mais quentes\n");
+    snprintf(line, sizeof(line), "%-14s %-20s %14s %10s %9s %9s\n", "LINHA:COLUNA", "COMANDO", "EXECUCOES", "AMOSTRAS", "PROPRIO", "INCLUSIVO");
+    out_str(console, line);
+    for (int32_t i = 0; i < count && i < PROFILE_REPORT_ROWS; i++) {
+        const StatementNode* node = &tree->statements[order[i]];
+        if (profile_counts[order[i]] == 0) break;
+        snprintf(position, sizeof(position), "%lld:%lld", (long long)node->line, (long long)node->column);
+        if (node->kind == STMT_ASSIGNMENT) snprintf(label, sizeof(label), "%s :=", tree->variables[node->variable].name);
+        else snprintf(label, sizeof(label), "%s", statement_name(node->kind));
+        snprintf(line, sizeof(line), "%-14s %-20.20s %14llu %10u %8.1f%% %8.1f%%\n", position, label,
+                 (unsigned long long)profile_counts[order[i]], profile_samples[order[i]],
+                 profile_samples[order[i]] * percent, profile_inclusive[order[i]] * percent);
+        out_str(console, line);
+    }
+
+    // Por linha: soma dos comandos que comecam na linha
+    qsort(order, (size_t)count, sizeof(int32_t), compare_statement_lines);
+    LineProfile* lines = mem_calloc(MEMORY_EXECUTION, (size_t)count + 1, sizeof(LineProfile));
+    int32_t line_count = 0;
+    for (int32_t i = 0; i < count; i++) {
+        const StatementNode* node = &tree->statements[order[i]];
+        if (line_count == 0 || lines[line_count - 1].line != node->line) lines[line_count++].line = node->line;
+        lines[line_count - 1].count += profile_counts[order[i]];
+        lines[line_count - 1].samples += profile_samples[order[i]];
+    }
+    qsort(lines, (size_t)line_count, sizeof(LineProfile), compare_hot_lines);
+
+    out_literal(console, "\nLinhas mais quentes\n");
+    snprintf(line, sizeof(line), "%-14s %14s %10s %9s %12s\n", "LINHA", "EXECUCOES", "AMOSTRAS", "TEMPO", "SEGUNDOS");
+    out_str(console, line);
+    for (int32_t i = 0; i < line_count && i < PROFILE_REPORT_ROWS; i++) {
+        if (lines[i].count == 0) break;
+        snprintf(line, sizeof(line), "%-14lld %14llu %10llu %8.1f%% %12.6f\n", (long long)lines[i].line,
+                 (unsigned long long)lines[i].count, (unsigned long long)lines[i].samples,
+                 lines[i].samples * percent, lines[i].samples * sample_seconds);
+        out_str(console, line);
+    }
+
+    char folded_filename[PATH_MAX];
+    snprintf(folded_filename, sizeof(folded_filename), "%s.folded", source_filename);
+    if (write_folded_stacks(tree, folded_filename)) {
+        out_literal(console, "\n\033[1;35mPilhas (folded stacks) salvas em:\033[0m ");
+        out_str(console, folded_filename);
+        out_char(console, '\n');
+    } else {
+        out_literal(console, "Erro ao criar arquivo de saida\n");
+    }
+
+    mem_free(MEMORY_EXECUTION, lines, sizeof(LineProfile) * ((size_t)count + 1));
+    mem_free(MEMORY_EXECUTION, order, sizeof(int32_t) * ((size_t)count + 1));
+    mem_free(MEMORY_EXECUTION, profile_inclusive, sizeof(uint64_t) * ((size_t)count + 1));
+    profile_inclusive = NULL;
+}
+
+// --executar / --perfil: roda o programa aceito e mostra o estado final
+int execute_program(const char* source_filename, OutputBuffer* console) {
+    double phase_start = monotonic_seconds();
+    ProgramTree tree;
+    TreeBuilder builder;
+    char line[256], value[64];
+
+    out_literal(console, "\n\t---- EXECUCAO ----\n");
+    if (!build_program_tree(source_filename, &tree, &builder)) {
+        out_literal(console, "\033[1;31mERRO DE EXECUCAO (Linha ");
+        out_int(console, builder.error_line);
+        out_literal(console, "): ");
+        out_str(console, builder.error);
+        out_literal(console, "\033[0m\n");
+        free_program_tree(&tree);
+        stats.phase_seconds[STATS_PHASE_EXECUTION] += monotonic_seconds() - phase_start;
+        return 1;
+    }
+
+    Execution run = { 0 };
+    run.tree = &tree;
+    run.values = mem_calloc(MEMORY_EXECUTION, (size_t)tree.variable_count + 1, sizeof(Value));
+    run.max_steps = options.max_steps > 0 ? options.max_steps : UINT64_MAX;
+    run.error_statement = -1;
+    for (int32_t i = 0; i < tree.variable_count; i++) run.values[i].real = tree.variables[i].real;
+
+    double run_start = monotonic_seconds();
+    if (options.profile) {
+        profile_start(&tree);
+        execute_statementProfiled(&run, tree.body);
+        profile_stop();
+    } else {
+        execute_statement(&run, tree.body);
+    }
+    double run_seconds = monotonic_seconds() - run_start;
+
+    if (run.stopped) {
+        int64_t error_line = run.error_statement >= 0 ? tree.statements[run.error_statement].line : 0;
+        if (run.error != NULL) {
+            snprintf(line, sizeof(line), "\033[1;31mERRO DE EXECUCAO (Linha %lld): %s\033[0m\n", (long long)error_line, run.error);
+        } else {
+            snprintf(line, sizeof(line), "\033[1;33mExecucao interrompida (Linha %lld): limite de %llu comandos atingido\033[0m\n",
+                     (long long)error_line, (unsigned long long)run.max_steps);
+        }
+        out_str(console, line);
+    }
+
+    out_literal(console, "VARIAVEL             TIPO       VALOR\n");
+    out_literal(console, "--------------------------------------------\n");
+    for (int32_t i = 0; i < tree.variable_count; i++) {
+        format_value(value, sizeof(value), run.values[i]);
+        snprintf(line, sizeof(line), "%-20s %-10s %s\n", tree.variables[i].name, tree.variables[i].real ? "real" : "integer", value);
+        out_str(console, line);
+    }
+    snprintf(line, sizeof(line), "\n%llu comandos executados em %.6f s\n",
+             (unsigned long long)(run.steps > run.max_steps ? run.max_steps : run.steps), run_seconds);
+    out_str(console, line);
+    if (options.loop_report) print_loop_report(console, &tree);
+
+    if (options.profile) {
+        print_profile(console, &tree, source_filename);
+        mem_free(MEMORY_EXECUTION, profile_counts, sizeof(uint64_t) * ((size_t)tree.statement_count + 1));
+        mem_free(MEMORY_EXECUTION, profile_samples, sizeof(uint32_t) * ((size_t)tree.statement_count + 1));
+        profile_counts = NULL;
+        profile_samples = NULL;
+    }
+
+    mem_free(MEMORY_EXECUTION, run.values, sizeof(Value) * ((size_t)tree.variable_count + 1));
+    free_program_tree(&tree);
+    stats.phase_seconds[STATS_PHASE_EXECUTION] += monotonic_seconds() - phase_start;
+    return run.error != NULL;
+}
+
+// --avaliar: avaliacao parcial em tempo de compilacao. A linguagem nao tem
+// entrada, entao todo programa aceito e uma computacao fechada: os comandos
+// do begin principal sao executados em ordem enquanto couberem no orcamento
+// de passos (--max-passos) e de tempo (--max-ms). O que terminou vira
+// atribuicoes de constantes; o primeiro comando que nao terminou (orcamento
+// esgotado ou erro de execucao) e os seguintes ficam no programa residual,
+// que parte do estado anterior a ele. arquivo.mpas.avaliado e um programa
+// mini-Pascal valido com o mesmo resultado do original
+// Menor numero de digitos que o strtod le de volta no mesmo double, na
+// forma que o lexer aceita (digitos, '.', 'E'); infinito e NaN viram
+// expressoes (1E999 estoura para infinito no strtod)
+static void format_real_literal(char* text, size_t size, double value) {
+    if (isinf(value)) {
+        snprintf(text, size, "%s", value > 0 ? "1E999" : "-1E999");
+        return;
+    }
+    if (isnan(value)) {
+        // inf - inf da o NaN padrao da maquina; troca o sinal se preciso
+        double nan_value = HUGE_VAL - HUGE_VAL;
+        snprintf(text, size, "%s", signbit(nan_value) == signbit(value) ? "(1E999 - 1E999)" : "(- (1E999 - 1E999))");
+        return;
+    }
+    for (int precision = 15; precision <= 17; precision++) {
+        snprintf(text, size, "%.*G", precision, value);
+        if (strtod(text, NULL) == value) break;
+    }
+    if (strpbrk(text, ".E") == NULL && strlen(text) + 2 < size) strcat(text, ".0");
+}
+
+static const char* operator_text(TokenType op) {
+    switch (op) {
+        case OP_AD: return "+";
+        case OP_MIN: return "-";
+        case OP_MUL: return "*";
+        case OP_DIV: return "/";
+        case OP_MOD: return "mod";
+        case OP_EQ: return "=";
+        case OP_NE: return "<>";
+        case OP_LT: return "<";
+        case OP_LE: return "<=";
+        case OP_GT: return ">";
+        case OP_GE: return ">=";
+        default: return "?";
+    }
+}
+
+// Parenteses so onde a precedencia exige (min_power: o menor operador que
+// cabe sem parenteses). O sinal vale para o termo inteiro, entao a negacao
+// sai sempre entre parenteses e com espaco ("- 5" e negacao, "-5" literal)
+static void fold_expression(OutputBuffer* out, const ProgramTree* tree, int32_t id, int min_power) {
+    const ExpressionNode* node = &tree->expressions[id];
+    char text[64];
+
+    switch (node->kind) {
+        case EXPR_INTEGER:
+            out_int(out, node->integer);
+            break;
+        case EXPR_REAL:
+            format_real_literal(text, sizeof(text), node->real);
+            out_str(out, text);
+            break;
+        case EXPR_VARIABLE:
+            out_str(out, tree->variables[node->variable].name);
+            break;
+        case EXPR_NEGATE:
+            out_literal(out, "(- ");
+            fold_expression(out, tree, node->left, 3);
+            out_char(out, ')');
+            break;
+        case EXPR_BINARY: {
+            int power = operator_power(node->op);
+            if (power < min_power) out_char(out, '(');
+            // Relacional nao encadeia: os dois lados sao expressoes simples
+            fold_expression(out, tree, node->left, power == 1 ? 2 : power);
+            out_char(out, ' ');
+            out_str(out, operator_text(node->op));
+            out_char(out, ' ');
+            fold_expression(out, tree, node->right, power + 1);
+            if (power < min_power) out_char(out, ')');
+            break;
+        }
+    }
+}
+
+static void fold_indent(OutputBuffer* out, int level) {
+    for (int i = 0; i < level; i++) out_literal(out, "  ");
+}
+
+// Reescreve o comando como estava na arvore (o parser le de volta a mesma
+// arvore: o else continua com o if mais proximo)
+static void fold_statement(OutputBuffer* out, const ProgramTree* tree, int32_t id, int level) {
+    const StatementNode* node = &tree->statements[id];
+
+    switch (node->kind) {
+        case STMT_ASSIGNMENT:
+            fold_indent(out, level);
+            out_str(out, tree->variables[node->variable].name);
+            out_literal(out, " := ");
+            fold_expression(out, tree, node->expression, 0);
+            break;
+        case STMT_COMPOUND:
+            fold_indent(out, level);
+            out_literal(out, "begin\n");
+            for (int32_t child = node->body; child >= 0; child = tree->statements[child].next) {
+                fold_statement(out, tree, child, level + 1);
+                out_literal(out, ";\n");
+            }
+            fold_indent(out, level);
+            out_literal(out, "end");
+            break;
+        case STMT_CONDITIONAL:
+            fold_indent(out, level);
+            out_literal(out, "if ");
+            fold_expression(out, tree, node->expression, 0);
+            out_literal(out, " then\n");
+            fold_statement(out, tree, node->body, level + 1);
+            if (node->alternative >= 0) {
+                out_char(out, '\n');
+                fold_indent(out, level);
+                out_literal(out, "else\n");
+                fold_statement(out, tree, node->alternative, level + 1);
+            }
+            break;
+        case STMT_REPETITIVE:
+            fold_indent(out, level);
+            out_literal(out, "while ");
+            fold_expression(out, tree, node->expression, 0);
+            out_literal(out, " do\n");
+            fold_statement(out, tree, node->body, level + 1);
+            break;
+    }
+}
+
+// Declaracoes originais, o estado como atribuicoes e o resto do programa
+static bool write_folded_program(const ProgramTree* tree, const Value* values, int32_t residual, const char* filename) {
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) return false;
+
+    OutputBuffer out;
+    char value[64];
+    out_init(&out, fd);
+
+    out_literal(&out, "program ");
+    out_str(&out, tree->name);
+    out_literal(&out, ";\n");
+    if (tree->variable_count > 0) out_literal(&out, "var\n");
+    for (int32_t i = 0; i < tree->variable_count; i++) {
+        out_literal(&out, "  ");
+        out_str(&out, tree->variables[i].name);
+        out_str(&out, tree->variables[i].real ? ": real;\n" : ": integer;\n");
+    }
+    out_literal(&out, "begin\n");
+    for (int32_t i = 0; i < tree->variable_count; i++) {
+        if (values[i].real) format_real_literal(value, sizeof(value), values[i].real_value);
+        else format_value(value, sizeof(value), values[i]);
+        out_literal(&out, "  ");
+        out_str(&out, tree->variables[i].name);
+        out_literal(&out, " := ");
+        out_str(&out, value);
+        out_literal(&out, ";\n");
+    }
+    for (int32_t child = residual; child >= 0; child = tree->statements[child].next) {
+        fold_statement(&out, tree, child, 1);
+        out_literal(&out, ";\n");
+    }
+    out_literal(&out, "end.\n");
+
+    out_flush(&out);
+    out_free(&out);
+    close(fd);
+    return true;
+}
+
+int fold_program(const char* source_filename, OutputBuffer* console) {
+    double phase_start = monotonic_seconds();
+    ProgramTree tree;
+    TreeBuilder builder;
+    char line[2 * MAX_LEXEME + 256], value[64], label[MAX_LEXEME + 64], folded_filename[PATH_MAX];
+
+    out_literal(console, "\n\t---- AVALIACAO PARCIAL ----\n");
+    if (!build_program_tree(source_filename, &tree, &builder)) {
+        out_literal(console, "\033[1;31mERRO NA AVALIACAO (Linha ");
+        out_int(console, builder.error_line);
+        out_literal(console, "): ");
+        out_str(console, builder.error);
+        out_literal(console, "\033[0m\n");
+        free_program_tree(&tree);
+        stats.phase_seconds[STATS_PHASE_EXECUTION] += monotonic_seconds() - phase_start;
+        return 1;
+    }
+
+    size_t values_size = sizeof(Value) * ((size_t)tree.variable_count + 1);
+    Execution run = { 0 };
+    run.tree = &tree;
+    run.values = mem_calloc(MEMORY_EXECUTION, (size_t)tree.variable_count + 1, sizeof(Value));
+    Value* saved = mem_alloc(MEMORY_EXECUTION, values_size);
+    run.step_limit = options.max_steps > 0 ? options.max_steps : UINT64_MAX;
+    run.deadline = options.max_milliseconds > 0 ? monotonic_seconds() + (double)options.max_milliseconds / 1000.0 : INFINITY;
+    run.max_steps = 0;
+    run.error_statement = -1;
+    for (int32_t i = 0; i < tree.variable_count; i++) run.values[i].real = tree.variables[i].real;
+
+    // O begin principal conta um passo, como no --executar
+    run.steps = 1;
+    int32_t residual = -1, folded = 0, total = 0;
+    for (int32_t child = tree.statements[tree.body].body; child >= 0; child = tree.statements[child].next) total++;
+
+    double run_start = monotonic_seconds();
+    for (int32_t child = tree.statements[tree.body].body; child >= 0; child = tree.statements[child].next) {
+        uint64_t steps_before = run.steps;
+        memcpy(saved, run.values, values_size);
+        execute_statement(&run, child);
+        if (run.stopped) {
+            memcpy(run.values, saved, values_size);
+            run.steps = steps_before;
+            residual = child;
+            break;
+        }
+        folded++;
+    }
+    double run_seconds = monotonic_seconds() - run_start;
+
+    if (residual < 0) {
+        snprintf(line, sizeof(line), "\033[1;32mPrograma avaliado por completo:\033[0m %llu comandos em %.6f s\n",
+                 (unsigned long long)run.steps, run_seconds);
+        out_str(console, line);
+    } else {
+        const StatementNode* stop = &tree.statements[run.error_statement >= 0 ? run.error_statement : residual];
+        statement_label(&tree, (int32_t)(stop - tree.statements), label, sizeof(label));
+        if (run.error != NULL) {
+            snprintf(line, sizeof(line), "\033[1;33mAvaliacao interrompida em %s: ERRO DE EXECUCAO (Linha %lld): %s\033[0m\n",
+                     label, (long long)stop->line, run.error);
+        } else if (run.timed_out) {
+            snprintf(line, sizeof(line), "\033[1;33mAvaliacao interrompida em %s: orcamento de %llu ms esgotado\033[0m\n",
+                     label, (unsigned long long)options.max_milliseconds);
+        } else {
+            snprintf(line, sizeof(line), "\033[1;33mAvaliacao interrompida em %s: orcamento de %llu comandos esgotado\033[0m\n",
+                     label, (unsigned long long)run.step_limit);
+        }
+        out_str(console, line);
+        statement_label(&tree, residual, label, sizeof(label));
+        snprintf(line, sizeof(line), "%d de %d comandos do programa principal dobrados (%llu passos em %.6f s); residual a partir de %s\n",
+                 folded, total, (unsigned long long)run.steps, run_seconds, label);
+        out_str(console, line);
+        out_literal(console, "Estado antes do residual:\n");
+    }
+
+    out_literal(console, "VARIAVEL             TIPO       VALOR\n");
+    out_literal(console, "--------------------------------------------\n");
+    for (int32_t i = 0; i < tree.variable_count; i++) {
+        format_value(value, sizeof(value), run.values[i]);
+        snprintf(line, sizeof(line), "%-20s %-10s %s\n", tree.variables[i].name, tree.variables[i].real ? "real" : "integer", value);
+        out_str(console, line);
+    }
+
+    snprintf(folded_filename, sizeof(folded_filename), "%s.avaliado", source_filename);
+    int status = run.error != NULL;
+    if (write_folded_program(&tree, run.values, residual, folded_filename)) {
+        out_literal(console, "\n\033[1;35mPrograma dobrado salvo em:\033[0m ");
+        out_str(console, folded_filename);
+        out_char(console, '\n');
+    } else {
+        out_literal(console, "Erro ao criar arquivo de saida\n");
+        status = 1;
+    }
+
+    mem_free(MEMORY_EXECUTION, saved, values_size);
+    mem_free(MEMORY_EXECUTION, run.values, values_size);
+    free_program_tree(&tree);
+    stats.phase_seconds[STATS_PHASE_EXECUTION] += monotonic_seconds() - phase_start;
+    return status;
+}
+
+// --arvore: grava a arvore do programa aceito em arquivo.mpas.arvore, no
+// formato de arvore.h. Outras ferramentas (metricas, formatadores) abrem o
+// arquivo com mmap e andam pelos indices, sem rodar o analisador de novo
+static uint8_t snapshot_operator(TokenType op) {
+    switch (op) {
+        case OP_AD: return MPAS_OP_ADD;
+        case OP_MIN: return MPAS_OP_SUB;
+        case OP_MUL: return MPAS_OP_MUL;
+        case OP_DIV: return MPAS_OP_DIV;
+        case OP_MOD: return MPAS_OP_MOD;
+        case OP_EQ: return MPAS_OP_EQ;
+        case OP_NE: return MPAS_OP_NE;
+        case OP_LT: return MPAS_OP_LT;
+        case OP_LE: return MPAS_OP_LE;
+        case OP_GT: return MPAS_OP_GT;
+        case OP_GE: return MPAS_OP_GE;
+        default: return MPAS_OP_NONE;
+    }
+}
+
+static MpasSpan snapshot_span(int64_t line, int64_t column, int64_t end_line, int64_t end_column) {
+    MpasSpan span = { line, column, end_line, end_column };
+    return span;
+}
+
+static size_t align8(size_t offset) {
+    return (offset + 7) & ~(size_t)7;
+}
+
+// Devolve o tamanho gravado (0 em erro)
+static size_t write_tree_snapshot(const ProgramTree* tree, const char* source_filename, const char* filename) {
+    struct stat info;
+    if (stat(source_filename, &info) != 0) return 0;
+
+    size_t string_size = strlen(tree->name) + 1;
+    for (int32_t i = 0; i < tree->variable_count; i++) string_size += strlen(tree->variables[i].name) + 1;
+
+    MpasTreeHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MPAS_TREE_MAGIC, sizeof(header.magic));
+    header.version = MPAS_TREE_VERSION;
+    header.header_size = sizeof(MpasTreeHeader);
+    header.byte_order = MPAS_TREE_BYTE_ORDER;
+    header.source_size = (uint64_t)info.st_size;
+    header.source_mtime_ns = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+    header.body = tree->body;
+    header.symbol_count = (uint32_t)tree->variable_count;
+    header.expression_count = (uint32_t)tree->expression_count;
+    header.statement_count = (uint32_t)tree->statement_count;
+
+    size_t offset = align8(sizeof(MpasTreeHeader));
+    header.symbol_offset = offset;
+    offset += (size_t)tree->variable_count * sizeof(MpasTreeSymbol);
+    header.expression_offset = offset;
+    offset += (size_t)tree->expression_count * sizeof(MpasTreeExpression);
+    header.statement_offset = offset;
+    offset += (size_t)tree->statement_count * sizeof(MpasTreeStatement);
+    header.string_offset = offset;
+    header.string_size = string_size;
+    header.file_size = align8(offset + string_size);
+
+    uint8_t* data = mem_calloc(MEMORY_OUTPUT, header.file_size, 1);
+    char* strings = (char*)data + header.string_offset;
+    size_t string_used = 0;
+    header.name = (uint32_t)string_used;
+    memcpy(strings, tree->name, strlen(tree->name) + 1);
+    string_used += strlen(tree->name) + 1;
+    memcpy(data, &header, sizeof(header));
+
+    MpasTreeSymbol* symbols = (MpasTreeSymbol*)(data + header.symbol_offset);
+    for (int32_t i = 0; i < tree->variable_count; i++) {
+        const ProgramVariable* variable = &tree->variables[i];
+        size_t length = strlen(variable->name) + 1;
+        symbols[i].name = (uint32_t)string_used;
+        symbols[i].real = variable->real;
+        symbols[i].span = snapshot_span(variable->span.line, variable->span.column, variable->span.end_line, variable->span.end_column);
+        memcpy(strings + string_used, variable->name, length);
+        string_used += length;
+    }
+
+    MpasTreeExpression* expressions = (MpasTreeExpression*)(data + header.expression_offset);
+    for (int32_t i = 0; i < tree->expression_count; i++) {
+        const ExpressionNode* node = &tree->expressions[i];
+        const SourceSpan* span = &tree->expression_spans[i];
+        MpasTreeExpression* record = &expressions[i];
+        record->kind = (uint8_t)node->kind;
+        record->op = node->kind == EXPR_BINARY ? snapshot_operator(node->op) : MPAS_OP_NONE;
+        record->left = node->left;
+        record->right = node->right;
+        record->symbol = node->kind == EXPR_VARIABLE ? node->variable : -1;
+        if (node->kind == EXPR_REAL) record->value.real = node->real;
+        else record->value.integer = node->integer;
+        record->span = snapshot_span(span->line, span->column, span->end_line, span->end_column);
+    }
+
+    MpasTreeStatement* statements = (MpasTreeStatement*)(data + header.statement_offset);
+    for (int32_t i = 0; i < tree->statement_count; i++) {
+        const StatementNode* node = &tree->statements[i];
+        MpasTreeStatement* record = &statements[i];
+        record->kind = (uint8_t)node->kind;
+        record->parent = node->parent;
+        record->next = node->next;
+        record->symbol = node->variable;
+        record->expression = node->expression;
+        record->body = node->body;
+        record->alternative = node->alternative;
+        record->span = snapshot_span(node->line, node->column, node->end_line, node->end_column);
+    }
+
+    size_t size = header.file_size;
+    if (write_file(filename, (const char*)data, size) != 0) size = 0;
+    mem_free(MEMORY_OUTPUT, data, header.file_size);
+    return size;
+}
+
+int snapshot_program(const char* source_filename, OutputBuffer* console) {
+    double phase_start = monotonic_seconds();
+    ProgramTree tree;
+    TreeBuilder builder;
+    char line[PATH_MAX + 160], tree_filename[PATH_MAX];
+
+    if (!build_program_tree(source_filename, &tree, &builder)) {
+        out_literal(console, "\033[1;31mERRO NA ARVORE (Linha ");
+        out_int(console, builder.error_line);
+        out_literal(console, "): ");
+        out_str(console, builder.error);
+        out_literal(console, "\033[0m\n");
+        free_program_tree(&tree);
+        return 1;
+    }
+
+    snprintf(tree_filename, sizeof(tree_filename), "%s.arvore", source_filename);
+    size_t size = write_tree_snapshot(&tree, source_filename, tree_filename);
+    if (size > 0) {
+        snprintf(line, sizeof(line), "\n\033[1;35mArvore salva em:\033[0m %s (%d comandos, %d expressoes, %d simbolos, %zu bytes)\n",
+                 tree_filename, tree.statement_count, tree.expression_count, tree.variable_count, size);
+        out_str(console, line);
+    } else {
+        out_literal(console, "Erro ao criar arquivo de saida\n");
+    }
+    free_program_tree(&tree);
+    stats.phase_seconds[STATS_PHASE_EXECUTION] += monotonic_seconds() - phase_start;
+    return size > 0 ? 0 : 1;
+}
+
+// --emit-c: traduz a arvore de execucao para C com a mesma semantica de
+// --executar (mesmos erros, mesmo limite de passos e mesma saida final).
+// Cada no de expressao vira uma constante local na ordem de avaliacao do
+// interpretador, entao o primeiro erro de execucao e o mesmo nos dois.
+// O operando e so o no (folha) ou o numero do temporario: o texto e escrito
+// nos buffers do emissor, fora da recursao, que assim usa pouca pilha por nivel
+typedef struct {
+    int32_t expression;
+    int32_t temporary;  // -1 nas folhas: literal ou variavel escritos direto
+    bool real;
+} COperand;
+
+typedef struct {
+    OutputBuffer* out;
+    const ProgramTree* tree;
+    int32_t temporaries;
+    bool fallible;
+    bool unchecked;  // passos ja conferidos antes do laco contado: so conta
+    char line[2 * MAX_LEXEME + 224];
+    char label[MAX_LEXEME + 64];
+    char operands[2][MAX_LEXEME + 80];
+} CEmitter;
+
+static const char c_prelude[] =
+    "#include <stdio.h>\n"
+    "#include <stdint.h>\n"
+    "#include <inttypes.h>\n"
+    "#include <math.h>\n"
+    "#include <time.h>\n"
+    "\n"
+    "static const char* mpas_error = NULL;\n"
+    "\n"
+    "// integer: aritmetica modular em 64 bits, como no interpretador\n"
+    "static inline int64_t mpas_add(int64_t a, int64_t b) { return (int64_t)((uint64_t)a + (uint64_t)b); }\n"
+    "static inline int64_t mpas_sub(int64_t a, int64_t b) { return (int64_t)((uint64_t)a - (uint64_t)b); }\n"
+    "static inline int64_t mpas_mul(int64_t a, int64_t b) { return (int64_t)((uint64_t)a * (uint64_t)b); }\n"
+    "static inline int64_t mpas_neg(int64_t a) { return (int64_t)(0 - (uint64_t)a); }\n"
+    "\n"
+    "static inline void mpas_fail(const char* message) {\n"
+    "    if (mpas_error == NULL) mpas_error = message;\n"
+    "}\n"
+    "\n"
+    "static inline double mpas_div(double a, double b) {\n"
+    "    if (b == 0.0) {\n"
+    "        mpas_fail(\"divisao por zero\");\n"
+    "        return 0.0;\n"
+    "    }\n"
+    "    return a / b;\n"
+    "}\n"
+    "\n"
+    "static inline int64_t mpas_mod(int64_t a, int64_t b) {\n"
+    "    if (b == 0) {\n"
+    "        mpas_fail(\"mod por zero\");\n"
+    "        return 0;\n"
+    "    }\n"
+    "    return b == -1 ? 0 : a % b;\n"
+    "}\n"
+    "\n"
+    "static inline int64_t mpas_mod_real(void) {\n"
+    "    mpas_fail(\"mod exige operandos inteiros\");\n"
+    "    return 0;\n"
+    "}\n"
+    "\n"
+    "static inline int64_t mpas_trunc(double value) {\n"
+    "    if (value > -9223372036854775808.0 && value < 9223372036854775808.0) return (int64_t)value;\n"
+    "    mpas_fail(\"valor real fora do intervalo de integer\");\n"
+    "    return 0;\n"
+    "}\n"
+    "\n"
+    "// Lacos contados (ver loop_trip_count): voltas de v op limite somando step;\n"
+    "// op 0 '<', 1 '<=', 2 '>', 3 '>=', 4 '<>'. 0 se o laco nao termina ou v estoura\n"
+    "static inline int mpas_trip(int op, int64_t from, int64_t to, int64_t step, uint64_t* trips) {\n"
+    "    __int128 a = from, b = to, k = step, n = 0;\n"
+    "    switch (op) {\n"
+    "        case 0: if (a < b) n = k > 0 ? (b - a + k - 1) / k : -1; break;\n"
+    "        case 1: if (a <= b) n = k > 0 ? (b - a) / k + 1 : -1; break;\n"
+    "        case 2: if (a > b) n = k > 0 ? -1 : (a - b - k - 1) / -k; break;\n"
+    "        case 3: if (a >= b) n = k > 0 ? -1 : (a - b) / -k + 1; break;\n"
+    "        default: if (a != b) n = (b - a) % k == 0 && (b - a) / k > 0 ? (b - a) / k : -1; break;\n"
+    "    }\n"
+    "    if (n < 0 || a + n * k > INT64_MAX || a + n * k < INT64_MIN) return 0;\n"
+    "    *trips = (uint64_t)n;\n"
+    "    return 1;\n"
+    "}\n"
+    "\n"
+    "// n * (n - 1) / 2 modulo 2^64\n"
+    "static inline uint64_t mpas_triangle(uint64_t n) {\n"
+    "    return n % 2 == 0 ? (n / 2) * (n - 1) : n * ((n - 1) / 2);\n"
+    "}\n"
+    "\n"
+    "static double mpas_seconds(void) {\n"
+    "    struct timespec now;\n"
+    "    clock_gettime(CLOCK_MONOTONIC, &now);\n"
+    "    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;\n"
+    "}\n"
+    "\n"
+    "static void mpas_print(const char* name, int real, int64_t integer, double real_value) {\n"
+    "    char value[64];\n"
+    "    if (real) snprintf(value, sizeof(value), \"%.15g\", real_value);\n"
+    "    else snprintf(value, sizeof(value), \"%\" PRId64, integer);\n"
+    "    printf(\"%-20s %-10s %s\\n\", name, real ? \"real\" : \"integer\", value);\n"
+    "}\n"
+    "\n";
+
+static void emit_indent(CEmitter* emitter, int level) {
+    for (int i = 0; i < level; i++) out_literal(emitter->out, "    ");
+}
+
+static void emit_line(CEmitter* emitter, int level, const char* text) {
+    emit_indent(emitter, level);
+    out_str(emitter->out, text);
+    out_char(emitter->out, '\n');
+}
+
+// Texto do operando no buffer slot do emissor; as_real converte integer
+static const char* c_operand(CEmitter* emitter, const COperand* operand, int slot, bool as_real) {
+    char* text = emitter->operands[slot];
+    size_t size = sizeof(emitter->operands[slot]);
+    const ExpressionNode* node = &emitter->tree->expressions[operand->expression];
+    int length = as_real && !operand->real ? snprintf(text, size, "(double)") : 0;
+
+    if (operand->temporary >= 0) {
+        snprintf(text + length, size - length, "t%d", (int)operand->temporary);
+    } else if (node->kind == EXPR_INTEGER) {
+        if (node->integer == INT64_MIN) snprintf(text + length, size - length, "INT64_MIN");
+        else snprintf(text + length, size - length, "INT64_C(%lld)", (long long)node->integer);
+    } else if (node->kind == EXPR_REAL) {
+        // Hexadecimal: o mesmo double que strtod deu ao interpretador
+        if (isinf(node->real)) snprintf(text + length, size - length, "%sINFINITY", node->real < 0 ? "-" : "");
+        else snprintf(text + length, size - length, "%a", node->real);
+    } else {
+        snprintf(text + length, size - length, "v_%s", emitter->tree->variables[node->variable].name);
+    }
+    return text;
+}
+
+static COperand emit_c_expression(CEmitter* emitter, int32_t id, int level) {
+    const ExpressionNode* node = &emitter->tree->expressions[id];
+    COperand result = { id, -1, false };
+
+    switch (node->kind) {
+        case EXPR_INTEGER:
+            return result;
+        case EXPR_REAL:
+            result.real = true;
+            return result;
+        case EXPR_VARIABLE:
+            result.real = emitter->tree->variables[node->variable].real;
+            return result;
+        case EXPR_NEGATE: {
+            COperand operand = emit_c_expression(emitter, node->left, level);
+            result.real = operand.real;
+            result.temporary = emitter->temporaries++;
+            snprintf(emitter->line, sizeof(emitter->line), operand.real ? "const double t%d = -%s;" : "const int64_t t%d = mpas_neg(%s);",
+                     (int)result.temporary, c_operand(emitter, &operand, 0, false));
+            emit_line(emitter, level, emitter->line);
+            return result;
+        }
+        case EXPR_BINARY:
+            break;
+    }
+
+    COperand left = emit_c_expression(emitter, node->left, level);
+    COperand right = emit_c_expression(emitter, node->right, level);
+    bool real = left.real || right.real;
+    // Operandos em double onde a operacao e real (como no interpretador)
+    bool as_real = node->op == OP_DIV || (real && node->op != OP_MOD);
+    const char* a = c_operand(emitter, &left, 0, as_real);
+    const char* b = c_operand(emitter, &right, 1, as_real);
+    char* line = emitter->line;
+    size_t size = sizeof(emitter->line);
+    int t = (int)(result.temporary = emitter->temporaries++);
+
+    switch (node->op) {
+        case OP_AD:
+        case OP_MIN:
+        case OP_MUL:
+            result.real = real;
+            if (real) {
+                snprintf(line, size, "const double t%d = %s %c %s;", t, a,
+                         node->op == OP_AD ? '+' : node->op == OP_MIN ? '-' : '*', b);
+            } else {
+                snprintf(line, size, "const int64_t t%d = mpas_%s(%s, %s);", t,
+                         node->op == OP_AD ? "add" : node->op == OP_MIN ? "sub" : "mul", a, b);
+            }
+            break;
+        case OP_DIV:
+            result.real = true;
+            emitter->fallible = true;
+            snprintf(line, size, "const double t%d = mpas_div(%s, %s);", t, a, b);
+            break;
+        case OP_MOD:
+            emitter->fallible = true;
+            if (real) snprintf(line, size, "const int64_t t%d = mpas_mod_real();", t);
+            else snprintf(line, size, "const int64_t t%d = mpas_mod(%s, %s);", t, a, b);
+            break;
+        default: {
+            const char* op = node->op == OP_EQ ? "==" : node->op == OP_NE ? "!=" : node->op == OP_LT ? "<"
+                           : node->op == OP_LE ? "<=" : node->op == OP_GT ? ">" : ">=";
+            snprintf(line, size, "const int64_t t%d = %s %s %s;", t, a, op, b);
+            break;
+        }
+    }
+    emit_line(emitter, level, line);
+    return result;
+}
+
+// Prologo de cada comando: conta o passo e, com limite, para no comando
+// que o estourou (como execute_statement)
+static void emit_c_step(CEmitter* emitter, const StatementNode* node, int level) {
+    char line[160];
+    if (options.max_steps > 0 && !emitter->unchecked) {
+        snprintf(line, sizeof(line), "if (++mpas_steps > UINT64_C(%llu)) { mpas_line = %lld; mpas_limit = 1; goto mpas_end; }",
+                 (unsigned long long)options.max_steps, (long long)node->line);
+    } else {
+        snprintf(line, sizeof(line), "mpas_steps++;");
+    }
+    emit_line(emitter, level, line);
+}
+
+static void emit_c_check(CEmitter* emitter, const StatementNode* node, int level) {
+    char line[96];
+    if (!emitter->fallible) return;
+    snprintf(line, sizeof(line), "if (mpas_error) { mpas_line = %lld; goto mpas_end; }", (long long)node->line);
+    emit_line(emitter, level, line);
+    emitter->fallible = false;
+}
+
+static void emit_c_statement(CEmitter* emitter, int32_t id, int level);
+
+// Valor da expressao de uma atribuicao do corpo na volta dada por trip
+// (texto uint64_t), guardado em prefix result: v e, na acumulacao, o alvo
+// valendo 0 entram como locais que escondem as variaveis do programa
+static void emit_c_loop_value(CEmitter* emitter, const CountedLoop* loop, const LoopAssignment* assignment,
+                              const char* trip, const char* prefix, const char* result, int level) {
+    const StatementNode* node = &emitter->tree->statements[assignment->statement];
+    char* line = emitter->line;
+    size_t size = sizeof(emitter->line);
+
+    emit_line(emitter, level, "{");
+    if (count_reads(emitter->tree, node->expression, loop->variable) > 0) {
+        snprintf(line, size, "const int64_t v_%s = (int64_t)((uint64_t)mpas_from + (%s + %d) * UINT64_C(%llu));",
+                 emitter->tree->variables[loop->variable].name, trip, assignment->after_induction,
+                 (unsigned long long)loop->step);
+        emit_line(emitter, level + 1, line);
+    }
+    if (assignment->role == LOOP_ACCUMULATE) {
+        snprintf(line, size, "const int64_t v_%s = 0;", emitter->tree->variables[node->variable].name);
+        emit_line(emitter, level + 1, line);
+    }
+    COperand value = emit_c_expression(emitter, node->expression, level + 1);
+    snprintf(line, size, "%s%s = %s;", prefix, result, c_operand(emitter, &value, 0, false));
+    emit_line(emitter, level + 1, line);
+    emit_line(emitter, level, "}");
+}
+
+// Laco contado com corpo so de atribuicoes, ja com mpas_n voltas: forma
+// fechada das acumulacoes afins em v, soma das demais num laco sem
+// dependencia entre as voltas (vetorizavel) e so a ultima volta de t := e
+static void emit_c_loop_closed(CEmitter* emitter, const CountedLoop* loop, int level) {
+    const ProgramTree* tree = emitter->tree;
+    char* line = emitter->line;
+    size_t size = sizeof(emitter->line);
+
+    snprintf(line, size, "mpas_steps += mpas_n * %u;", loop->steps_per_iteration);
+    emit_line(emitter, level, line);
+    for (int32_t i = 0; i < loop->assignment_count; i++) {
+        const LoopAssignment* assignment = &tree->loop_assignments[loop->first_assignment + i];
+        const char* target = tree->variables[tree->statements[assignment->statement].variable].name;
+        if (assignment->role == LOOP_SET) {
+            emit_line(emitter, level, "if (mpas_n > 0)");
+            emit_c_loop_value(emitter, loop, assignment, "(mpas_n - 1)", "v_", target, level);
+        } else if (assignment->role == LOOP_ACCUMULATE && assignment->degree <= 1) {
+            emit_line(emitter, level, "{");
+            emit_line(emitter, level + 1, "int64_t mpas_first, mpas_second;");
+            emit_c_loop_value(emitter, loop, assignment, "UINT64_C(0)", "", "mpas_first", level + 1);
+            emit_c_loop_value(emitter, loop, assignment, "UINT64_C(1)", "", "mpas_second", level + 1);
+            snprintf(line, size, "v_%s = (int64_t)((uint64_t)v_%s + (uint64_t)mpas_first * mpas_n + "
+                     "((uint64_t)mpas_second - (uint64_t)mpas_first) * mpas_triangle(mpas_n));", target, target);
+            emit_line(emitter, level + 1, line);
+            emit_line(emitter, level, "}");
+        } else if (assignment->role == LOOP_ACCUMULATE) {
+            emit_line(emitter, level, "{");
+            emit_line(emitter, level + 1, "uint64_t mpas_sum = 0;");
+            emit_line(emitter, level + 1, "for (uint64_t mpas_j = 0; mpas_j < mpas_n; mpas_j++) {");
+            emit_line(emitter, level + 2, "int64_t mpas_term;");
+            emit_c_loop_value(emitter, loop, assignment, "mpas_j", "", "mpas_term", level + 2);
+            emit_line(emitter, level + 2, "mpas_sum += (uint64_t)mpas_term;");
+            emit_line(emitter, level + 1, "}");
+            snprintf(line, size, "v_%s = (int64_t)((uint64_t)v_%s + mpas_sum);", target, target);
+            emit_line(emitter, level + 1, line);
+            emit_line(emitter, level, "}");
+        }
+    }
+    snprintf(line, size, "v_%s = (int64_t)((uint64_t)mpas_from + mpas_n * UINT64_C(%llu));",
+             tree->variables[loop->variable].name, (unsigned long long)loop->step);
+    emit_line(emitter, level, line);
+}
+
+// Laco contado: com as voltas conhecidas e os passos cabendo no limite, o
+// corpo roda sem condicao nem conferencia do limite (desenrolado pelo cc)
+// ou vira a forma fechada; senao, o laco normal
+static void emit_c_counted_loop(CEmitter* emitter, const StatementNode* node, const CountedLoop* loop, int level) {
+    static const char* const conditions[] = { "<", "<=", ">", ">=", "<>" };
+    char* line = emitter->line;
+    size_t size = sizeof(emitter->line);
+    int op = loop->op == OP_LT ? 0 : loop->op == OP_LE ? 1 : loop->op == OP_GT ? 2 : loop->op == OP_GE ? 3 : 4;
+
+    // O limite e literal ou variavel: nenhum temporario
+    COperand limit = emit_c_expression(emitter, loop->limit, level + 1);
+    snprintf(line, size, "// laco contado: %s %s %s, passo %lld", emitter->tree->variables[loop->variable].name,
+             conditions[op], c_operand(emitter, &limit, 0, false), (long long)loop->step);
+    emit_line(emitter, level, line);
+    emit_line(emitter, level, "{");
+    snprintf(line, size, "const int64_t mpas_from = v_%s;", emitter->tree->variables[loop->variable].name);
+    emit_line(emitter, level + 1, line);
+    emit_line(emitter, level + 1, "uint64_t mpas_n;");
+    snprintf(line, size, "if (mpas_trip(%d, mpas_from, %s, INT64_C(%lld), &mpas_n)", op, c_operand(emitter, &limit, 0, false), (long long)loop->step);
+    emit_indent(emitter, level + 1);
+    out_str(emitter->out, line);
+    if (options.max_steps > 0) {
+        snprintf(line, size, " && mpas_steps <= UINT64_C(%llu) && mpas_n <= (UINT64_C(%llu) - mpas_steps) / %u",
+                 (unsigned long long)options.max_steps, (unsigned long long)options.max_steps, loop->steps_per_iteration);
+        out_str(emitter->out, line);
+    }
+    out_literal(emitter->out, ") {\n");
+
+    if (loop->kind == LOOP_STRAIGHT) {
+        emitter->unchecked = true;
+        emit_line(emitter, level + 2, "#pragma GCC unroll 4");
+        emit_line(emitter, level + 2, "for (uint64_t mpas_j = 0; mpas_j < mpas_n; mpas_j++) {");
+        emit_c_statement(emitter, node->body, level + 3);
+        emit_line(emitter, level + 2, "}");
+        emitter->unchecked = false;
+    } else {
+        emit_c_loop_closed(emitter, loop, level + 2);
+    }
+
+    emit_line(emitter, level + 1, "} else {");
+    emit_line(emitter, level + 2, "for (;;) {");
+    COperand condition = emit_c_expression(emitter, node->expression, level + 3);
+    snprintf(line, size, "if (%s == 0) break;", c_operand(emitter, &condition, 0, false));
+    emit_line(emitter, level + 3, line);
+    emit_c_statement(emitter, node->body, level + 3);
+    emit_line(emitter, level + 2, "}");
+    emit_line(emitter, level + 1, "}");
+    emit_line(emitter, level, "}");
+}
+
+static void emit_c_statement(CEmitter* emitter, int32_t id, int level) {
+    const StatementNode* node = &emitter->tree->statements[id];
+    char* line = emitter->line;
+    size_t size = sizeof(emitter->line);
+
+    statement_label(emitter->tree, id, emitter->label, sizeof(emitter->label));
+    snprintf(line, size, "// %s", emitter->label);
+    emit_line(emitter, level, line);
+    emit_c_step(emitter, node, level);
+
+    switch (node->kind) {
+        case STMT_ASSIGNMENT: {
+            const ProgramVariable* variable = &emitter->tree->variables[node->variable];
+            emit_line(emitter, level, "{");
+            COperand value = emit_c_expression(emitter, node->expression, level + 1);
+            if (variable->real) {
+                snprintf(line, size, "const double value = %s;", c_operand(emitter, &value, 0, true));
+            } else if (value.real) {
+                emitter->fallible = true;
+                snprintf(line, size, "const int64_t value = mpas_trunc(%s);", c_operand(emitter, &value, 0, false));
+            } else {
+                snprintf(line, size, "const int64_t value = %s;", c_operand(emitter, &value, 0, false));
+            }
+            emit_line(emitter, level + 1, line);
+            emit_c_check(emitter, node, level + 1);
+            snprintf(line, size, "v_%s = value;", variable->name);
+            emit_line(emitter, level + 1, line);
+            emit_line(emitter, level, "}");
+            break;
+        }
+        case STMT_COMPOUND:
+            emit_line(emitter, level, "{");
+            for (int32_t child = node->body; child >= 0; child = emitter->tree->statements[child].next) {
+                emit_c_statement(emitter, child, level + 1);
+            }
+            emit_line(emitter, level, "}");
+            break;
+        case STMT_CONDITIONAL: {
+            emit_line(emitter, level, "{");
+            COperand condition = emit_c_expression(emitter, node->expression, level + 1);
+            emit_c_check(emitter, node, level + 1);
+            snprintf(line, size, "if (%s != 0) {", c_operand(emitter, &condition, 0, false));
+            emit_line(emitter, level + 1, line);
+            if (node->body >= 0) emit_c_statement(emitter, node->body, level + 2);
+            if (node->alternative >= 0) {
+                emit_line(emitter, level + 1, "} else {");
+                emit_c_statement(emitter, node->alternative, level + 2);
+            }
+            emit_line(emitter, level + 1, "}");
+            emit_line(emitter, level, "}");
+            break;
+        }
+        case STMT_REPETITIVE: {
+            if (node->loop >= 0 && emitter->tree->loops[node->loop].kind != LOOP_COUNTED) {
+                emit_c_counted_loop(emitter, node, &emitter->tree->loops[node->loop], level);
+                break;
+            }
+            emit_line(emitter, level, "for (;;) {");
+            COperand condition = emit_c_expression(emitter, node->expression, level + 1);
+            emit_c_check(emitter, node, level + 1);
+            snprintf(line, size, "if (%s == 0) break;", c_operand(emitter, &condition, 0, false));
+            emit_line(emitter, level + 1, line);
+            emit_c_statement(emitter, node->body, level + 1);
+            emit_line(emitter, level, "}");
+            break;
+        }
+    }
+}
+
+bool emit_c_program(const ProgramTree* tree, const char* source_filename, const char* c_filename) {
+    int fd = open(c_filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) return false;
+
+    OutputBuffer out;
+    CEmitter emitter = { 0 };
+    char line[2 * MAX_LEXEME + 160];
+    emitter.out = &out;
+    emitter.tree = tree;
+    out_init(&out, fd);
+
+    out_literal(&out, "// Gerado por analisadorlexsint --emit-c a partir de ");
+    out_str(&out, source_filename);
+    out_literal(&out, "; nao editar.\n");
+    out_write(&out, c_prelude, sizeof(c_prelude) - 1);
+    out_literal(&out, "int main(void) {\n");
+    for (int32_t i = 0; i < tree->variable_count; i++) {
+        snprintf(line, sizeof(line), "%s v_%s = 0;", tree->variables[i].real ? "double" : "int64_t", tree->variables[i].name);
+        emit_line(&emitter, 1, line);
+    }
+    emit_line(&emitter, 1, "uint64_t mpas_steps = 0;");
+    emit_line(&emitter, 1, "int64_t mpas_line = 0;");
+    emit_line(&emitter, 1, "int mpas_limit = 0;");
+    emit_line(&emitter, 1, "double mpas_start = mpas_seconds();");
+    out_char(&out, '\n');
+
+    emit_c_statement(&emitter, tree->body, 1);
+
+    out_literal(&out, "\nmpas_end:\n");
+    emit_line(&emitter, 1, "(void)mpas_line;");
+    emit_line(&emitter, 1, "(void)mpas_limit;");
+    emit_line(&emitter, 1, "double mpas_elapsed = mpas_seconds() - mpas_start;");
+    emit_line(&emitter, 1, "if (mpas_error != NULL) {");
+    emit_line(&emitter, 2, "printf(\"\\033[1;31mERRO DE EXECUCAO (Linha %\" PRId64 \"): %s\\033[0m\\n\", mpas_line, mpas_error);");
+    emit_line(&emitter, 1, "} else if (mpas_limit) {");
+    snprintf(line, sizeof(line), "printf(\"\\033[1;33mExecucao interrompida (Linha %%\" PRId64 \"): limite de %llu comandos atingido\\033[0m\\n\", mpas_line);",
+             (unsigned long long)options.max_steps);
+    emit_line(&emitter, 2, line);
+    emit_line(&emitter, 1, "}");
+    emit_line(&emitter, 1, "printf(\"VARIAVEL             TIPO       VALOR\\n\");");
+    emit_line(&emitter, 1, "printf(\"--------------------------------------------\\n\");");
+    for (int32_t i = 0; i < tree->variable_count; i++) {
+        const ProgramVariable* variable = &tree->variables[i];
+        if (variable->real) snprintf(line, sizeof(line), "mpas_print(\"%s\", 1, 0, v_%s);", variable->name, variable->name);
+        else snprintf(line, sizeof(line), "mpas_print(\"%s\", 0, v_%s, 0.0);", variable->name, variable->name);
+        emit_line(&emitter, 1, line);
+    }
+    if (options.max_steps > 0) {
+        snprintf(line, sizeof(line), "if (mpas_steps > UINT64_C(%llu)) mpas_steps = UINT64_C(%llu);",
+                 (unsigned long long)options.max_steps, (unsigned long long)options.max_steps);
+        emit_line(&emitter, 1, line);
+    }
+    emit_line(&emitter, 1, "printf(\"\\n%\" PRIu64 \" comandos executados em %.6f s\\n\", mpas_steps, mpas_elapsed);");
+    emit_line(&emitter, 1, "return mpas_error != NULL;");
+    out_literal(&out, "}\n");
+
+    out_flush(&out);
+    out_free(&out);
+    close(fd);
+    return true;
+}
+
+// Roda o comando e espera; devolve o codigo de saida (-1 se nao rodou)
+static int run_process(char* const* args) {
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        execvp(args[0], args);
+        _exit(127);
+    }
+    int status;
+    if (waitpid(pid, &status, 0) < 0) return -1;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+// Binarios ficam em <--cache>/ ou em $XDG_CACHE_HOME/mpas (~/.cache/mpas),
+// com o nome dado pelo hash do C gerado e do comando do compilador
+static void native_cache_dir(char* path, size_t size) {
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+
+    if (options.cache_dir != NULL) {
+        snprintf(path, size, "%s", options.cache_dir);
+    } else if (xdg != NULL && xdg[0] != '\0') {
+        mkdir(xdg, 0777);
+        snprintf(path, size, "%s/mpas", xdg);
+    } else if (home != NULL && home[0] != '\0') {
+        snprintf(path, size, "%s/.cache", home);
+        mkdir(path, 0777);
+        snprintf(path, size, "%s/.cache/mpas", home);
+    } else {
+        snprintf(path, size, "/tmp/mpas-%d", (int)getuid());
+    }
+    mkdir(path, 0777);
+}
+
+// --compilar: cc no C gerado (ou o binario ja em cache) e roda o nativo
+static int compile_and_run(const char* c_filename, OutputBuffer* console) {
+    const char* compiler = getenv("CC") != NULL && getenv("CC")[0] != '\0' ? getenv("CC") : "cc";
+    char cache_dir[PATH_MAX], binary[PATH_MAX + 32], temporary[PATH_MAX + 64], line[PATH_MAX + 128];
+    size_t size;
+    char* source = read_file(c_filename, &size);
+    if (source == NULL) return 1;
+
+    // A primeira linha e o comentario com o caminho do fonte: fica fora do
+    // hash, para o mesmo programa em outro arquivo achar o mesmo binario
+    const char* text = memchr(source, '\n', size);
+    text = text != NULL ? text + 1 : source;
+    uint64_t hash = hash_bytes(text, size - (size_t)(text - source), 0);
+    hash = hash_bytes(compiler, strlen(compiler), hash);
+    hash = hash_bytes(NATIVE_CC_FLAGS, sizeof(NATIVE_CC_FLAGS) - 1, hash);
+    free_file(source, size);
+
+    native_cache_dir(cache_dir, sizeof(cache_dir));
+    snprintf(binary, sizeof(binary), "%s/%016llx.nativo", cache_dir, (unsigned long long)hash);
+
+    struct stat info;
+    if (stat(binary, &info) == 0) {
+        utime(binary, NULL);
+        out_literal(console, "\033[1;35mBinario (cache):\033[0m ");
+    } else {
+        double start = monotonic_seconds();
+        snprintf(temporary, sizeof(temporary), "%s.%d.tmp", binary, (int)getpid());
+        char* args[] = { (char*)compiler, NATIVE_CC_FLAG_LIST, "-o", temporary, (char*)c_filename, NULL };
+        out_flush(console);
+        if (run_process(args) != 0 || rename(temporary, binary) != 0) {
+            unlink(temporary);
+            out_literal(console, "\033[1;31mErro ao compilar ");
+            out_str(console, c_filename);
+            out_literal(console, " com ");
+            out_str(console, compiler);
+            out_literal(console, "\033[0m\n");
+            return 1;
+        }
+        snprintf(line, sizeof(line), "\033[1;35mBinario (compilado em %.3f s):\033[0m ", monotonic_seconds() - start);
+        out_str(console, line);
+        cache_evict(cache_dir, options.cache_max_bytes, strrchr(binary, '/') + 1);
+    }
+    out_str(console, binary);
+    out_char(console, '\n');
+
+    out_literal(console, "\n\t---- EXECUCAO ----\n");
+    out_flush(console);
+    char* args[] = { binary, NULL };
+    return run_process(args);
+}
+
+int translate_program(const char* source_filename, OutputBuffer* console) {
+    double phase_start = monotonic_seconds();
+    ProgramTree tree;
+    TreeBuilder builder;
+    char c_filename[PATH_MAX];
+    int status = 0;
+
+    out_literal(console, "\n\t---- TRADUCAO PARA C ----\n");
+    if (!build_program_tree(source_filename, &tree, &builder)) {
+        out_literal(console, "\033[1;31mERRO NA TRADUCAO (Linha ");
+        out_int(console, builder.error_line);
+        out_literal(console, "): ");
+        out_str(console, builder.error);
+        out_literal(console, "\033[0m\n");
+        free_program_tree(&tree);
+        return 1;
+    }
+
+    snprintf(c_filename, sizeof(c_filename), "%s.c", source_filename);
+    if (emit_c_program(&tree, source_filename, c_filename)) {
+        out_literal(console, "\033[1;35mCodigo C salvo em:\033[0m ");
+        out_str(console, c_filename);
+        out_char(console, '\n');
+    } else {
+        out_literal(console, "Erro ao criar arquivo de saida\n");
+        status = 1;
+    }
+    if (options.loop_report) print_loop_report(console, &tree);
+    free_program_tree(&tree);
+    stats.phase_seconds[STATS_PHASE_EXECUTION] += monotonic_seconds() - phase_start;
+
+    if (status == 0 && options.compile) {
+        phase_start = monotonic_seconds();
+        status = compile_and_run(c_filename, console);
+        stats.phase_seconds[STATS_PHASE_EXECUTION] += monotonic_seconds() - phase_start;
+    }
+    return status;
+}
+
+// --watch <dir>: analisa os .mpas da arvore e depois so os que mudaram,
+// avisado pelo inotify. Rajadas de escrita no mesmo arquivo sao agrupadas
+// (WATCH_DEBOUNCE_MSEC depois do ultimo evento). Cada arquivo guarda em
+// memoria o hash do fonte, o ultimo .lex/.syntax, a tabela de simbolos e o
+// veredito: fonte igual nao e reanalisado, e so a saida que mudou e regravada
+typedef struct {
+    char* path;
+    bool analyzed;
+    uint64_t source_hash;
+    int status;
+    uint64_t tokens;
+    SymbolTable symbols;
+    OutputBuffer lex;
+    OutputBuffer syntax;
+    double deadline;  // 0: nada pendente
+} WatchedFile;
+
+typedef struct {
+    int fd;
+    char** directories;  // indexado pelo descritor do inotify
+    int directory_capacity;
+    int directory_count;
+    WatchedFile* files;
+    int file_count;
+    int file_capacity;
+    uint64_t analyses;
+    uint64_t unchanged;
+    uint64_t rewritten;
+    double analysis_seconds;
+    double analysis_cpu_seconds;
+    struct timespec started;  // CLOCK_REALTIME, comparavel ao mtime
+    Interner* interner;
+} Watcher;
+
+volatile sig_atomic_t watch_stop = 0;
+
+static void watch_signal(int signal_number) {
+    (void)signal_number;
+    watch_stop = 1;
+}
+
+static bool is_mpas_file(const char* name) {
+    size_t length = strlen(name);
+    return length > 5 && strcmp(name + length - 5, ".mpas") == 0;
+}
+
+static WatchedFile* watch_find_file(Watcher* watcher, const char* path, bool create) {
+    for (int i = 0; i < watcher->file_count; i++) {
+        if (strcmp(watcher->files[i].path, path) == 0) return &watcher->files[i];
+    }
+    if (!create) return NULL;
+    if (watcher->file_count == watcher->file_capacity) {
+        int old_capacity = watcher->file_capacity;
+        watcher->file_capacity = old_capacity == 0 ? 64 : old_capacity * 2;
+        watcher->files = mem_realloc(MEMORY_SOURCE, watcher->files, (size_t)old_capacity * sizeof(WatchedFile),
+                                     (size_t)watcher->file_capacity * sizeof(WatchedFile));
+    }
+    WatchedFile* file = &watcher->files[watcher->file_count++];
+    memset(file, 0, sizeof(*file));
+    file->path = mem_alloc(MEMORY_SOURCE, strlen(path) + 1);
+    strcpy(file->path, path);
+    return file;
+}
+
+static void watch_forget_state(WatchedFile* file) {
+    if (!file->analyzed) return;
+    free_symbol_table(&file->symbols);
+    out_free(&file->lex);
+    if (file->syntax.data != NULL) out_free(&file->syntax);
+    file->analyzed = false;
+}
+
+// O ultimo do vetor ocupa o lugar do removido
+static void watch_remove_file(Watcher* watcher, WatchedFile* file) {
+    watch_forget_state(file);
+    mem_free(MEMORY_SOURCE, file->path, strlen(file->path) + 1);
+    *file = watcher->files[--watcher->file_count];
+}
+
+// Marca para analise quando a rajada de eventos terminar
+static void watch_schedule(Watcher* watcher, const char* path, double now, double delay) {
+    WatchedFile* file = watch_find_file(watcher, path, true);
+    file->deadline = now + delay;
+}
+
+// Vigia dir e seus subdiretorios; os .mpas encontrados ficam pendentes
+static void watch_add_tree(Watcher* watcher, const char* dir, double now) {
+    int wd = inotify_add_watch(watcher->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_MODIFY |
+                                                 IN_CREATE | IN_DELETE | IN_ONLYDIR);
+    if (wd < 0) return;
+    if (wd >= watcher->directory_capacity) {
+        int old_capacity = watcher->directory_capacity;
+        watcher->directory_capacity = wd * 2 + 16;
+        watcher->directories = mem_realloc(MEMORY_SOURCE, watcher->directories, (size_t)old_capacity * sizeof(char*),
+                                           (size_t)watcher->directory_capacity * sizeof(char*));
+        memset(watcher->directories + old_capacity, 0,
+               (size_t)(watcher->directory_capacity - old_capacity) * sizeof(char*));
+    }
+    if (watcher->directories[wd] == NULL) {
+        watcher->directories[wd] = mem_alloc(MEMORY_SOURCE, strlen(dir) + 1);
+        strcpy(watcher->directories[wd], dir);
+        watcher->directory_count++;
+    }
+
+    DIR* handle = opendir(dir);
+    struct dirent* item;
+    if (handle == NULL) return;
+    while ((item = readdir(handle)) != NULL) {
+        char path[PATH_MAX];
+        struct stat info;
+        if (item->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, item->d_name);
+        if (stat(path, &info) != 0) continue;
+        if (S_ISDIR(info.st_mode)) watch_add_tree(watcher, path, now);
+        else if (S_ISREG(info.st_mode) && is_mpas_file(item->d_name)) watch_schedule(watcher, path, now, 0);
+    }
+    closedir(handle);
+}
+
+// Grava o arquivo se o conteudo mudou (ou se ele sumiu do disco). Sem saida
+// anterior em memoria (primeira analise) compara com o que esta no disco
+static bool watch_update_output(const char* filename, const OutputBuffer* previous, const OutputBuffer* current) {
+    struct stat info;
+    bool same = false;
+    if (stat(filename, &info) == 0 && (size_t)info.st_size == current->length) {
+        if (previous->data != NULL) {
+            same = previous->length == current->length && memcmp(previous->data, current->data, current->length) == 0;
+        } else {
+            size_t size;
+            char* saved = read_file(filename, &size);
+            same = saved != NULL && size == current->length && memcmp(saved, current->data, size) == 0;
+            free_file(saved, size);
+        }
+    }
+    if (same) return false;
+    return write_file(filename, current->data, current->length) == 0;
+}
+
+// Simbolos que estao em table e nao em other
+static int symbols_missing(SymbolTable* table, SymbolTable* other) {
+    int missing = 0;
+    for (int i = 0; i < table->count; i++) {
+        if (find_symbol(other, table->symbols[i].name) == NULL) missing++;
+    }
+    return missing;
+}
+
+static void watch_analyze(Watcher* watcher, WatchedFile* file, OutputBuffer* console) {
+    char line[PATH_MAX + 256], filename[PATH_MAX + 16];
+    struct stat info;
+    size_t size;
+    double start = monotonic_seconds(), cpu_start = process_cpu_seconds();
+    char* source = stat(file->path, &info) == 0 ? read_file(file->path, &size) : NULL;
+
+    file->deadline = 0;
+    if (source == NULL) {
+        out_literal(console, "\033[1;35m[removido]\033[0m ");
+        out_str(console, file->path);
+        out_char(console, '\n');
+        watch_remove_file(watcher, file);
+        return;
+    }
+    uint64_t source_hash = hash_bytes(source, size, 0);
+    free_file(source, size);
+    if (file->analyzed && source_hash == file->source_hash) {
+        watcher->unchanged++;
+        snprintf(line, sizeof(line), "\033[1;35m[sem mudanca]\033[0m %s: %s (analise anterior)\n", file->path,
+                 file->status == 0 ? "SUCESSO" : "ERROS");
+        out_str(console, line);
+        return;
+    }
+
+    // Relogio de parede do salvamento (mtime) ate o resultado
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    double latency = (double)(now.tv_sec - info.st_mtim.tv_sec) + (double)(now.tv_nsec - info.st_mtim.tv_nsec) / 1e9;
+
+    AnalysisOutputs outputs;
+    OutputBuffer log;
+    memset(&outputs, 0, sizeof(outputs));
+    out_init(&log, OUT_MEMORY);
+    outputs.interner = watcher->interner;
+    memory_outputs = &outputs;
+    int status = analyze_file(file->path, &log, NULL);
+    memory_outputs = NULL;
+
+    if (outputs.lex.data == NULL) {
+        // Falhou antes da passada lexica (arquivo sumiu entre o stat e o open)
+        out_write(console, log.data, log.length);
+        out_free(&log);
+        return;
+    }
+
+    bool lex_written, syntax_written = false;
+    snprintf(filename, sizeof(filename), "%s.lex", file->path);
+    lex_written = watch_update_output(filename, &file->lex, &outputs.lex);
+    if (outputs.syntax.data != NULL) {
+        snprintf(filename, sizeof(filename), "%s.syntax", file->path);
+        syntax_written = watch_update_output(filename, &file->syntax, &outputs.syntax);
+    }
+    int added = file->analyzed ? symbols_missing(&outputs.symbols, &file->symbols) : outputs.symbols.count;
+    int removed = file->analyzed ? symbols_missing(&file->symbols, &outputs.symbols) : 0;
+    double seconds = monotonic_seconds() - start;
+
+    watcher->analyses++;
+    watcher->rewritten += lex_written + syntax_written;
+
+    snprintf(line, sizeof(line), "%s[%s]\033[0m %s: %llu tokens, %d simbolos (+%d -%d); .lex %s", status == 0 ? "\033[1;32m" : "\033[1;31m",
+             status == 0 ? "SUCESSO" : "ERROS", file->path, (unsigned long long)outputs.tokens, outputs.symbols.count,
+             added, removed, lex_written ? "regravado" : "igual");
+    out_str(console, line);
+    if (outputs.syntax.data != NULL) {
+        out_literal(console, ", .syntax ");
+        out_str(console, syntax_written ? "regravado" : "igual");
+    }
+    // Latencia so para o que foi salvo depois do inicio da observacao
+    if (info.st_mtim.tv_sec > watcher->started.tv_sec ||
+        (info.st_mtim.tv_sec == watcher->started.tv_sec && info.st_mtim.tv_nsec >= watcher->started.tv_nsec)) {
+        snprintf(line, sizeof(line), "; analise %.1f ms, latencia %.1f ms\n", seconds * 1e3, latency * 1e3);
+    } else {
+        snprintf(line, sizeof(line), "; analise %.1f ms\n", seconds * 1e3);
+    }
+    out_str(console, line);
+
+    // So os diagnosticos do terminal: linhas que comecam com ERRO
+    int errors = 0;
+    for (size_t position = 0; position < log.length;) {
+        const char* text = log.data + position;
+        const char* end = memchr(text, '\n', log.length - position);
+        size_t length = end != NULL ? (size_t)(end - text) + 1 : log.length - position;
+        if (length > 11 && memcmp(text, "\033[1;31mERRO", 11) == 0 && errors++ < WATCH_REPORT_ERRORS) {
+            out_literal(console, "    ");
+            out_write(console, text, length);
+        }
+        position += length;
+    }
+    if (errors > WATCH_REPORT_ERRORS) {
+        snprintf(line, sizeof(line), "    ... mais %d erros\n", errors - WATCH_REPORT_ERRORS);
+        out_str(console, line);
+    }
+    out_free(&log);
+
+    watch_forget_state(file);
+    file->analyzed = true;
+    file->source_hash = source_hash;
+    file->status = status;
+    file->tokens = outputs.tokens;
+    file->symbols = outputs.symbols;
+    file->lex = outputs.lex;
+    file->syntax = outputs.syntax;
+    // Tudo ate aqui conta como analise; o resto do tempo e ociosidade
+    watcher->analysis_seconds += monotonic_seconds() - start;
+    watcher->analysis_cpu_seconds += process_cpu_seconds() - cpu_start;
+}
+
+static void watch_read_events(Watcher* watcher, double now) {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    double delay = WATCH_DEBOUNCE_MSEC / 1000.0;
+
+    for (;;) {
+        ssize_t length = read(watcher->fd, buffer, sizeof(buffer));
+        if (length <= 0) return;
+        for (char* cursor = buffer; cursor < buffer + length;) {
+            const struct inotify_event* event = (const struct inotify_event*)cursor;
+            cursor += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Eventos perdidos: tudo volta a ser candidato (o hash evita
+                // reanalisar o que nao mudou)
+                for (int i = 0; i < watcher->file_count; i++) watcher->files[i].deadline = now + delay;
+                continue;
+            }
+            if (event->wd < 0 || event->wd >= watcher->directory_capacity || watcher->directories[event->wd] == NULL) continue;
+            if (event->mask & IN_IGNORED) {
+                mem_free(MEMORY_SOURCE, watcher->directories[event->wd], strlen(watcher->directories[event->wd]) + 1);
+                watcher->directories[event->wd] = NULL;
+                watcher->directory_count--;
+                continue;
+            }
+            if (event->len == 0 || event->name[0] == '.') continue;
+
+            char path[PATH_MAX];
+            snprintf(path, sizeof(path), "%s/%s", watcher->directories[event->wd], event->name);
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) watch_add_tree(watcher, path, now + delay);
+            } else if (is_mpas_file(event->name)) {
+                watch_schedule(watcher, path, now, delay);
+            }
+        }
+    }
+}
+
+int watch_directory(const char* dir, OutputBuffer* console) {
+    Watcher watcher;
+    char line[PATH_MAX + 256];
+    memset(&watcher, 0, sizeof(watcher));
+    watcher.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher.fd < 0) {
+        out_literal(console, "Erro ao iniciar o inotify\n");
+        return 1;
+    }
+    // Os nomes de todos os arquivos ficam uma vez so; a tabela guardada de
+    // cada arquivo e so a visao dele
+    Interner interner;
+    init_interner(&interner);
+    watcher.interner = &interner;
+
+    double start = monotonic_seconds(), cpu_start = process_cpu_seconds();
+    clock_gettime(CLOCK_REALTIME, &watcher.started);
+    watch_add_tree(&watcher, dir, start);
+    if (watcher.directory_count == 0) {
+        out_literal(console, "Erro ao observar o diretorio: ");
+        out_str(console, dir);
+        out_char(console, '\n');
+        close(watcher.fd);
+        free_interner(&interner);
+        return 1;
+    }
+    snprintf(line, sizeof(line), "\033[1;35mObservando %s\033[0m (%d diretorios, %d arquivos .mpas; Ctrl+C encerra)\n",
+             dir, watcher.directory_count, watcher.file_count);
+    out_str(console, line);
+    out_flush(console);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = watch_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    while (!watch_stop) {
+        // Sem nada pendente o poll espera sem prazo: nenhum custo ocioso
+        double now = monotonic_seconds(), next = 0;
+        for (int i = 0; i < watcher.file_count; i++) {
+            double deadline = watcher.files[i].deadline;
+            if (deadline > 0 && (next == 0 || deadline < next)) next = deadline;
+        }
+        int timeout = next == 0 ? -1 : next <= now ? 0 : (int)((next - now) * 1000.0) + 1;
+        struct pollfd descriptor = { watcher.fd, POLLIN, 0 };
+        if (poll(&descriptor, 1, timeout) > 0) watch_read_events(&watcher, monotonic_seconds());
+
+        now = monotonic_seconds();
+        for (int i = 0; i < watcher.file_count && !watch_stop; i++) {
+            WatchedFile* file = &watcher.files[i];
+            if (file->deadline == 0 || file->deadline > now) continue;
+            watch_analyze(&watcher, file, console);
+            // watch_analyze pode ter movido o ultimo arquivo para a posicao i
+            if (i < watcher.file_count && watcher.files[i].deadline != 0 && watcher.files[i].deadline <= now) i--;
+            out_flush(console);
+        }
+    }
+
+    double wall = monotonic_seconds() - start;
+    double idle = wall - watcher.analysis_seconds;
+    double idle_cpu = process_cpu_seconds() - cpu_start - watcher.analysis_cpu_seconds;
+    snprintf(line, sizeof(line),
+             "\n\033[1;35mObservacao encerrada:\033[0m %llu analises (%.3f s), %llu sem mudanca, %llu arquivos regravados\n"
+             "Ocioso: %.3f s de relogio, %.3f ms de CPU (%.4f%%)\n",
+             (unsigned long long)watcher.analyses, watcher.analysis_seconds, (unsigned long long)watcher.unchanged,
+             (unsigned long long)watcher.rewritten, idle, idle_cpu * 1e3, idle > 0 ? idle_cpu / idle * 100.0 : 0.0);
+    out_str(console, line);
+    uint64_t entries = 0;
+    for (int i = 0; i < watcher.file_count; i++) entries += (uint64_t)watcher.files[i].symbols.count;
+    snprintf(line, sizeof(line), "Nomes: %llu distintos (%llu bytes) para %llu simbolos nas tabelas dos arquivos\n",
+             (unsigned long long)atomic_load(&interner.count), (unsigned long long)atomic_load(&interner.bytes),
+             (unsigned long long)entries);
+    out_str(console, line);
+
+    while (watcher.file_count > 0) watch_remove_file(&watcher, &watcher.files[watcher.file_count - 1]);
+    for (int wd = 0; wd < watcher.directory_capacity; wd++) {
+        if (watcher.directories[wd] != NULL) mem_free(MEMORY_SOURCE, watcher.directories[wd], strlen(watcher.directories[wd]) + 1);
+    }
+    mem_free(MEMORY_SOURCE, watcher.directories, (size_t)watcher.directory_capacity * sizeof(char*));
+    mem_free(MEMORY_SOURCE, watcher.files, (size_t)watcher.file_capacity * sizeof(WatchedFile));
+    close(watcher.fd);
+    free_interner(&interner);
+    return 0;
+}
+
+// --simbolos <dir>: so a analise lexica de todos os .mpas de dir, dividida
+// entre --threads N threads que pegam o proximo arquivo de um contador
+// atomico. Os lexers dividem um Interner (com --sem-interner cada tabela
+// guarda os proprios nomes, como na analise normal); cada arquivo mostra a
+// tabela de simbolos de sempre, na ordem dos caminhos
+typedef struct {
+    char** paths;
+    int count;
+    int capacity;
+    _Atomic int next;
+    OutputBuffer* outputs;
+    uint64_t* tokens;
+    uint64_t* symbols;
+    Interner* interner;  // NULL com --sem-interner
+} SymbolsJob;
+
+static void symbols_collect(SymbolsJob* job, const char* dir) {
+    DIR* handle = opendir(dir);
+    if (handle == NULL) return;
+    struct dirent* entry;
+    char path[PATH_MAX];
+    while ((entry = readdir(handle)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        struct stat info;
+        if (stat(path, &info) != 0) continue;
+        if (S_ISDIR(info.st_mode)) {
+            symbols_collect(job, path);
+        } else if (S_ISREG(info.st_mode) && is_mpas_file(entry->d_name)) {
+            job->paths = grow_array(job->paths, job->count, &job->capacity, sizeof(char*));
+            job->paths[job->count] = mem_alloc(MEMORY_SOURCE, strlen(path) + 1);
+            strcpy(job->paths[job->count++], path);
+        }
+    }
+    closedir(handle);
+}
+
+static int compare_paths(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static void* symbols_worker(void* argument) {
+    SymbolsJob* job = argument;
+    for (;;) {
+        int i = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed);
+        if (i >= job->count) break;
+        OutputBuffer* out = &job->outputs[i];
+        out_init(out, OUT_MEMORY);
+        out_literal(out, "\n\033[1;35m");
+        out_str(out, job->paths[i]);
+        out_literal(out, "\033[0m\n");
+
+        int fd = open(job->paths[i], O_RDONLY);
+        if (fd < 0) {
+            out_literal(out, "Erro ao abrir o arquivo\n");
+            continue;
+        }
+        Lexer* lexer = init_lexer(fd, job->paths[i], job->interner);
+        uint64_t tokens = 0;
+        while (get_next_token(lexer).type != TOK_EOF) tokens++;
+        print_symbol_table(out, &lexer->symbol_table);
+        job->tokens[i] = tokens;
+        job->symbols[i] = (uint64_t)lexer->symbol_table.count;
+        free_lexer(lexer);
+    }
+    return NULL;
+}
+
+int symbols_directory(const char* dir, int threads, bool shared, OutputBuffer* console) {
+    SymbolsJob job;
+    char line[256];
+    memset(&job, 0, sizeof(job));
+    symbols_collect(&job, dir);
+    if (job.count == 0) {
+        out_literal(console, "Nenhum arquivo .mpas em ");
+        out_str(console, dir);
+        out_char(console, '\n');
+        mem_free(MEMORY_PARSE, job.paths, (size_t)job.capacity * sizeof(char*));
+        return 1;
+    }
+    qsort(job.paths, (size_t)job.count, sizeof(char*), compare_paths);
+    job.outputs = mem_calloc(MEMORY_OUTPUT, (size_t)job.count, sizeof(OutputBuffer));
+    job.tokens = mem_calloc(MEMORY_TOKENS, (size_t)job.count, sizeof(uint64_t));
+    job.symbols = mem_calloc(MEMORY_SYMBOLS, (size_t)job.count, sizeof(uint64_t));
+    if (threads < 1) threads = 1;
+    if (threads > job.count) threads = job.count;
+
+    Interner interner;
+    if (shared) {
+        init_interner(&interner);
+        job.interner = &interner;
+    }
+    double start = monotonic_seconds();
+    pthread_t* workers = mem_alloc(MEMORY_SOURCE, (size_t)threads * sizeof(pthread_t));
+    for (int i = 1; i < threads; i++) pthread_create(&workers[i], NULL, symbols_worker, &job);
+    symbols_worker(&job);
+    for (int i = 1; i < threads; i++) pthread_join(workers[i], NULL);
+    double seconds = monotonic_seconds() - start;
+    uint64_t symbols_peak = atomic_load(&memory_peak[MEMORY_SYMBOLS]);
+
+    uint64_t tokens = 0, entries = 0;
+    for (int i = 0; i < job.count; i++) {
+        out_write(console, job.outputs[i].data, job.outputs[i].length);
+        out_free(&job.outputs[i]);
+        tokens += job.tokens[i];
+        entries += job.symbols[i];
+    }
+    snprintf(line, sizeof(line), "\n\033[1;35mSimbolos:\033[0m %d arquivos, %llu tokens em %.3f s com %d threads (%.0f tokens/s)\n",
+             job.count, (unsigned long long)tokens, seconds, threads, seconds > 0 ? (double)tokens / seconds : 0.0);
+    out_str(console, line);
+    if (shared) {
+        snprintf(line, sizeof(line), "Interner: %llu nomes distintos (%llu bytes) para %llu simbolos nas tabelas; %llu esperas na trava\n",
+                 (unsigned long long)atomic_load(&interner.count), (unsigned long long)atomic_load(&interner.bytes),
+                 (unsigned long long)entries, (unsigned long long)atomic_load(&interner.lock_waits));
+    } else {
+        snprintf(line, sizeof(line), "Sem interner: %llu simbolos, cada tabela com os proprios nomes\n", (unsigned long long)entries);
+    }
+    out_str(console, line);
+    snprintf(line, sizeof(line), "Memoria de simbolos (pico): %llu bytes\n", (unsigned long long)symbols_peak);
+    out_str(console, line);
+
+    if (shared) free_interner(&interner);
+    for (int i = 0; i < job.count; i++) mem_free(MEMORY_SOURCE, job.paths[i], strlen(job.paths[i]) + 1);
+    mem_free(MEMORY_PARSE, job.paths, (size_t)job.capacity * sizeof(char*));
+    mem_free(MEMORY_SOURCE, workers, (size_t)threads * sizeof(pthread_t));
+    mem_free(MEMORY_OUTPUT, job.outputs, (size_t)job.count * sizeof(OutputBuffer));
+    mem_free(MEMORY_TOKENS, job.tokens, (size_t)job.count * sizeof(uint64_t));
+    mem_free(MEMORY_SYMBOLS, job.symbols, (size_t)job.count * sizeof(uint64_t));
+    return 0;
+}
+
+static const char* const stats_phase_names[STATS_PHASES] = {
+    "lexica", "sintatica", "arquivo_syntax", "fluxo", "escrita", "show_error", "execucao"
+};
+
+// Tabela (ou JSON) no stderr, para nao misturar com a saida do analisador
+void print_stats(double total_seconds) {
+    OutputBuffer out;
+    char line[160];
+    Stats snapshot = stats;
+    // Picos lidos antes do buffer deste relatorio entrar na conta
+    uint64_t memory[MEMORY_SUBSYSTEMS + 1];
+    for (int i = 0; i < MEMORY_SUBSYSTEMS; i++) memory[i] = atomic_load(&memory_peak[i]);
+    memory[MEMORY_SUBSYSTEMS] = atomic_load(&memory_total_peak);
+    out_init(&out, STDERR_FILENO);
+    
+    if (options.stats_json) {
+        out_literal(&out, "{\"fases\": {");
+        for (int i = 0; i < STATS_PHASES; i++) {
+            snprintf(line, sizeof(line), "%s\"%s\": %.6f", i ? ", " : "", stats_phase_names[i], snapshot.phase_seconds[i]);
+            out_str(&out, line);
+        }
+        snprintf(line, sizeof(line), "}, \"total\": %.6f, \"bytes_lidos\": %llu, \"bytes_escritos\": %llu, \"contadores\": ",
+                 total_seconds, (unsigned long long)snapshot.bytes_read, (unsigned long long)snapshot.bytes_written);
+        out_str(&out, line);
+#ifdef MPAS_STATS
+        snprintf(line, sizeof(line), "{\"peek_char\": %llu, \"buscas_simbolos\": %llu, \"sondagens\": %llu, \"colisoes\": %llu, \"tokens\": {",
+                 (unsigned long long)snapshot.peek_calls, (unsigned long long)snapshot.symbol_lookups,
+                 (unsigned long long)snapshot.symbol_probes, (unsigned long long)snapshot.symbol_collisions);
+        out_str(&out, line);
+        bool first = true;
+        for (int type = 0; type <= TOK_ERROR; type++) {
+            if (snapshot.tokens[type] == 0) continue;
+            snprintf(line, sizeof(line), "%s\"%s\": %llu", first ? "" : ", ", token_type_to_string(type),
+                     (unsigned long long)snapshot.tokens[type]);
+            out_str(&out, line);
+            first = false;
+        }
+        out_literal(&out, "}}");
+#else
+        out_literal(&out, "null");
+#endif
+        if (options.ll1) {
+            snprintf(line, sizeof(line), ", \"pilha_ll1_pico\": %llu", (unsigned long long)snapshot.ll1_stack_peak);
+            out_str(&out, line);
+        }
+        out_literal(&out, ", \"memoria_pico\": {");
+        for (int i = 0; i <= MEMORY_SUBSYSTEMS; i++) {
+            snprintf(line, sizeof(line), "%s\"%s\": %llu", i ? ", " : "",
+                     i < MEMORY_SUBSYSTEMS ? memory_subsystem_names[i] : "total", (unsigned long long)memory[i]);
+            out_str(&out, line);
+        }
+        snprintf(line, sizeof(line), "}, \"memoria_limite\": %llu}\n", (unsigned long long)options.max_memory);
+        out_str(&out, line);
+        out_flush(&out);
+        out_free(&out);
+        return;
+    }
+    
+    out_literal(&out, "\n=== ESTATISTICAS ===\n");
+    out_literal(&out, "Fase                 Segundos\n");
+    out_literal(&out, "--------------------------------\n");
+    for (int i = 0; i < STATS_PHASES; i++) {
+        snprintf(line, sizeof(line), "%-20s %.6f\n", stats_phase_names[i], snapshot.phase_seconds[i]);
+        out_str(&out, line);
+    }
+    snprintf(line, sizeof(line), "%-20s %.6f\n", "total", total_seconds);
+    out_str(&out, line);
+    snprintf(line, sizeof(line), "\n%-20s %llu\n%-20s %llu\n", "bytes lidos", (unsigned long long)snapshot.bytes_read,
+             "bytes escritos", (unsigned long long)snapshot.bytes_written);
+    out_str(&out, line);
+    if (options.ll1) {
+        snprintf(line, sizeof(line), "%-20s %llu\n", "pilha ll1 (pico)", (unsigned long long)snapshot.ll1_stack_peak);
+        out_str(&out, line);
+    }
+    // O total e o pico da soma, nao a soma dos picos
+    out_literal(&out, "\nMemoria (pico)       Bytes\n");
+    for (int i = 0; i <= MEMORY_SUBSYSTEMS; i++) {
+        snprintf(line, sizeof(line), "%-20s %llu\n", i < MEMORY_SUBSYSTEMS ? memory_subsystem_names[i] : "total",
+                 (unsigned long long)memory[i]);
+        out_str(&out, line);
+    }
+    if (options.max_memory != 0) {
+        snprintf(line, sizeof(line), "%-20s %llu\n", "limite", (unsigned long long)options.max_memory);
+        out_str(&out, line);
+    }
+#ifdef MPAS_STATS
+    snprintf(line, sizeof(line), "%-20s %llu\n%-20s %llu\n%-20s %llu\n%-20s %llu\n",
+             "peek_char", (unsigned long long)snapshot.peek_calls,
+             "buscas simbolos", (unsigned long long)snapshot.symbol_lookups,
+             "sondagens", (unsigned long long)snapshot.symbol_probes,
+             "colisoes", (unsigned long long)snapshot.symbol_collisions);
+    out_str(&out, line);
+    out_literal(&out, "\nTokens por tipo\n");
+    for (int type = 0; type <= TOK_ERROR; type++) {
+        if (snapshot.tokens[type] == 0) continue;
+        snprintf(line, sizeof(line), "%-20s %llu\n", token_type_to_string(type), (unsigned long long)snapshot.tokens[type]);
+        out_str(&out, line);
+    }
+#else
+    out_literal(&out, "(contadores por token: compile com -DMPAS_STATS)\n");
+#endif
+    out_flush(&out);
+    out_free(&out);
+}
+
+// "-" e tudo que nao for arquivo regular (pipe, FIFO, dispositivo) e fluxo
+static bool is_stream_source(const char* source_filename) {
+    struct stat info;
+    if (strcmp(source_filename, "-") == 0) return true;
+    return stat(source_filename, &info) == 0 && !S_ISREG(info.st_mode);
+}
+
+int main(int argc, char* argv[]) {
+    const char* source_filename = NULL;
+    options.cache_max_bytes = CACHE_DEFAULT_MAX_BYTES;
+    options.max_steps = EXECUTION_DEFAULT_STEPS;
+    options.max_milliseconds = EVALUATION_DEFAULT_MSEC;
+    bool max_steps_given = false;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--pipeline") == 0) {
+            options.pipeline = true;
+        } else if (strcmp(argv[i], "--binario") == 0) {
+            options.binary = true;
+        } else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+            options.dump_filename = argv[++i];
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            options.cache_dir = argv[++i];
+        } else if (strcmp(argv[i], "--cache-max") == 0 && i + 1 < argc) {
+            options.cache_max_bytes = strtoull(argv[++i], NULL, 10) * 1024 * 1024;
+        } else if (strcmp(argv[i], "--cache-stats") == 0) {
+            options.cache_stats = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            options.stats = true;
+        } else if (strcmp(argv[i], "--stats=json") == 0) {
+            options.stats = options.stats_json = true;
+        } else if (strcmp(argv[i], "--sem-rastro") == 0) {
+            options.no_trace = true;
+        } else if (strcmp(argv[i], "--ll1") == 0) {
+            options.ll1 = true;
+        } else if (strcmp(argv[i], "--executar") == 0) {
+            options.execute = true;
+        } else if (strcmp(argv[i], "--perfil") == 0) {
+            options.execute = options.profile = true;
+        } else if (strcmp(argv[i], "--emit-c") == 0) {
+            options.emit_c = true;
+        } else if (strcmp(argv[i], "--compilar") == 0) {
+            options.emit_c = options.compile = true;
+        } else if (strcmp(argv[i], "--max-memory") == 0 && i + 1 < argc) {
+            options.max_memory = (uint64_t)(strtod(argv[++i], NULL) * 1024 * 1024);
+        } else if (strcmp(argv[i], "--max-passos") == 0 && i + 1 < argc) {
+            options.max_steps = strtoull(argv[++i], NULL, 10);
+            max_steps_given = true;
+        } else if (strcmp(argv[i], "--arvore") == 0) {
+            options.tree_snapshot = true;
+        } else if (strcmp(argv[i], "--avaliar") == 0) {
+            options.fold = true;
+        } else if (strcmp(argv[i], "--max-ms") == 0 && i + 1 < argc) {
+            options.max_milliseconds = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--simbolos") == 0 && i + 1 < argc) {
+            options.symbols_dir = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sem-interner") == 0) {
+            options.private_symbols = true;
+        } else if (strcmp(argv[i], "--literais-strtod") == 0) {
+            options.literals_strtod = true;
+        } else if (strcmp(argv[i], "--sem-lacos") == 0) {
+            options.plain_loops = true;
+        } else if (strcmp(argv[i], "--lacos") == 0) {
+            options.loop_report = true;
+        } else if (strcmp(argv[i], "--watch") == 0 && i + 1 < argc) {
+            options.watch_dir = argv[++i];
+        } else if (strcmp(argv[i], "--saida") == 0 && i + 1 < argc) {
+            options.output_base = argv[++i];
+        } else if (source_filename == NULL && strncmp(argv[i], "--", 2) != 0) {
+            source_filename = argv[i];
+        } else {
+            source_filename = NULL;
+            break;
+        }
+    }
+    
+    // Em tempo de compilacao o orcamento padrao e bem menor que o do --executar
+    if (options.fold && !max_steps_given) options.max_steps = EVALUATION_DEFAULT_STEPS;
+    
+    // Depois da analise so um destino roda: traduzir, executar ou avaliar
+    if ((int)options.emit_c + (int)options.execute + (int)options.fold > 1) {
+        printf("--emit-c/--compilar, --executar/--perfil e --avaliar nao combinam entre si\n");
+        return 1;
+    }
+    
+    if (options.dump_filename != NULL) {
+        return dump_binary_file(options.dump_filename);
+    }
+    
+    if (options.cache_stats && options.cache_dir != NULL && source_filename == NULL) {
+        print_cache_stats(options.cache_dir);
+        return 0;
+    }
+    
+    if (options.watch_dir != NULL && source_filename == NULL) {
+        if (options.binary || options.cache_dir != NULL || options.execute || options.emit_c || options.fold ||
+            options.tree_snapshot) {
+            printf("--watch nao combina com --binario, --cache, --executar, --avaliar, --arvore ou --emit-c\n");
+            return 1;
+        }
+        init_token_name_columns();
+        out_init(&console_output, STDOUT_FILENO);
+        int status = watch_directory(options.watch_dir, &console_output);
+        out_flush(&console_output);
+        return status;
+    }
+    
+    if (options.symbols_dir != NULL && source_filename == NULL) {
+        init_token_name_columns();
+        out_init(&console_output, STDOUT_FILENO);
+        int threads = options.threads > 0 ? options.threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        int status = symbols_directory(options.symbols_dir, threads, !options.private_symbols, &console_output);
+        out_flush(&console_output);
+        if (options.stats) print_stats(0.0);
+        return status;
+    }
+    
+    if (source_filename == NULL) {
+        printf("Uso: %s [--pipeline] [--binario] [--cache <dir> [--cache-max <MB>]] <arquivo.mpas>\n", argv[0]);
+        printf("     %s [--pipeline] [--saida <base>] - < <arquivo.mpas>\n", argv[0]);
+        printf("     --stats ou --stats=json: tempos por fase e contadores no stderr\n");
+        printf("     --sem-rastro: so o veredito, sem producoes no terminal nem .syntax\n");
+        printf("     --ll1: parser preditivo por tabela (gramatica.ll1) no lugar da descida recursiva\n");
+        printf("     --executar [--max-passos N]: executa o programa aceito e mostra as variaveis no fim\n");
+        printf("     --avaliar [--max-passos N] [--max-ms N]: avalia o programa em tempo de compilacao (padrao %llu passos, %d ms); grava arquivo.mpas.avaliado\n",
+               EVALUATION_DEFAULT_STEPS, EVALUATION_DEFAULT_MSEC);
+        printf("     --arvore: grava a arvore do programa aceito em arquivo.mpas.arvore (snapshot para mmap, ver arvore.h)\n");
+        printf("     --perfil: executa com contagem por comando/linha e amostragem; grava arquivo.mpas.folded\n");
+        printf("     --max-memory <MB>: limite de memoria do analisador; ao estourar termina com diagnostico (codigo %d)\n", EXIT_MEMORY);
+        printf("     --literais-strtod: converte os literais com strtoll/strtod em vez da conversao do lexer (para comparar)\n");
+        printf("     --lacos: lista os lacos contados (while v < limite com v := v + passo) e como cada um executa\n");
+        printf("     --sem-lacos: executa e traduz todo while volta a volta, sem a analise de lacos contados\n");
+        printf("     --emit-c: traduz o programa aceito para arquivo.mpas.c; --compilar tambem compila (cc, com cache) e roda\n");
+        printf("     %s --watch <dir>: analisa os .mpas de dir e reanalisa os que mudarem (inotify)\n", argv[0]);
+        printf("     %s --simbolos <dir> [--threads N] [--sem-interner]: so a analise lexica dos .mpas de dir, em N threads\n", argv[0]);
+        printf("         com os nomes num interner compartilhado; mostra a tabela de simbolos de cada arquivo\n");
+        printf("     %s --dump <arquivo.mpas.bin>\n", argv[0]);
+        printf("     %s --cache <dir> --cache-stats\n", argv[0]);
+        return 1;
+    }
+    
+    double start = monotonic_seconds();
+    init_token_name_columns();
+    OutputBuffer* console = &console_output;
+    out_init(console, STDOUT_FILENO);
+    
+    int status;
+    if (is_stream_source(source_filename)) {
+        if (options.binary || options.cache_dir != NULL || options.execute || options.emit_c || options.fold ||
+            options.tree_snapshot) {
+            printf("--binario, --cache, --executar, --avaliar, --arvore e --emit-c exigem um arquivo regular como entrada\n");
+            return 1;
+        }
+        status = analyze_stream(source_filename, console);
+    } else {
+        status = options.cache_dir != NULL
+            ? analyze_with_cache(source_filename, console)
+            : analyze_file(source_filename, console, NULL);
+        if (status == 0 && options.tree_snapshot) status = snapshot_program(source_filename, console);
+        if (status == 0 && options.emit_c) status = translate_program(source_filename, console);
+        else if (status == 0 && options.execute) status = execute_program(source_filename, console);
+        else if (status == 0 && options.fold) status = fold_program(source_filename, console);
+    }
+    
+    out_flush(console);
+    if (options.cache_stats && options.cache_dir != NULL) print_cache_stats(options.cache_dir);
+    if (options.stats) print_stats(monotonic_seconds() - start);
+    return status;
+}
@@ -0,0 +1,300 @@
+// Snapshot da arvore do programa aceito (--arvore grava arquivo.mpas.arvore).
+//
+// O arquivo e a propria estrutura em memoria: um cabecalho fixo e vetores de
+// registros de tamanho fixo, ligados por indice (-1: nenhum) e com strings
+// por deslocamento na secao de strings. Nao ha ponteiros, entao outro
+// processo abre com mmap e percorre direto, sem desserializar. Inteiros e
+// doubles ficam na ordem de bytes da maquina que gravou (little-endian nas
+// arquiteturas usuais): byte_order no cabecalho a marca e mpas_tree_open
+// recusa arquivo de outra ordem. Secoes alinhadas em 8 bytes.
+//
+// Estrutura (a mesma de Program()/Block()/Command()/Expression()):
+//   programa: nome e body (o comando_composto principal)
+//   simbolos: as variaveis declaradas, na ordem da declaracao; os comandos e
+//             as expressoes se referem a elas pelo id (indice no vetor)
+//   comandos: atribuicao, begin, if, while, com parent, next (proximo do
+//             mesmo begin), body (corpo, ramo then ou primeiro comando) e
+//             alternative (else); o pai sempre tem id menor que os filhos
+//   expressoes: literal, variavel, negacao e binaria (left/right)
+// Cada simbolo, comando e expressao tem o trecho do fonte (MpasSpan: linha e
+// coluna do primeiro e do ultimo caractere, a partir de 1).
+//
+// Uso:
+//   MpasTree tree;
+//   int status = mpas_tree_open(&tree, "prog.mpas.arvore");
+//   if (status != 0) fprintf(stderr, "%s\n", mpas_tree_error(status));
+//   const MpasTreeStatement* body = mpas_tree_statement(&tree, mpas_tree_body(&tree));
+//   for (int32_t id = body->body; id >= 0; id = mpas_tree_statement(&tree, id)->next) ...
+//   mpas_tree_close(&tree);
+//
+// mpas_tree_open so confere o cabecalho e os limites das secoes (O(1)); os
+// acessores devolvem NULL para id fora do vetor. Quem le arquivos de fora
+// pode chamar mpas_tree_validate, que confere todos os ids (O(n)).
+#ifndef ARVORE_H
+#define ARVORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MPAS_TREE_MAGIC "MPASARV"
+#define MPAS_TREE_VERSION 1
+#define MPAS_TREE_BYTE_ORDER 0x01020304u
+
+// A marca de ordem so confere inteiros: double tem que vir na mesma ordem
+_Static_assert(__FLOAT_WORD_ORDER__ == __BYTE_ORDER__, "double em ordem de bytes diferente dos inteiros");
+
+typedef enum {
+    MPAS_EXPR_INTEGER, MPAS_EXPR_REAL, MPAS_EXPR_VARIABLE, MPAS_EXPR_NEGATE, MPAS_EXPR_BINARY
+} MpasTreeExpressionKind;
+
+typedef enum {
+    MPAS_STMT_ASSIGNMENT, MPAS_STMT_COMPOUND, MPAS_STMT_CONDITIONAL, MPAS_STMT_REPETITIVE
+} MpasTreeStatementKind;
+
+typedef enum {
+    MPAS_OP_ADD, MPAS_OP_SUB, MPAS_OP_MUL, MPAS_OP_DIV, MPAS_OP_MOD,
+    MPAS_OP_EQ, MPAS_OP_NE, MPAS_OP_LT, MPAS_OP_LE, MPAS_OP_GT, MPAS_OP_GE,
+    MPAS_OP_NONE
+} MpasTreeOperator;
+
+typedef struct {
+    int64_t line;
+    int64_t column;
+    int64_t end_line;
+    int64_t end_column;
+} MpasSpan;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t file_size;
+    // Fonte de onde a arvore saiu: tamanho e mtime (ns) para saber se ela
+    // ainda vale (mpas_tree_is_current)
+    uint64_t source_size;
+    int64_t source_mtime_ns;
+    uint32_t name;
+    int32_t body;
+    uint32_t symbol_count;
+    uint32_t expression_count;
+    uint32_t statement_count;
+    uint32_t byte_order;  // MPAS_TREE_BYTE_ORDER como a maquina que gravou o escreve
+    uint64_t symbol_offset;
+    uint64_t expression_offset;
+    uint64_t statement_offset;
+    uint64_t string_offset;
+    uint64_t string_size;
+} MpasTreeHeader;
+
+typedef struct {
+    uint32_t name;
+    uint8_t real;
+    uint8_t reserved[3];
+    MpasSpan span;
+} MpasTreeSymbol;
+
+typedef struct {
+    uint8_t kind;
+    uint8_t op;
+    uint16_t reserved;
+    int32_t left;
+    int32_t right;
+    int32_t symbol;
+    union {
+        int64_t integer;
+        double real;
+    } value;
+    MpasSpan span;
+} MpasTreeExpression;
+
+typedef struct {
+    uint8_t kind;
+    uint8_t reserved[3];
+    int32_t parent;
+    int32_t next;
+    int32_t symbol;
+    int32_t expression;
+    int32_t body;
+    int32_t alternative;
+    uint32_t reserved2;
+    MpasSpan span;
+} MpasTreeStatement;
+
+_Static_assert(sizeof(MpasTreeHeader) == 104, "layout do cabecalho mudou");
+_Static_assert(sizeof(MpasTreeSymbol) == 40, "layout do simbolo mudou");
+_Static_assert(sizeof(MpasTreeExpression) == 56, "layout da expressao mudou");
+_Static_assert(sizeof(MpasTreeStatement) == 64, "layout do comando mudou");
+
+typedef struct {
+    const uint8_t* base;
+    size_t size;
+    const MpasTreeHeader* header;
+    const MpasTreeSymbol* symbols;
+    const MpasTreeExpression* expressions;
+    const MpasTreeStatement* statements;
+    const char* strings;
+} MpasTree;
+
+#define MPAS_TREE_ERROR_OPEN (-1)
+#define MPAS_TREE_ERROR_FORMAT (-2)
+#define MPAS_TREE_ERROR_VERSION (-3)
+#define MPAS_TREE_ERROR_BYTE_ORDER (-4)
+
+static inline const char* mpas_tree_error(int status) {
+    switch (status) {
+        case 0: return "ok";
+        case MPAS_TREE_ERROR_OPEN: return "nao foi possivel abrir/mapear o arquivo";
+        case MPAS_TREE_ERROR_FORMAT: return "arquivo nao e um snapshot de arvore valido";
+        case MPAS_TREE_ERROR_VERSION: return "versao do snapshot nao suportada";
+        case MPAS_TREE_ERROR_BYTE_ORDER: return "snapshot gravado em outra ordem de bytes";
+    }
+    return "erro desconhecido";
+}
+
+// A secao [offset, offset + count * size) cabe no arquivo e esta alinhada
+static inline bool mpas_tree_section_ok(uint64_t file_size, uint64_t offset, uint64_t count, uint64_t size) {
+    return offset % 8 == 0 && offset <= file_size && count <= (file_size - offset) / size;
+}
+
+static inline int mpas_tree_open(MpasTree* tree, const char* filename) {
+    struct stat info;
+    memset(tree, 0, sizeof(*tree));
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return MPAS_TREE_ERROR_OPEN;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return MPAS_TREE_ERROR_OPEN;
+    }
+    if ((size_t)info.st_size < sizeof(MpasTreeHeader)) {
+        close(fd);
+        return MPAS_TREE_ERROR_FORMAT;
+    }
+    void* base = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return MPAS_TREE_ERROR_OPEN;
+
+    tree->base = base;
+    tree->size = (size_t)info.st_size;
+    const MpasTreeHeader* header = base;
+    int status = 0;
+    if (memcmp(header->magic, MPAS_TREE_MAGIC, sizeof(header->magic)) != 0) {
+        status = MPAS_TREE_ERROR_FORMAT;
+    } else if (header->byte_order != MPAS_TREE_BYTE_ORDER) {
+        status = MPAS_TREE_ERROR_BYTE_ORDER;
+    } else if (header->version != MPAS_TREE_VERSION || header->header_size != sizeof(MpasTreeHeader)) {
+        status = MPAS_TREE_ERROR_VERSION;
+    } else if (header->file_size != tree->size ||
+               !mpas_tree_section_ok(tree->size, header->symbol_offset, header->symbol_count, sizeof(MpasTreeSymbol)) ||
+               !mpas_tree_section_ok(tree->size, header->expression_offset, header->expression_count, sizeof(MpasTreeExpression)) ||
+               !mpas_tree_section_ok(tree->size, header->statement_offset, header->statement_count, sizeof(MpasTreeStatement)) ||
+               !mpas_tree_section_ok(tree->size, header->string_offset, header->string_size, 1) ||
+               header->string_size == 0 || tree->base[header->string_offset + header->string_size - 1] != '\0' ||
+               header->name >= header->string_size ||
+               header->body < 0 || (uint32_t)header->body >= header->statement_count) {
+        status = MPAS_TREE_ERROR_FORMAT;
+    }
+    if (status != 0) {
+        munmap(base, tree->size);
+        memset(tree, 0, sizeof(*tree));
+        return status;
+    }
+
+    tree->header = header;
+    tree->symbols = (const MpasTreeSymbol*)(tree->base + header->symbol_offset);
+    tree->expressions = (const MpasTreeExpression*)(tree->base + header->expression_offset);
+    tree->statements = (const MpasTreeStatement*)(tree->base + header->statement_offset);
+    tree->strings = (const char*)(tree->base + header->string_offset);
+    return 0;
+}
+
+static inline void mpas_tree_close(MpasTree* tree) {
+    if (tree->base != NULL) munmap((void*)tree->base, tree->size);
+    memset(tree, 0, sizeof(*tree));
+}
+
+static inline const char* mpas_tree_string(const MpasTree* tree, uint32_t offset) {
+    return offset < tree->header->string_size ? tree->strings + offset : "";
+}
+
+static inline const char* mpas_tree_program_name(const MpasTree* tree) {
+    return mpas_tree_string(tree, tree->header->name);
+}
+
+static inline int32_t mpas_tree_body(const MpasTree* tree) {
+    return tree->header->body;
+}
+
+static inline const MpasTreeSymbol* mpas_tree_symbol(const MpasTree* tree, int32_t id) {
+    return id >= 0 && (uint32_t)id < tree->header->symbol_count ? &tree->symbols[id] : NULL;
+}
+
+static inline const MpasTreeExpression* mpas_tree_expression(const MpasTree* tree, int32_t id) {
+    return id >= 0 && (uint32_t)id < tree->header->expression_count ? &tree->expressions[id] : NULL;
+}
+
+static inline const MpasTreeStatement* mpas_tree_statement(const MpasTree* tree, int32_t id) {
+    return id >= 0 && (uint32_t)id < tree->header->statement_count ? &tree->statements[id] : NULL;
+}
+
+static inline const char* mpas_tree_operator_text(uint8_t op) {
+    static const char* const texts[] = { "+", "-", "*", "/", "mod", "=", "<>", "<", "<=", ">", ">=" };
+    return op < MPAS_OP_NONE ? texts[op] : "";
+}
+
+// O fonte ainda tem o tamanho e o mtime de quando a arvore foi gravada
+static inline bool mpas_tree_is_current(const MpasTree* tree, const char* source_filename) {
+    struct stat info;
+    if (stat(source_filename, &info) != 0) return false;
+    return (uint64_t)info.st_size == tree->header->source_size &&
+           (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec == tree->header->source_mtime_ns;
+}
+
+// Confere tipos, ids e strings de todos os registros (para arquivos que nao
+// vieram do proprio analisador)
+static inline bool mpas_tree_validate(const MpasTree* tree) {
+    const MpasTreeHeader* header = tree->header;
+    int64_t symbols = header->symbol_count, expressions = header->expression_count, statements = header->statement_count;
+
+    for (int64_t i = 0; i < symbols; i++) {
+        if (tree->symbols[i].name >= header->string_size) return false;
+    }
+    for (int64_t i = 0; i < expressions; i++) {
+        const MpasTreeExpression* node = &tree->expressions[i];
+        switch (node->kind) {
+            case MPAS_EXPR_INTEGER:
+            case MPAS_EXPR_REAL:
+                break;
+            case MPAS_EXPR_VARIABLE:
+                if (node->symbol < 0 || node->symbol >= symbols) return false;
+                break;
+            case MPAS_EXPR_NEGATE:
+                if (node->left < 0 || node->left >= i) return false;
+                break;
+            case MPAS_EXPR_BINARY:
+                if (node->op >= MPAS_OP_NONE || node->left < 0 || node->left >= i || node->right < 0 || node->right >= i) return false;
+                break;
+            default:
+                return false;
+        }
+    }
+    for (int64_t i = 0; i < statements; i++) {
+        const MpasTreeStatement* node = &tree->statements[i];
+        if (node->kind > MPAS_STMT_REPETITIVE || node->parent >= i || node->parent < -1) return false;
+        if (node->next < -1 || node->next >= statements || (node->next >= 0 && node->next <= i)) return false;
+        if (node->body < -1 || node->body >= statements || (node->body >= 0 && node->body <= i)) return false;
+        if (node->alternative < -1 || node->alternative >= statements || (node->alternative >= 0 && node->alternative <= i)) return false;
+        if (node->expression < -1 || node->expression >= expressions) return false;
+        if (node->kind == MPAS_STMT_ASSIGNMENT && (node->symbol < 0 || node->symbol >= symbols)) return false;
+        if (node->kind != MPAS_STMT_COMPOUND && node->expression < 0) return false;
+    }
+    return true;
+}
+
+#endif
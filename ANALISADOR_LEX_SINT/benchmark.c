@@ -0,0 +1,563 @@
+// Benchmark do analisador: gera um programa com ./gerador (ou usa --entrada),
+// roda cada fase algumas vezes e grava o melhor tempo e o pico de memoria
+// de cada uma em JSON. Com --comparar mostra a diferenca para uma execucao
+// anterior. Com --execucao gera um programa executavel e compara o
+// interpretador (--executar) com a traducao para C (--compilar), com o
+// cache de binarios vazio e cheio. Com --arvore compara reanalisar o fonte
+// com abrir o snapshot da arvore (--arvore do analisador) no leitor_arvore.
+// Com --interner gera varios arquivos e mede a analise lexica de todos
+// (--simbolos) com tabelas privadas e com o interner compartilhado, de 1
+// thread ate --threads. Com --literais gera um programa cheio de literais
+// (gerador --numerico) e compara a conversao feita pelo lexer com
+// strtoll/strtod (--literais-strtod). Com --lacos gera um programa quase so
+// de lacos contados (gerador --lacos) e mede o interpretador e o nativo com
+// e sem a analise de lacos contados (--sem-lacos).
+//
+//   gcc benchmark.c -o benchmark
+//   ./benchmark --tamanho 20 --saida atual.json --comparar anterior.json
+//   ./benchmark --execucao --tamanho 0.05 --iteracoes 200
+//   ./benchmark --identificadores 200000 --max-memory 8
+//   ./benchmark --arvore --tamanho 20 --leitor ./leitor_arvore
+//   ./benchmark --interner --arquivos 32 --tamanho 1 --threads 8
+//   ./benchmark --literais --tamanho 20
+//   ./benchmark --lacos --tamanho 0.05 --iteracoes 20000
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#define MAX_ARGS 16
+#define MAX_PHASES 16
+#define REGRESSION_LIMIT 0.10
+// Codigo de saida do analisador quando --max-memory estoura
+#define EXIT_MEMORY 3
+
+typedef struct {
+    const char* name;
+    const char* args[MAX_ARGS];
+    const char* stdin_filename;
+    const char* clear_dir;  // esvaziado antes de cada execucao (cache frio)
+} Phase;
+
+typedef struct {
+    const char* name;
+    double seconds;
+    long peak_rss_kb;
+    int exit_code;
+} PhaseResult;
+
+typedef struct {
+    const char* analyzer;
+    const char* generator;
+    const char* reader;
+    const char* input;
+    const char* output;
+    const char* compare;
+    const char* work_dir;
+    const char* seed;
+    const char* size;
+    const char* iterations;
+    const char* identifiers;
+    const char* max_memory;
+    bool execution;
+    bool tree;
+    bool interner;
+    bool literals;
+    bool loops;
+    int files;
+    int threads;
+    int repetitions;
+} BenchOptions;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Roda o comando com a saida padrao descartada; devolve o codigo de saida
+// e o pico de memoria do processo filho
+static int run_command(const char* const* args, const char* stdin_filename, const char* stderr_filename,
+                       double* seconds, long* peak_rss_kb) {
+    double start = now_seconds();
+    pid_t pid = fork();
+
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        int out = open("/dev/null", O_WRONLY);
+        if (out >= 0) dup2(out, STDOUT_FILENO);
+        if (stderr_filename != NULL) {
+            int err = open(stderr_filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+            if (err >= 0) dup2(err, STDERR_FILENO);
+        }
+        if (stdin_filename != NULL) {
+            int in = open(stdin_filename, O_RDONLY);
+            if (in < 0) _exit(127);
+            dup2(in, STDIN_FILENO);
+        }
+        execv(args[0], (char* const*)args);
+        _exit(127);
+    }
+
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0) return -1;
+    *seconds = now_seconds() - start;
+    *peak_rss_kb = usage.ru_maxrss;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+static uint64_t file_size(const char* filename) {
+    struct stat info;
+    return stat(filename, &info) == 0 ? (uint64_t)info.st_size : 0;
+}
+
+// Conta as linhas do arquivo que contem marker (todas, se marker == NULL)
+static uint64_t count_lines(const char* filename, const char* marker) {
+    FILE* file = fopen(filename, "r");
+    char line[4096];
+    uint64_t count = 0;
+
+    if (!file) return 0;
+    while (fgets(line, sizeof(line), file)) {
+        if (marker == NULL || strstr(line, marker) != NULL) count++;
+    }
+    fclose(file);
+    return count;
+}
+
+// Apaga os arquivos (nao os subdiretorios) de dir
+static void clear_directory(const char* dir) {
+    DIR* handle = opendir(dir);
+    struct dirent* entry;
+    char path[4400];
+
+    if (handle == NULL) return;
+    while ((entry = readdir(handle)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        unlink(path);
+    }
+    closedir(handle);
+}
+
+static int run_phase(const BenchOptions* options, const Phase* phase, PhaseResult* result) {
+    result->name = phase->name;
+    result->seconds = 0;
+    result->peak_rss_kb = 0;
+
+    for (int i = 0; i < options->repetitions; i++) {
+        double seconds;
+        long rss;
+        if (phase->clear_dir != NULL) clear_directory(phase->clear_dir);
+        result->exit_code = run_command(phase->args, phase->stdin_filename, NULL, &seconds, &rss);
+        if (result->exit_code < 0 || result->exit_code == 127) return 1;
+        if (i == 0 || seconds < result->seconds) result->seconds = seconds;
+        if (rss > result->peak_rss_kb) result->peak_rss_kb = rss;
+    }
+    return 0;
+}
+
+static void write_json(FILE* out, const BenchOptions* options, uint64_t bytes, uint64_t tokens,
+                       uint64_t productions, const char* internal_stats, const PhaseResult* results, int count) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"entrada\": \"%s\",\n", options->input);
+    fprintf(out, "  \"bytes\": %llu,\n", (unsigned long long)bytes);
+    fprintf(out, "  \"tokens\": %llu,\n", (unsigned long long)tokens);
+    fprintf(out, "  \"producoes\": %llu,\n", (unsigned long long)productions);
+    fprintf(out, "  \"repeticoes\": %d,\n", options->repetitions);
+    fprintf(out, "  \"stats_texto\": %s,\n", internal_stats[0] != '\0' ? internal_stats : "null");
+    fprintf(out, "  \"fases\": [\n");
+    for (int i = 0; i < count; i++) {
+        const PhaseResult* r = &results[i];
+        double seconds = r->seconds > 0 ? r->seconds : 1e-9;
+        // Uma fase por linha: --comparar le o arquivo linha a linha
+        fprintf(out, "    {\"fase\": \"%s\", \"segundos\": %.6f, \"tokens_por_s\": %.0f, \"mb_por_s\": %.2f, "
+                     "\"producoes_por_s\": %.0f, \"rss_pico_kb\": %ld, \"codigo\": %d}%s\n",
+                r->name, r->seconds, (double)tokens / seconds, (double)bytes / seconds / (1024.0 * 1024.0),
+                (double)productions / seconds, r->peak_rss_kb, r->exit_code, i + 1 < count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+static void print_table(uint64_t bytes, uint64_t tokens, uint64_t productions, const PhaseResult* results, int count) {
+    printf("Entrada: %llu bytes, %llu tokens, %llu producoes\n",
+           (unsigned long long)bytes, (unsigned long long)tokens, (unsigned long long)productions);
+    printf("%-13s %10s %14s %10s %14s %12s\n", "FASE", "SEGUNDOS", "TOKENS/S", "MB/S", "PRODUCOES/S", "RSS PICO KB");
+    for (int i = 0; i < count; i++) {
+        const PhaseResult* r = &results[i];
+        double seconds = r->seconds > 0 ? r->seconds : 1e-9;
+        printf("%-13s %10.3f %14.0f %10.2f %14.0f %12ld\n", r->name, r->seconds,
+               (double)tokens / seconds, (double)bytes / seconds / (1024.0 * 1024.0),
+               (double)productions / seconds, r->peak_rss_kb);
+    }
+}
+
+// Compara com um JSON gravado por este programa; devolve 1 se alguma fase
+// ficou mais de REGRESSION_LIMIT mais lenta
+static int compare_results(const char* filename, const PhaseResult* results, int count) {
+    FILE* file = fopen(filename, "r");
+    char line[1024];
+    int regressions = 0;
+
+    if (!file) {
+        fprintf(stderr, "Erro ao abrir %s\n", filename);
+        return 1;
+    }
+
+    printf("\nComparacao com %s\n", filename);
+    printf("%-13s %12s %12s %10s\n", "FASE", "ANTERIOR", "ATUAL", "VARIACAO");
+    while (fgets(line, sizeof(line), file)) {
+        char name[64];
+        double seconds;
+        long rss;
+        if (sscanf(line, " {\"fase\": \"%63[^\"]\", \"segundos\": %lf", name, &seconds) != 2) continue;
+        char* rss_field = strstr(line, "\"rss_pico_kb\": ");
+        rss = rss_field != NULL ? atol(rss_field + 15) : 0;
+
+        for (int i = 0; i < count; i++) {
+            if (strcmp(results[i].name, name) != 0) continue;
+            double change = seconds > 0 ? (results[i].seconds - seconds) / seconds : 0;
+            bool regression = change > REGRESSION_LIMIT;
+            printf("%-13s %11.3fs %11.3fs %+9.1f%%%s", name, seconds, results[i].seconds, change * 100,
+                   regression ? "  REGRESSAO" : "");
+            if (rss > 0 && results[i].peak_rss_kb > rss + rss / 10) printf("  (memoria %ld -> %ld KB)", rss, results[i].peak_rss_kb);
+            printf("\n");
+            regressions += regression;
+        }
+    }
+    fclose(file);
+    return regressions > 0;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Uso: %s [opcoes]\n", program);
+    fprintf(stderr, "  --analisador PATH   binario do analisador (padrao ./analisadorlexsint)\n");
+    fprintf(stderr, "  --gerador PATH      binario do gerador (padrao ./gerador)\n");
+    fprintf(stderr, "  --entrada ARQ       usa este programa em vez de gerar um\n");
+    fprintf(stderr, "  --semente N         semente do gerador (padrao 1)\n");
+    fprintf(stderr, "  --tamanho MB        tamanho do programa gerado (padrao 10)\n");
+    fprintf(stderr, "  --repeticoes N      execucoes por fase; vale o melhor tempo (padrao 3)\n");
+    fprintf(stderr, "  --dir DIR           diretorio para a entrada e as saidas (padrao /tmp)\n");
+    fprintf(stderr, "  --saida ARQ.json    grava os resultados\n");
+    fprintf(stderr, "  --comparar ARQ.json compara com uma execucao anterior\n");
+    fprintf(stderr, "  --execucao          mede --executar e --compilar num programa executavel\n");
+    fprintf(stderr, "  --iteracoes N       iteracoes maximas de cada laco com --execucao e --lacos (padrao 100)\n");
+    fprintf(stderr, "  --identificadores N variaveis declaradas no programa gerado (padrao do gerador)\n");
+    fprintf(stderr, "  --max-memory MB     roda cada fase com este limite; mostra as que estouraram\n");
+    fprintf(stderr, "  --arvore            compara a reanalise com a leitura do snapshot da arvore\n");
+    fprintf(stderr, "  --leitor PATH       leitor do snapshot com --arvore (padrao ./leitor_arvore)\n");
+    fprintf(stderr, "  --interner          mede --simbolos com e sem o interner compartilhado\n");
+    fprintf(stderr, "  --literais          programa com muitos literais: conversao do lexer contra strtoll/strtod\n");
+    fprintf(stderr, "  --lacos             programa de lacos contados: execucao com e sem a analise de lacos\n");
+    fprintf(stderr, "  --arquivos N        arquivos gerados com --interner, de --tamanho MB cada (padrao 16)\n");
+    fprintf(stderr, "  --threads N         maximo de threads com --interner (padrao: processadores)\n");
+}
+
+// --interner: F arquivos com sementes seguidas em <dir>/bench-interner e,
+// para 1, 2, 4... --threads threads, --simbolos com tabelas privadas
+// (--sem-interner) e com o interner. O ganho e sempre sobre 1 thread do
+// mesmo modo
+static int benchmark_interner(BenchOptions* options) {
+    char dir[4200], path[4400], seed[32];
+    double seconds;
+    long rss;
+    uint64_t bytes = 0;
+
+    snprintf(dir, sizeof(dir), "%s/bench-interner", options->work_dir);
+    mkdir(dir, 0777);
+    clear_directory(dir);
+    for (int i = 0; i < options->files; i++) {
+        snprintf(seed, sizeof(seed), "%llu", strtoull(options->seed, NULL, 10) + (unsigned long long)i);
+        snprintf(path, sizeof(path), "%s/p%03d.mpas", dir, i);
+        const char* args[MAX_ARGS] = { options->generator, "--semente", seed, "--tamanho", options->size };
+        int count = 5;
+        if (options->identifiers != NULL) {
+            args[count++] = "--identificadores";
+            args[count++] = options->identifiers;
+        }
+        args[count] = path;
+        if (run_command(args, NULL, NULL, &seconds, &rss) != 0) {
+            fprintf(stderr, "Erro ao gerar a entrada com %s\n", options->generator);
+            return 1;
+        }
+        bytes += file_size(path);
+    }
+
+    Phase phases[MAX_PHASES];
+    PhaseResult results[MAX_PHASES];
+    char names[MAX_PHASES][32], counts[MAX_PHASES][16];
+    int threads[MAX_PHASES], phase_count = 0;
+    for (int n = 1; phase_count + 2 <= MAX_PHASES; n *= 2) {
+        if (n > options->threads) n = options->threads;
+        for (int shared = 0; shared <= 1; shared++) {
+            int i = phase_count++;
+            snprintf(names[i], sizeof(names[i]), "%s_%d", shared ? "interner" : "privado", n);
+            snprintf(counts[i], sizeof(counts[i]), "%d", n);
+            threads[i] = n;
+            phases[i] = (Phase){ names[i], { options->analyzer, "--simbolos", dir, "--threads", counts[i],
+                                             shared ? NULL : "--sem-interner", NULL }, NULL, NULL };
+        }
+        if (n == options->threads) break;
+    }
+
+    for (int i = 0; i < phase_count; i++) {
+        if (run_phase(options, &phases[i], &results[i]) != 0 || results[i].exit_code != 0) {
+            fprintf(stderr, "Erro ao executar a fase %s com %s\n", phases[i].name, options->analyzer);
+            return 1;
+        }
+    }
+
+    printf("Entrada: %d arquivos, %llu bytes\n", options->files, (unsigned long long)bytes);
+    printf("%-13s %8s %10s %10s %8s %12s\n", "FASE", "THREADS", "SEGUNDOS", "MB/S", "GANHO", "RSS PICO KB");
+    for (int i = 0; i < phase_count; i++) {
+        const PhaseResult* r = &results[i];
+        double base = results[i % 2].seconds;
+        double seconds = r->seconds > 0 ? r->seconds : 1e-9;
+        printf("%-13s %8d %10.3f %10.2f %7.2fx %12ld\n", r->name, threads[i], r->seconds,
+               (double)bytes / seconds / (1024.0 * 1024.0), base / seconds, r->peak_rss_kb);
+    }
+
+    if (options->output != NULL) {
+        FILE* out = fopen(options->output, "w");
+        if (!out) {
+            fprintf(stderr, "Erro ao criar %s\n", options->output);
+            return 1;
+        }
+        options->input = dir;
+        write_json(out, options, bytes, 0, 0, "", results, phase_count);
+        fclose(out);
+        printf("Resultados salvos em: %s\n", options->output);
+    }
+    return options->compare != NULL ? compare_results(options->compare, results, phase_count) : 0;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options = { "./analisadorlexsint", "./gerador", "./leitor_arvore", NULL, NULL, NULL, "/tmp", "1", "10", "100",
+                             NULL, NULL, false, false, false, false, false, 16, 0, 3 };
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--analisador") == 0 && has_value) options.analyzer = argv[++i];
+        else if (strcmp(argv[i], "--gerador") == 0 && has_value) options.generator = argv[++i];
+        else if (strcmp(argv[i], "--entrada") == 0 && has_value) options.input = argv[++i];
+        else if (strcmp(argv[i], "--semente") == 0 && has_value) options.seed = argv[++i];
+        else if (strcmp(argv[i], "--tamanho") == 0 && has_value) options.size = argv[++i];
+        else if (strcmp(argv[i], "--repeticoes") == 0 && has_value) options.repetitions = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--dir") == 0 && has_value) options.work_dir = argv[++i];
+        else if (strcmp(argv[i], "--saida") == 0 && has_value) options.output = argv[++i];
+        else if (strcmp(argv[i], "--comparar") == 0 && has_value) options.compare = argv[++i];
+        else if (strcmp(argv[i], "--execucao") == 0) options.execution = true;
+        else if (strcmp(argv[i], "--iteracoes") == 0 && has_value) options.iterations = argv[++i];
+        else if (strcmp(argv[i], "--identificadores") == 0 && has_value) options.identifiers = argv[++i];
+        else if (strcmp(argv[i], "--max-memory") == 0 && has_value) options.max_memory = argv[++i];
+        else if (strcmp(argv[i], "--arvore") == 0) options.tree = true;
+        else if (strcmp(argv[i], "--leitor") == 0 && has_value) options.reader = argv[++i];
+        else if (strcmp(argv[i], "--interner") == 0) options.interner = true;
+        else if (strcmp(argv[i], "--literais") == 0) options.literals = true;
+        else if (strcmp(argv[i], "--lacos") == 0) options.loops = true;
+        else if (strcmp(argv[i], "--arquivos") == 0 && has_value) options.files = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && has_value) options.threads = atoi(argv[++i]);
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.repetitions < 1) options.repetitions = 1;
+    if (options.interner) {
+        if (options.files < 1) options.files = 1;
+        if (options.threads < 1) options.threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (options.threads < 1) options.threads = 1;
+        return benchmark_interner(&options);
+    }
+
+    char input[4300], binary[4400], stream_base[4200], lex[4400], syntax[4400], cache[4200], native_cache[4300];
+    char snapshot[4400], literals_dir[4200];
+    double seconds;
+    long rss;
+
+    // --literais: a entrada fica sozinha num diretorio, para --simbolos
+    snprintf(literals_dir, sizeof(literals_dir), "%s/bench-literais", options.work_dir);
+    if (options.literals && options.input == NULL) {
+        mkdir(literals_dir, 0777);
+        clear_directory(literals_dir);
+    }
+
+    if (options.input == NULL) {
+        snprintf(input, sizeof(input), "%s/bench-%s%s.mpas", options.literals ? literals_dir : options.work_dir,
+                 options.execution ? "exec-" : options.loops ? "lacos-" : "", options.seed);
+        const char* args[MAX_ARGS] = { options.generator, "--semente", options.seed, "--tamanho", options.size };
+        int count = 5;
+        if (options.literals) args[count++] = "--numerico";
+        if (options.execution || options.loops) {
+            args[count++] = options.loops ? "--lacos" : "--executavel";
+            args[count++] = "--iteracoes";
+            args[count++] = options.iterations;
+        }
+        if (options.identifiers != NULL) {
+            args[count++] = "--identificadores";
+            args[count++] = options.identifiers;
+        }
+        args[count] = input;
+        if (run_command(args, NULL, NULL, &seconds, &rss) != 0) {
+            fprintf(stderr, "Erro ao gerar a entrada com %s\n", options.generator);
+            return 1;
+        }
+        options.input = input;
+    }
+
+    snprintf(binary, sizeof(binary), "%s.bin", options.input);
+    snprintf(stream_base, sizeof(stream_base), "%s/bench-fluxo", options.work_dir);
+    snprintf(lex, sizeof(lex), "%s.lex", options.input);
+    snprintf(syntax, sizeof(syntax), "%s.syntax", options.input);
+    snprintf(snapshot, sizeof(snapshot), "%s.arvore", options.input);
+
+    // Binarios de --compilar num cache proprio, em <dir>/bench-cache/mpas
+    snprintf(cache, sizeof(cache), "%s/bench-cache", options.work_dir);
+    snprintf(native_cache, sizeof(native_cache), "%s/mpas", cache);
+    setenv("XDG_CACHE_HOME", cache, 1);
+
+    Phase phases[MAX_PHASES] = {
+        { "texto",   { options.analyzer, options.input, NULL }, NULL, NULL },
+        { "binario", { options.analyzer, "--binario", options.input, NULL }, NULL, NULL },
+        { "dump",    { options.analyzer, "--dump", binary, NULL }, NULL, NULL },
+        { "fluxo",   { options.analyzer, "--saida", stream_base, "-", NULL }, options.input, NULL },
+    };
+    int phase_count = 4;
+    PhaseResult results[MAX_PHASES];
+
+    if (options.execution) {
+        // O tempo do nativo frio inclui o cc; o quente, so traducao e execucao
+        Phase execution_phases[] = {
+            { "texto",         { options.analyzer, options.input, NULL }, NULL, NULL },
+            { "interpretador", { options.analyzer, "--sem-rastro", "--executar", "--max-passos", "0", options.input, NULL },
+              NULL, NULL },
+            { "nativo_frio",   { options.analyzer, "--sem-rastro", "--compilar", "--max-passos", "0", options.input, NULL },
+              NULL, native_cache },
+            { "nativo",        { options.analyzer, "--sem-rastro", "--compilar", "--max-passos", "0", options.input, NULL },
+              NULL, NULL },
+        };
+        phase_count = sizeof(execution_phases) / sizeof(execution_phases[0]);
+        memcpy(phases, execution_phases, sizeof(execution_phases));
+    } else if (options.loops) {
+        // interp_sem e nativo_sem: --sem-lacos, todo while volta a volta.
+        // Com o limite padrao de passos, como o programa rodaria normalmente:
+        // sem limite o cc ja tira a contagem de passos dos lacos. O cc so
+        // roda na primeira repeticao de cada nativo (com e sem a analise o
+        // C muda, entao sao duas chaves no cache)
+        Phase loop_phases[] = {
+            { "texto",         { options.analyzer, options.input, NULL }, NULL, NULL },
+            { "interp_sem",    { options.analyzer, "--sem-rastro", "--sem-lacos", "--executar", options.input, NULL }, NULL, NULL },
+            { "interpretador", { options.analyzer, "--sem-rastro", "--executar", options.input, NULL }, NULL, NULL },
+            { "nativo_sem",    { options.analyzer, "--sem-rastro", "--sem-lacos", "--compilar", options.input, NULL }, NULL, NULL },
+            { "nativo",        { options.analyzer, "--sem-rastro", "--compilar", options.input, NULL }, NULL, NULL },
+        };
+        phase_count = sizeof(loop_phases) / sizeof(loop_phases[0]);
+        memcpy(phases, loop_phases, sizeof(loop_phases));
+    } else if (options.tree) {
+        // reanalise e o que cada ferramenta faria sem o snapshot; arvore e o
+        // custo de gera-lo uma vez; leitura abre, valida e percorre tudo
+        Phase tree_phases[] = {
+            { "texto",     { options.analyzer, options.input, NULL }, NULL, NULL },
+            { "reanalise", { options.analyzer, "--sem-rastro", options.input, NULL }, NULL, NULL },
+            { "arvore",    { options.analyzer, "--sem-rastro", "--arvore", options.input, NULL }, NULL, NULL },
+            { "leitura",   { options.reader, "--validar", snapshot, NULL }, NULL, NULL },
+        };
+        phase_count = sizeof(tree_phases) / sizeof(tree_phases[0]);
+        memcpy(phases, tree_phases, sizeof(tree_phases));
+    } else if (options.literals) {
+        // lexer e lexer_strtod so fazem a analise lexica (--simbolos com 1
+        // thread); texto e texto_strtod, a analise inteira
+        Phase literal_phases[] = {
+            { "texto",        { options.analyzer, options.input, NULL }, NULL, NULL },
+            { "texto_strtod", { options.analyzer, "--literais-strtod", options.input, NULL }, NULL, NULL },
+            { "lexer",        { options.analyzer, "--simbolos", literals_dir, "--threads", "1", NULL }, NULL, NULL },
+            { "lexer_strtod", { options.analyzer, "--literais-strtod", "--simbolos", literals_dir, "--threads", "1", NULL },
+              NULL, NULL },
+        };
+        phase_count = sizeof(literal_phases) / sizeof(literal_phases[0]);
+        memcpy(phases, literal_phases, sizeof(literal_phases));
+    }
+
+    // --max-memory logo depois do binario do analisador, em todas as fases
+    if (options.max_memory != NULL) {
+        for (int i = 0; i < phase_count; i++) {
+            if (phases[i].args[0] != options.analyzer) continue;
+            int last = 0;
+            while (phases[i].args[last] != NULL) last++;
+            for (int j = last; j >= 1; j--) phases[i].args[j + 2] = phases[i].args[j];
+            phases[i].args[1] = "--max-memory";
+            phases[i].args[2] = options.max_memory;
+        }
+    }
+
+    for (int i = 0; i < phase_count; i++) {
+        if (run_phase(&options, &phases[i], &results[i]) != 0) {
+            fprintf(stderr, "Erro ao executar a fase %s com %s\n", phases[i].name, options.analyzer);
+            return 1;
+        }
+    }
+
+    // Tamanhos tirados das saidas da fase texto
+    uint64_t bytes = file_size(options.input);
+    uint64_t lex_lines = count_lines(lex, NULL);
+    uint64_t tokens = lex_lines > 3 ? lex_lines - 3 : 0;
+    uint64_t productions = count_lines(syntax, " -> ");
+
+    print_table(bytes, tokens, productions, results, phase_count);
+    for (int i = 0; i < phase_count; i++) {
+        if (results[i].exit_code == EXIT_MEMORY) {
+            printf("%s: limite de memoria excedido (--max-memory %s MB)\n", results[i].name, options.max_memory);
+        }
+    }
+
+    // Divisao interna da fase texto (lexica, sintatica, .syntax, escrita)
+    // vinda de --stats=json
+    char stats_filename[4200];
+    char internal_stats[4096] = "";
+    snprintf(stats_filename, sizeof(stats_filename), "%s/bench-stats.json", options.work_dir);
+    const char* stats_args[] = { options.analyzer, "--stats=json", options.input, NULL, NULL, NULL, NULL, NULL };
+    if (options.execution || options.loops) {
+        stats_args[2] = "--sem-rastro";
+        stats_args[3] = "--executar";
+        stats_args[4] = "--max-passos";
+        stats_args[5] = "0";
+        stats_args[6] = options.input;
+    }
+    if (run_command(stats_args, NULL, stats_filename, &seconds, &rss) >= 0) {
+        FILE* file = fopen(stats_filename, "r");
+        if (file != NULL) {
+            if (fgets(internal_stats, sizeof(internal_stats), file) == NULL || internal_stats[0] != '{') {
+                internal_stats[0] = '\0';
+            }
+            internal_stats[strcspn(internal_stats, "\n")] = '\0';
+            fclose(file);
+        }
+    }
+    if (internal_stats[0] != '\0') {
+        printf("Fases internas (%s): %s\n", options.execution || options.loops ? "interpretador" : "texto", internal_stats);
+    }
+
+    if (options.output != NULL) {
+        FILE* out = fopen(options.output, "w");
+        if (!out) {
+            fprintf(stderr, "Erro ao criar %s\n", options.output);
+            return 1;
+        }
+        write_json(out, &options, bytes, tokens, productions, internal_stats, results, phase_count);
+        fclose(out);
+        printf("Resultados salvos em: %s\n", options.output);
+    }
+
+    return options.compare != NULL ? compare_results(options.compare, results, phase_count) : 0;
+}
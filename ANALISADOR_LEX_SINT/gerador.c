@@ -0,0 +1,452 @@
+// Gerador de programas mini-Pascal para testes de desempenho.
+// Segue a gramatica de Program()...Factor() do analisador; a mesma semente
+// gera sempre o mesmo programa. Com --executavel o programa tambem roda ate
+// o fim em --executar/--compilar: lacos contados, divisores nunca nulos e
+// so variaveis inteiras nas expressoes. Com --numerico a maior parte dos
+// fatores sao literais longos (inteiros de ate 18 digitos, reais com 17
+// digitos e expoentes de -300 a 300), para medir a conversao dos literais.
+// Com --lacos (implica --executavel) quase todo comando e um laco contado
+// como o de testecerto.3, com corpo de acumulacoes inteiras: a primeira
+// metade das variaveis so e escrita nos lacos e a segunda so e lida.
+//
+//   gcc gerador.c -o gerador
+//   ./gerador --semente 7 --tamanho 20 > grande.mpas
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    uint64_t seed;
+    uint64_t size;
+    int identifiers;
+    int nesting;
+    int expression_depth;
+    double error_rate;
+    bool executable;
+    bool numeric;
+    bool loops;
+    int iterations;
+} GeneratorOptions;
+
+typedef struct {
+    FILE* out;
+    uint64_t state;
+    uint64_t written;
+    uint64_t errors;
+    GeneratorOptions options;
+} Generator;
+
+// splitmix64: rapido e reproduzivel em qualquer plataforma
+static uint64_t next_random(Generator* gen) {
+    uint64_t z = (gen->state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static int random_below(Generator* gen, int limit) {
+    return (int)(next_random(gen) % (uint64_t)limit);
+}
+
+static double random_unit(Generator* gen) {
+    return (double)(next_random(gen) >> 11) / 9007199254740992.0;
+}
+
+static void emit(Generator* gen, const char* text) {
+    size_t length = strlen(text);
+    fwrite(text, 1, length, gen->out);
+    gen->written += length;
+}
+
+static void emit_indent(Generator* gen, int level) {
+    for (int i = 0; i < level; i++) emit(gen, "  ");
+}
+
+static void emit_variable(Generator* gen) {
+    char name[32];
+    snprintf(name, sizeof(name), "v%d", random_below(gen, gen->options.identifiers));
+    emit(gen, name);
+}
+
+// Literal de --numerico: 10^(1..18) cabe com folga num int64
+static void emit_long_number(Generator* gen) {
+    char number[64];
+    int kind = random_below(gen, 10);
+    uint64_t limit = 10;
+    for (int digits = random_below(gen, 18); digits > 0; digits--) limit *= 10;
+
+    if (kind < 4) {
+        snprintf(number, sizeof(number), "%llu", (unsigned long long)(next_random(gen) % limit));
+    } else if (kind < 7) {
+        snprintf(number, sizeof(number), "%llu.%llu", (unsigned long long)(next_random(gen) % 1000000000),
+                 (unsigned long long)(next_random(gen) % 100000000));
+    } else {
+        snprintf(number, sizeof(number), "%d.%016lluE%d", 1 + random_below(gen, 9),
+                 (unsigned long long)(next_random(gen) % 10000000000000000ULL), random_below(gen, 601) - 300);
+    }
+    emit(gen, number);
+}
+
+static void emit_number(Generator* gen) {
+    char number[48];
+    int kind = gen->options.executable ? 0 : random_below(gen, 10);
+
+    if (gen->options.numeric && !gen->options.executable) {
+        emit_long_number(gen);
+        return;
+    }
+    if (kind < 7) {
+        snprintf(number, sizeof(number), "%d", random_below(gen, 10000));
+    } else if (kind < 9) {
+        snprintf(number, sizeof(number), "%d.%d", random_below(gen, 1000), random_below(gen, 100));
+    } else {
+        snprintf(number, sizeof(number), "%d.%de%d", random_below(gen, 10), random_below(gen, 10), random_below(gen, 20));
+    }
+    emit(gen, number);
+}
+
+static void emit_expression(Generator* gen, int depth, bool relational);
+
+// fator -> variavel | numero | ( expressao )
+static void emit_factor(Generator* gen, int depth) {
+    int kind = random_below(gen, 10);
+
+    if (depth > 0 && kind < 2) {
+        emit(gen, "(");
+        emit_expression(gen, depth - 1, false);
+        emit(gen, ")");
+    } else if (kind < (gen->options.numeric ? 3 : 6)) {
+        emit_variable(gen);
+    } else {
+        emit_number(gen);
+    }
+}
+
+// Divisor de --executavel: v * v + 1 nunca e zero, nem com estouro
+// (nenhum quadrado e -1 modulo 2^64)
+static void emit_safe_divisor(Generator* gen) {
+    char text[64];
+    int variable = random_below(gen, gen->options.identifiers);
+    snprintf(text, sizeof(text), "(v%d * v%d + 1)", variable, variable);
+    emit(gen, text);
+}
+
+// termo -> fator { (* | / | mod) fator }
+static void emit_term(Generator* gen, int depth) {
+    static const char* operators[] = { " * ", " / ", " mod " };
+
+    emit_factor(gen, depth);
+    while (random_below(gen, 4) == 0) {
+        if (gen->options.executable) {
+            // '/' da real e fica so no topo da atribuicao (emit_command)
+            if (random_below(gen, 2)) {
+                emit(gen, " * ");
+                emit_factor(gen, depth);
+            } else {
+                emit(gen, " mod ");
+                emit_safe_divisor(gen);
+            }
+            continue;
+        }
+        emit(gen, operators[random_below(gen, 3)]);
+        emit_factor(gen, depth);
+    }
+}
+
+// expressao_simples -> [+ | -] termo { (+ | -) termo }
+static void emit_simple_expression(Generator* gen, int depth) {
+    if (random_below(gen, 8) == 0) emit(gen, random_below(gen, 2) ? "-" : "+");
+    emit_term(gen, depth);
+    while (random_below(gen, 3) == 0) {
+        emit(gen, random_below(gen, 2) ? " + " : " - ");
+        emit_term(gen, depth);
+    }
+}
+
+// expressao -> expressao_simples [ relacao expressao_simples ]
+static void emit_expression(Generator* gen, int depth, bool relational) {
+    static const char* relations[] = { " = ", " < ", " <= ", " >= ", " > ", " <> " };
+
+    emit_simple_expression(gen, depth);
+    if (relational || random_below(gen, 6) == 0) {
+        emit(gen, relations[random_below(gen, 6)]);
+        emit_simple_expression(gen, depth);
+    }
+}
+
+// Erros sintaticos e lexicos que o analisador deve reportar
+static void emit_error(Generator* gen, int level) {
+    gen->errors++;
+    emit_indent(gen, level);
+    switch (random_below(gen, 5)) {
+        case 0: emit_variable(gen); emit(gen, " := ;\n"); break;
+        case 1: emit_variable(gen); emit(gen, " := 1 @ 2;\n"); break;
+        case 2: emit(gen, "if "); emit_variable(gen); emit(gen, " "); emit_variable(gen); emit(gen, " := 0;\n"); break;
+        case 3: emit_variable(gen); emit(gen, " := 'texto nao fechado\n"); break;
+        default: emit(gen, "while do "); emit_variable(gen); emit(gen, " := 1;\n"); break;
+    }
+}
+
+static void emit_command(Generator* gen, int level, int nesting);
+
+// comando_composto -> begin comando ; { comando ; } end
+static void emit_compound(Generator* gen, int level, int nesting) {
+    int count = 1 + random_below(gen, 4);
+
+    emit(gen, "begin\n");
+    for (int i = 0; i < count; i++) {
+        emit_indent(gen, level + 1);
+        emit_command(gen, level + 1, nesting - 1);
+        emit(gen, ";\n");
+    }
+    emit_indent(gen, level);
+    emit(gen, "end");
+}
+
+// comando -> atribuicao | comando_composto | comando_condicional | comando_repetitivo
+static void emit_command(Generator* gen, int level, int nesting) {
+    int kind = nesting > 0 ? random_below(gen, 10) : 0;
+    int depth = gen->options.expression_depth;
+
+    if (kind < 6) {
+        emit_variable(gen);
+        emit(gen, " := ");
+        if (gen->options.executable && random_below(gen, 4) == 0) {
+            // |a / (v * v + 1)| <= |a|: o resultado truncado cabe no integer
+            emit_simple_expression(gen, depth);
+            emit(gen, " / ");
+            emit_safe_divisor(gen);
+        } else {
+            emit_expression(gen, depth, false);
+        }
+    } else if (kind < 8) {
+        emit(gen, "if ");
+        emit_expression(gen, depth, true);
+        emit(gen, " then ");
+        emit_command(gen, level, nesting - 1);
+        if (random_below(gen, 2)) {
+            emit(gen, "\n");
+            emit_indent(gen, level);
+            emit(gen, "else ");
+            emit_command(gen, level, nesting - 1);
+        }
+    } else if (kind < 9 && gen->options.executable) {
+        // Laco contado; um contador por nivel de aninhamento, que o corpo
+        // nao altera
+        char text[96];
+        snprintf(text, sizeof(text), "begin\n");
+        emit(gen, text);
+        emit_indent(gen, level + 1);
+        snprintf(text, sizeof(text), "c%d := 0;\n", nesting);
+        emit(gen, text);
+        emit_indent(gen, level + 1);
+        snprintf(text, sizeof(text), "while c%d < %d do\n", nesting, 1 + random_below(gen, gen->options.iterations));
+        emit(gen, text);
+        emit_indent(gen, level + 1);
+        emit(gen, "begin\n");
+        emit_indent(gen, level + 2);
+        emit_command(gen, level + 2, nesting - 1);
+        emit(gen, ";\n");
+        emit_indent(gen, level + 2);
+        snprintf(text, sizeof(text), "c%d := c%d + 1\n", nesting, nesting);
+        emit(gen, text);
+        emit_indent(gen, level + 1);
+        emit(gen, "end\n");
+        emit_indent(gen, level);
+        emit(gen, "end");
+    } else if (kind < 9) {
+        emit(gen, "while ");
+        emit_expression(gen, depth, true);
+        emit(gen, " do ");
+        emit_command(gen, level, nesting - 1);
+    } else {
+        emit_compound(gen, level, nesting);
+    }
+}
+
+// --lacos: polinomio inteiro no contador c<nivel> e nas variaveis so lidas,
+// com grau ate degree no contador
+static void emit_loop_polynomial(Generator* gen, int nesting, int degree) {
+    int targets = (gen->options.identifiers + 1) / 2, inputs = gen->options.identifiers - targets;
+    int terms = 1 + random_below(gen, 3);
+    char text[48];
+
+    for (int t = 0; t < terms; t++) {
+        if (t > 0) emit(gen, random_below(gen, 3) ? " + " : " - ");
+        snprintf(text, sizeof(text), "%d", 1 + random_below(gen, 100));
+        emit(gen, text);
+        for (int d = t == 0 ? degree : random_below(gen, degree + 1); d > 0; d--) {
+            snprintf(text, sizeof(text), " * c%d", nesting);
+            emit(gen, text);
+        }
+        if (inputs > 0 && random_below(gen, 2)) {
+            snprintf(text, sizeof(text), " * v%d", targets + random_below(gen, inputs));
+            emit(gen, text);
+        }
+    }
+}
+
+// --lacos: c := inicio; while c < limite do begin ...; c := c + passo end.
+// Cada alvo aparece uma vez no corpo; de vez em quando entra um comando
+// qualquer ou um laco interno (um nivel so, ate 16 voltas), que tiram o
+// laco da forma mais simples
+static void emit_counted_loop(Generator* gen, int level, int nesting, bool inner) {
+    int targets = (gen->options.identifiers + 1) / 2;
+    int count = 1 + random_below(gen, 4), first = random_below(gen, targets), step = 1 + random_below(gen, 3);
+    char text[96];
+
+    emit(gen, "begin\n");
+    emit_indent(gen, level + 1);
+    snprintf(text, sizeof(text), "c%d := %d;\n", nesting, random_below(gen, 10));
+    emit(gen, text);
+    emit_indent(gen, level + 1);
+    snprintf(text, sizeof(text), "while c%d %s %d do\n", nesting, random_below(gen, 2) ? "<" : "<=",
+             1 + random_below(gen, inner ? 16 : gen->options.iterations));
+    emit(gen, text);
+    emit_indent(gen, level + 1);
+    emit(gen, "begin\n");
+    for (int i = 0; i < count && i < targets; i++) {
+        int target = (first + i) % targets, kind = random_below(gen, 20);
+        emit_indent(gen, level + 2);
+        if (kind < 2 && nesting > 0 && !inner) {
+            emit_counted_loop(gen, level + 2, nesting - 1, true);
+        } else if (kind < 3) {
+            emit_command(gen, level + 2, 0);
+        } else if (kind < 14) {
+            snprintf(text, sizeof(text), "v%d := v%d + ", target, target);
+            emit(gen, text);
+            emit_loop_polynomial(gen, nesting, kind < 10 ? 1 : 2 + random_below(gen, 2));
+        } else {
+            snprintf(text, sizeof(text), "v%d := ", target);
+            emit(gen, text);
+            emit_loop_polynomial(gen, nesting, random_below(gen, 3));
+        }
+        emit(gen, ";\n");
+    }
+    emit_indent(gen, level + 2);
+    snprintf(text, sizeof(text), "c%d := c%d + %d\n", nesting, nesting, step);
+    emit(gen, text);
+    emit_indent(gen, level + 1);
+    emit(gen, "end\n");
+    emit_indent(gen, level);
+    emit(gen, "end");
+}
+
+static void generate(Generator* gen) {
+    char name[32];
+
+    emit(gen, "program gerado;\nvar ");
+    for (int i = 0; i < gen->options.identifiers; i++) {
+        snprintf(name, sizeof(name), i == 0 ? "v%d" : ", v%d", i);
+        emit(gen, name);
+    }
+    if (gen->options.executable) {
+        for (int i = 0; i <= gen->options.nesting; i++) {
+            snprintf(name, sizeof(name), ", c%d", i);
+            emit(gen, name);
+        }
+    }
+    emit(gen, ": integer;\n    total: real;\nbegin\n");
+
+    // Valores iniciais diferentes de zero
+    for (int i = 0; gen->options.executable && i < gen->options.identifiers; i++) {
+        char text[64];
+        snprintf(text, sizeof(text), "  v%d := %d;\n", i, i + 1);
+        emit(gen, text);
+    }
+
+    while (gen->written < gen->options.size) {
+        if (!gen->options.executable && gen->options.error_rate > 0 && random_unit(gen) < gen->options.error_rate) {
+            emit_error(gen, 1);
+            continue;
+        }
+        emit_indent(gen, 1);
+        if (gen->options.loops && random_below(gen, 8) > 0) emit_counted_loop(gen, 1, gen->options.nesting, false);
+        else emit_command(gen, 1, gen->options.nesting);
+        emit(gen, ";\n");
+    }
+    if (gen->options.executable) emit(gen, "  total := v0 / 3\nend.\n");
+    else emit(gen, "  total := 0\nend.\n");
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Uso: %s [opcoes] [saida.mpas]\n", program);
+    fprintf(stderr, "  --semente N          semente do gerador (padrao 1)\n");
+    fprintf(stderr, "  --tamanho MB         tamanho aproximado do programa (padrao 1; aceita fracao)\n");
+    fprintf(stderr, "  --identificadores N  quantidade de variaveis declaradas (padrao 16)\n");
+    fprintf(stderr, "  --aninhamento N      profundidade maxima de begin/if/while (padrao 3)\n");
+    fprintf(stderr, "  --expressao N        profundidade maxima de parenteses (padrao 3)\n");
+    fprintf(stderr, "  --erros P            fracao de comandos com erro, de 0 a 1 (padrao 0)\n");
+    fprintf(stderr, "  --executavel         programa que roda ate o fim com --executar (lacos contados)\n");
+    fprintf(stderr, "  --iteracoes N        maximo de iteracoes de cada laco com --executavel (padrao 100)\n");
+    fprintf(stderr, "  --numerico           a maior parte dos fatores sao literais longos (inteiros e reais)\n");
+    fprintf(stderr, "  --lacos              quase so lacos contados com acumulacoes (implica --executavel)\n");
+}
+
+int main(int argc, char* argv[]) {
+    Generator gen = { 0 };
+    const char* output_filename = NULL;
+
+    gen.options.seed = 1;
+    gen.options.size = 1024 * 1024;
+    gen.options.identifiers = 16;
+    gen.options.nesting = 3;
+    gen.options.expression_depth = 3;
+    gen.options.iterations = 100;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--semente") == 0 && has_value) {
+            gen.options.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--tamanho") == 0 && has_value) {
+            gen.options.size = (uint64_t)(strtod(argv[++i], NULL) * 1024 * 1024);
+        } else if (strcmp(argv[i], "--identificadores") == 0 && has_value) {
+            gen.options.identifiers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--aninhamento") == 0 && has_value) {
+            gen.options.nesting = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--expressao") == 0 && has_value) {
+            gen.options.expression_depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--erros") == 0 && has_value) {
+            gen.options.error_rate = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--executavel") == 0) {
+            gen.options.executable = true;
+        } else if (strcmp(argv[i], "--iteracoes") == 0 && has_value) {
+            gen.options.iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--numerico") == 0) {
+            gen.options.numeric = true;
+        } else if (strcmp(argv[i], "--lacos") == 0) {
+            gen.options.loops = true;
+            gen.options.executable = true;
+        } else if (output_filename == NULL && strncmp(argv[i], "--", 2) != 0) {
+            output_filename = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (gen.options.identifiers < 1 || gen.options.nesting < 0 || gen.options.expression_depth < 0 ||
+        gen.options.iterations < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    gen.out = output_filename != NULL ? fopen(output_filename, "w") : stdout;
+    if (gen.out == NULL) {
+        fprintf(stderr, "Erro ao criar arquivo de saida: %s\n", output_filename);
+        return 1;
+    }
+    setvbuf(gen.out, NULL, _IOFBF, 256 * 1024);
+    gen.state = gen.options.seed;
+
+    generate(&gen);
+
+    if (gen.out != stdout) fclose(gen.out);
+    else fflush(stdout);
+    fprintf(stderr, "%llu bytes, %llu erros inseridos\n",
+            (unsigned long long)gen.written, (unsigned long long)gen.errors);
+    return 0;
+}
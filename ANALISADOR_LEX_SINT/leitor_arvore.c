@@ -0,0 +1,140 @@
+// Exemplo de ferramenta que usa o snapshot da arvore (arvore.h) em vez de
+// rodar o analisador de novo: abre arquivo.mpas.arvore com mmap e calcula
+// metricas do programa (comandos por tipo, profundidade, usos de cada
+// variavel). Tambem serve de leitor no benchmark --arvore.
+//
+//   gcc leitor_arvore.c -o leitor_arvore
+//   ./analisadorlexsint --sem-rastro --arvore prog.mpas
+//   ./leitor_arvore [--validar] [--listar] prog.mpas.arvore
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "arvore.h"
+
+static double now_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static const char* statement_name(uint8_t kind) {
+    switch (kind) {
+        case MPAS_STMT_ASSIGNMENT: return "atribuicao";
+        case MPAS_STMT_COMPOUND: return "begin";
+        case MPAS_STMT_CONDITIONAL: return "if";
+        case MPAS_STMT_REPETITIVE: return "while";
+    }
+    return "?";
+}
+
+// Uma linha por comando, indentada pela profundidade, com o trecho do fonte
+static void list_statements(const MpasTree* tree, const int32_t* depth) {
+    for (uint32_t i = 0; i < tree->header->statement_count; i++) {
+        const MpasTreeStatement* node = mpas_tree_statement(tree, (int32_t)i);
+        printf("%*s%s", 2 * depth[i], "", statement_name(node->kind));
+        if (node->kind == MPAS_STMT_ASSIGNMENT) printf(" %s", mpas_tree_string(tree, mpas_tree_symbol(tree, node->symbol)->name));
+        printf("  %lld:%lld-%lld:%lld\n", (long long)node->span.line, (long long)node->span.column,
+               (long long)node->span.end_line, (long long)node->span.end_column);
+    }
+}
+
+// As variaveis com contagem zero (no maximo 10 linhas)
+static void report_unused(const MpasTree* tree, const uint64_t* counts, const char* what) {
+    int unused = 0;
+    for (uint32_t i = 0; i < tree->header->symbol_count; i++) {
+        if (counts[i] == 0 && unused++ < 10) {
+            const MpasTreeSymbol* symbol = &tree->symbols[i];
+            printf("variavel nunca %s: %s (linha %lld, coluna %lld)\n", what, mpas_tree_string(tree, symbol->name),
+                   (long long)symbol->span.line, (long long)symbol->span.column);
+        }
+    }
+    if (unused > 10) printf("... e mais %d variaveis nunca %ss\n", unused - 10, what);
+}
+
+int main(int argc, char* argv[]) {
+    const char* filename = NULL;
+    bool validate = false, list = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--validar") == 0) validate = true;
+        else if (strcmp(argv[i], "--listar") == 0) list = true;
+        else if (filename == NULL) filename = argv[i];
+        else filename = NULL, i = argc;
+    }
+    if (filename == NULL) {
+        fprintf(stderr, "Uso: %s [--validar] [--listar] <arquivo.mpas.arvore>\n", argv[0]);
+        return 1;
+    }
+
+    double start = now_seconds();
+    MpasTree tree;
+    int status = mpas_tree_open(&tree, filename);
+    if (status != 0) {
+        fprintf(stderr, "%s: %s\n", filename, mpas_tree_error(status));
+        return 1;
+    }
+    if (validate && !mpas_tree_validate(&tree)) {
+        fprintf(stderr, "%s: %s\n", filename, mpas_tree_error(MPAS_TREE_ERROR_FORMAT));
+        mpas_tree_close(&tree);
+        return 1;
+    }
+    double loaded = now_seconds();
+
+    // O fonte fica ao lado, sem o ".arvore"
+    size_t length = strlen(filename);
+    if (length > 7 && strcmp(filename + length - 7, ".arvore") == 0) {
+        char* source = strndup(filename, length - 7);
+        if (!mpas_tree_is_current(&tree, source)) fprintf(stderr, "aviso: %s mudou depois do snapshot\n", source);
+        free(source);
+    }
+
+    // O pai tem sempre id menor, entao a profundidade sai numa passada so
+    uint32_t statements = tree.header->statement_count, symbols = tree.header->symbol_count;
+    int32_t* depth = malloc(sizeof(int32_t) * (statements + 1));
+    uint64_t* reads = calloc(symbols + 1, sizeof(uint64_t));
+    uint64_t* writes = calloc(symbols + 1, sizeof(uint64_t));
+    uint64_t kinds[4] = { 0 }, operators[MPAS_OP_NONE + 1] = { 0 };
+    int32_t max_depth = 0;
+    int64_t last_line = 0;
+
+    for (uint32_t i = 0; i < statements; i++) {
+        const MpasTreeStatement* node = &tree.statements[i];
+        depth[i] = node->parent >= 0 ? depth[node->parent] + 1 : 0;
+        if (depth[i] > max_depth) max_depth = depth[i];
+        if (node->kind < 4) kinds[node->kind]++;
+        if (node->kind == MPAS_STMT_ASSIGNMENT && node->symbol >= 0) writes[node->symbol]++;
+        if (node->span.end_line > last_line) last_line = node->span.end_line;
+    }
+    for (uint32_t i = 0; i < tree.header->expression_count; i++) {
+        const MpasTreeExpression* node = &tree.expressions[i];
+        if (node->kind == MPAS_EXPR_VARIABLE && node->symbol >= 0) reads[node->symbol]++;
+        if (node->kind == MPAS_EXPR_BINARY) operators[node->op <= MPAS_OP_NONE ? node->op : MPAS_OP_NONE]++;
+    }
+    double walked = now_seconds();
+
+    if (list) list_statements(&tree, depth);
+    printf("programa %s: %u comandos (%llu atribuicoes, %llu begin, %llu if, %llu while), %u expressoes, %u simbolos, %lld linhas\n",
+           mpas_tree_program_name(&tree), statements, (unsigned long long)kinds[MPAS_STMT_ASSIGNMENT],
+           (unsigned long long)kinds[MPAS_STMT_COMPOUND], (unsigned long long)kinds[MPAS_STMT_CONDITIONAL],
+           (unsigned long long)kinds[MPAS_STMT_REPETITIVE], tree.header->expression_count, symbols, (long long)last_line);
+    printf("profundidade maxima de comandos: %d\noperadores:", max_depth);
+    for (int op = 0; op < MPAS_OP_NONE; op++) {
+        if (operators[op] > 0) printf(" %s %llu", mpas_tree_operator_text((uint8_t)op), (unsigned long long)operators[op]);
+    }
+    printf("\n");
+
+    report_unused(&tree, reads, "lida");
+    report_unused(&tree, writes, "atribuida");
+    printf("snapshot de %zu bytes: aberto em %.3f ms, percorrido em %.3f ms\n", tree.size, (loaded - start) * 1000.0,
+           (walked - loaded) * 1000.0);
+
+    free(depth);
+    free(reads);
+    free(writes);
+    mpas_tree_close(&tree);
+    return 0;
+}
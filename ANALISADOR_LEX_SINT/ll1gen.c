@@ -0,0 +1,431 @@
+// Gerador da tabela LL(1) usada por --ll1. Le a gramatica (gramatica.ll1),
+// calcula FIRST/FOLLOW, mostra os conflitos e grava o cabecalho C com a
+// tabela preditiva (tabela_ll1.h).
+//
+//   gcc ll1gen.c -o ll1gen
+//   ./ll1gen gramatica.ll1 tabela_ll1.h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+
+#define MAX_SYMBOLS 128
+#define MAX_PRODUCTIONS 254
+#define MAX_RHS 16
+#define MAX_NAME 64
+#define END_MARKER "TOK_EOF"
+
+typedef struct {
+    char name[MAX_NAME];
+    bool terminal;
+    char rule[MAX_NAME];
+    char message[160];
+} GrammarSymbol;
+
+typedef struct {
+    int lhs;
+    int rhs[MAX_RHS];
+    int length;
+    bool fallback;
+} Production;
+
+typedef struct {
+    GrammarSymbol symbols[MAX_SYMBOLS];
+    int symbol_count;
+    Production productions[MAX_PRODUCTIONS];
+    int production_count;
+    // first[s][t] / follow[n][t]: t e indice de simbolo terminal
+    bool first[MAX_SYMBOLS][MAX_SYMBOLS];
+    bool nullable[MAX_SYMBOLS];
+    bool follow[MAX_SYMBOLS][MAX_SYMBOLS];
+    int table[MAX_SYMBOLS][MAX_SYMBOLS];
+    int fallback[MAX_SYMBOLS];
+    int start;
+    int end_marker;
+} Grammar;
+
+typedef struct {
+    const char* text;
+    int line;
+} Scanner;
+
+static void fail(const Scanner* scanner, const char* message) {
+    fprintf(stderr, "gramatica, linha %d: %s\n", scanner->line, message);
+    exit(1);
+}
+
+// Proxima palavra: nome, ':', '|', ';', '=', '!' ou string entre aspas.
+// Devolve false no fim do arquivo
+static bool next_word(Scanner* scanner, char* word, size_t size) {
+    const char* p = scanner->text;
+    for (;;) {
+        while (*p && isspace((unsigned char)*p)) {
+            if (*p == '\n') scanner->line++;
+            p++;
+        }
+        if (*p != '#') break;
+        while (*p && *p != '\n') p++;
+    }
+    if (*p == '\0') {
+        scanner->text = p;
+        return false;
+    }
+
+    size_t length = 0;
+    if (*p == '"') {
+        word[length++] = *p++;
+        while (*p && *p != '"' && *p != '\n' && length < size - 2) word[length++] = *p++;
+        if (*p != '"') fail(scanner, "string sem aspas de fechamento");
+        word[length++] = *p++;
+    } else if (strchr(":|;=!", *p)) {
+        word[length++] = *p++;
+    } else {
+        while (*p && (isalnum((unsigned char)*p) || *p == '_') && length < size - 1) word[length++] = *p++;
+        if (length == 0) fail(scanner, "caractere inesperado");
+    }
+    word[length] = '\0';
+    scanner->text = p;
+    return true;
+}
+
+static int find_symbol(Grammar* grammar, const char* name) {
+    for (int i = 0; i < grammar->symbol_count; i++) {
+        if (strcmp(grammar->symbols[i].name, name) == 0) return i;
+    }
+    if (grammar->symbol_count == MAX_SYMBOLS) {
+        fprintf(stderr, "gramatica: simbolos demais\n");
+        exit(1);
+    }
+    GrammarSymbol* symbol = &grammar->symbols[grammar->symbol_count];
+    memset(symbol, 0, sizeof(*symbol));
+    snprintf(symbol->name, sizeof(symbol->name), "%s", name);
+    symbol->terminal = true;
+    return grammar->symbol_count++;
+}
+
+static void parse_grammar(Grammar* grammar, const char* text) {
+    Scanner scanner = { text, 1 };
+    char word[200];
+
+    grammar->start = -1;
+    while (next_word(&scanner, word, sizeof(word))) {
+        if (!isalpha((unsigned char)word[0])) fail(&scanner, "nome de nao terminal esperado");
+        int lhs = find_symbol(grammar, word);
+        GrammarSymbol* symbol = &grammar->symbols[lhs];
+        if (!symbol->terminal) fail(&scanner, "nao terminal definido duas vezes");
+        symbol->terminal = false;
+        if (grammar->start < 0) grammar->start = lhs;
+
+        if (!next_word(&scanner, word, sizeof(word))) fail(&scanner, "':' esperado");
+        if (strcmp(word, "=") == 0) {
+            if (!next_word(&scanner, word, sizeof(word))) fail(&scanner, "regra esperada apos '='");
+            snprintf(grammar->symbols[lhs].rule, MAX_NAME, "%.63s", word);
+            if (!next_word(&scanner, word, sizeof(word))) fail(&scanner, "':' esperado");
+        }
+        if (word[0] == '"') {
+            snprintf(grammar->symbols[lhs].message, sizeof(grammar->symbols[lhs].message), "%.*s",
+                     (int)strlen(word) - 2, word + 1);
+            if (!next_word(&scanner, word, sizeof(word))) fail(&scanner, "':' esperado");
+        }
+        if (strcmp(word, ":") != 0) fail(&scanner, "':' esperado");
+
+        // Alternativas separadas por '|' ate ';'
+        for (;;) {
+            if (grammar->production_count == MAX_PRODUCTIONS) fail(&scanner, "producoes demais");
+            Production* production = &grammar->productions[grammar->production_count++];
+            production->lhs = lhs;
+            production->length = 0;
+            production->fallback = false;
+
+            for (;;) {
+                if (!next_word(&scanner, word, sizeof(word))) fail(&scanner, "';' esperado");
+                if (strcmp(word, "|") == 0 || strcmp(word, ";") == 0) break;
+                if (strcmp(word, "!") == 0 && production->length == 0) {
+                    production->fallback = true;
+                    continue;
+                }
+                if (!isalpha((unsigned char)word[0])) fail(&scanner, "simbolo esperado");
+                if (production->length == MAX_RHS) fail(&scanner, "alternativa longa demais");
+                production->rhs[production->length++] = find_symbol(grammar, word);
+            }
+            if (strcmp(word, ";") == 0) break;
+        }
+    }
+    if (grammar->start < 0) fail(&scanner, "gramatica vazia");
+    grammar->end_marker = find_symbol(grammar, END_MARKER);
+}
+
+// FIRST de uma sequencia; devolve true se a sequencia inteira pode ser vazia
+static bool first_of_sequence(Grammar* grammar, const int* sequence, int length, bool* result) {
+    for (int i = 0; i < length; i++) {
+        int symbol = sequence[i];
+        for (int t = 0; t < grammar->symbol_count; t++) {
+            if (grammar->first[symbol][t]) result[t] = true;
+        }
+        if (!grammar->nullable[symbol]) return false;
+    }
+    return true;
+}
+
+static void compute_sets(Grammar* grammar) {
+    for (int s = 0; s < grammar->symbol_count; s++) {
+        if (grammar->symbols[s].terminal) grammar->first[s][s] = true;
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int p = 0; p < grammar->production_count; p++) {
+            Production* production = &grammar->productions[p];
+            bool first[MAX_SYMBOLS] = { false };
+            bool nullable = first_of_sequence(grammar, production->rhs, production->length, first);
+
+            for (int t = 0; t < grammar->symbol_count; t++) {
+                if (first[t] && !grammar->first[production->lhs][t]) {
+                    grammar->first[production->lhs][t] = true;
+                    changed = true;
+                }
+            }
+            if (nullable && !grammar->nullable[production->lhs]) {
+                grammar->nullable[production->lhs] = true;
+                changed = true;
+            }
+        }
+    }
+
+    grammar->follow[grammar->start][grammar->end_marker] = true;
+    changed = true;
+    while (changed) {
+        changed = false;
+        for (int p = 0; p < grammar->production_count; p++) {
+            Production* production = &grammar->productions[p];
+            for (int i = 0; i < production->length; i++) {
+                int symbol = production->rhs[i];
+                if (grammar->symbols[symbol].terminal) continue;
+
+                bool first[MAX_SYMBOLS] = { false };
+                bool nullable = first_of_sequence(grammar, production->rhs + i + 1, production->length - i - 1, first);
+                for (int t = 0; t < grammar->symbol_count; t++) {
+                    bool add = first[t] || (nullable && grammar->follow[production->lhs][t]);
+                    if (add && !grammar->follow[symbol][t]) {
+                        grammar->follow[symbol][t] = true;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void print_production(FILE* out, const Grammar* grammar, int p) {
+    const Production* production = &grammar->productions[p];
+    fprintf(out, "%s ->", grammar->symbols[production->lhs].name);
+    if (production->length == 0) fprintf(out, " (vazio)");
+    for (int i = 0; i < production->length; i++) fprintf(out, " %s", grammar->symbols[production->rhs[i]].name);
+}
+
+// Monta a tabela; em conflito fica a alternativa listada primeiro.
+// Devolve o numero de conflitos
+static int build_table(Grammar* grammar) {
+    int conflicts = 0;
+
+    for (int n = 0; n < grammar->symbol_count; n++) {
+        for (int t = 0; t < grammar->symbol_count; t++) grammar->table[n][t] = -1;
+    }
+
+    for (int p = 0; p < grammar->production_count; p++) {
+        Production* production = &grammar->productions[p];
+        bool predict[MAX_SYMBOLS] = { false };
+        bool nullable = first_of_sequence(grammar, production->rhs, production->length, predict);
+        if (nullable) {
+            for (int t = 0; t < grammar->symbol_count; t++) {
+                if (grammar->follow[production->lhs][t]) predict[t] = true;
+            }
+        }
+
+        for (int t = 0; t < grammar->symbol_count; t++) {
+            if (!predict[t] || !grammar->symbols[t].terminal) continue;
+            int* cell = &grammar->table[production->lhs][t];
+            if (*cell < 0) {
+                *cell = p;
+                continue;
+            }
+            conflicts++;
+            fprintf(stderr, "conflito LL(1) em %s com %s:\n  usando   ", grammar->symbols[production->lhs].name,
+                    grammar->symbols[t].name);
+            print_production(stderr, grammar, *cell);
+            fprintf(stderr, "\n  ignorando ");
+            print_production(stderr, grammar, p);
+            fprintf(stderr, "\n");
+        }
+    }
+
+    // Producao padrao (marcada com '!', a unica alternativa ou a vazia):
+    // expande por ela em qualquer token sem entrada, inclusive os que nao
+    // aparecem na gramatica (TOK_ERROR, strings). O erro aparece no proximo
+    // terminal, no mesmo ponto (e com o mesmo rastro) da descida recursiva
+    for (int n = 0; n < grammar->symbol_count; n++) {
+        grammar->fallback[n] = -1;
+        if (grammar->symbols[n].terminal) continue;
+        int fallback = -1, marked = -1, alternatives = 0;
+        for (int p = 0; p < grammar->production_count; p++) {
+            if (grammar->productions[p].lhs != n) continue;
+            alternatives++;
+            if (grammar->productions[p].fallback) marked = p;
+            if (grammar->productions[p].length == 0 || fallback < 0) fallback = p;
+        }
+        if (marked >= 0) fallback = marked;
+        else if (alternatives > 1 && grammar->productions[fallback].length != 0) continue;
+        grammar->fallback[n] = fallback;
+    }
+    return conflicts;
+}
+
+static int nonterminal_index(const Grammar* grammar, int symbol) {
+    int index = 0;
+    for (int s = 0; s < symbol; s++) {
+        if (!grammar->symbols[s].terminal) index++;
+    }
+    return index;
+}
+
+static void write_symbol(FILE* out, const Grammar* grammar, int symbol) {
+    if (grammar->symbols[symbol].terminal) fprintf(out, "%s", grammar->symbols[symbol].name);
+    else fprintf(out, "LL1_NT(%d)", nonterminal_index(grammar, symbol));
+}
+
+static void write_header(FILE* out, const Grammar* grammar, const char* source, int conflicts) {
+    int nonterminals = 0;
+    int rhs_total = 0;
+    for (int s = 0; s < grammar->symbol_count; s++) nonterminals += !grammar->symbols[s].terminal;
+    for (int p = 0; p < grammar->production_count; p++) rhs_total += grammar->productions[p].length;
+
+    fprintf(out, "// Gerado por ll1gen a partir de %s; nao editar.\n", source);
+    fprintf(out, "// %d nao terminais, %d producoes, %d conflito(s) resolvido(s) pela ordem das alternativas.\n",
+            nonterminals, grammar->production_count, conflicts);
+    fprintf(out, "//\n// Simbolos: terminais sao valores de TokenType; nao terminais sao LL1_NT(i) < 0.\n\n");
+    fprintf(out, "#define LL1_NONTERMINALS %d\n", nonterminals);
+    fprintf(out, "#define LL1_NT(index) (-1 - (index))\n");
+    fprintf(out, "#define LL1_START LL1_NT(%d)\n\n", nonterminal_index(grammar, grammar->start));
+
+    fprintf(out, "typedef struct {\n    uint16_t rhs;\n    uint8_t length;\n} LL1Production;\n\n");
+
+    fprintf(out, "static const int16_t ll1_rhs[%d] = {\n", rhs_total > 0 ? rhs_total : 1);
+    int offset = 0;
+    for (int p = 0; p < grammar->production_count; p++) {
+        const Production* production = &grammar->productions[p];
+        if (production->length == 0) continue;
+        fprintf(out, "    ");
+        for (int i = 0; i < production->length; i++) {
+            write_symbol(out, grammar, production->rhs[i]);
+            fprintf(out, ", ");
+        }
+        fprintf(out, "// ");
+        print_production(out, grammar, p);
+        fprintf(out, "\n");
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static const LL1Production ll1_productions[%d] = {\n", grammar->production_count);
+    for (int p = 0; p < grammar->production_count; p++) {
+        fprintf(out, "    { %d, %d },\n", offset, grammar->productions[p].length);
+        offset += grammar->productions[p].length;
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "// Producao do rastro gravada ao expandir cada nao terminal (-1: nenhuma)\n");
+    fprintf(out, "static const int16_t ll1_trace_rule[LL1_NONTERMINALS] = {\n");
+    for (int s = 0; s < grammar->symbol_count; s++) {
+        if (grammar->symbols[s].terminal) continue;
+        fprintf(out, "    %s, // %s\n", grammar->symbols[s].rule[0] ? grammar->symbols[s].rule : "-1",
+                grammar->symbols[s].name);
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static const char* const ll1_error_message[LL1_NONTERMINALS] = {\n");
+    for (int s = 0; s < grammar->symbol_count; s++) {
+        if (grammar->symbols[s].terminal) continue;
+        fprintf(out, "    \"%s\",\n", grammar->symbols[s].message[0] ? grammar->symbols[s].message : "token nao esperado");
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "// Producao padrao + 1 de cada nao terminal; 0: sem padrao (erro)\n");
+    fprintf(out, "static const uint8_t ll1_default[LL1_NONTERMINALS] = {\n");
+    for (int s = 0; s < grammar->symbol_count; s++) {
+        if (grammar->symbols[s].terminal) continue;
+        fprintf(out, "    %d, // %s\n", grammar->fallback[s] + 1, grammar->symbols[s].name);
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "// Producao + 1 para cada (nao terminal, token); 0 usa ll1_default.\n");
+    fprintf(out, "// Celulas iguais a producao padrao sao omitidas\n");
+    fprintf(out, "static const uint8_t ll1_table[LL1_NONTERMINALS][TOK_ERROR + 1] = {\n");
+    for (int n = 0; n < grammar->symbol_count; n++) {
+        if (grammar->symbols[n].terminal) continue;
+        bool first = true;
+        for (int t = 0; t < grammar->symbol_count; t++) {
+            if (grammar->table[n][t] < 0 || grammar->table[n][t] == grammar->fallback[n]) continue;
+            if (first) fprintf(out, "    [%d] = {", nonterminal_index(grammar, n));
+            fprintf(out, "%s [%s] = %d", first ? "" : ",", grammar->symbols[t].name, grammar->table[n][t] + 1);
+            first = false;
+        }
+        if (!first) fprintf(out, " }, // %s\n", grammar->symbols[n].name);
+    }
+    fprintf(out, "};\n");
+}
+
+static char* read_text(const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = malloc((size_t)size + 1);
+    size_t count = fread(text, 1, (size_t)size, file);
+    text[count] = '\0';
+    fclose(file);
+    return text;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Uso: %s <gramatica.ll1> <tabela_ll1.h>\n", argv[0]);
+        return 1;
+    }
+
+    char* text = read_text(argv[1]);
+    if (text == NULL) {
+        fprintf(stderr, "Erro ao abrir arquivo: %s\n", argv[1]);
+        return 1;
+    }
+
+    static Grammar grammar;
+    parse_grammar(&grammar, text);
+    free(text);
+    compute_sets(&grammar);
+
+    for (int s = 0; s < grammar.symbol_count; s++) {
+        if (grammar.symbols[s].terminal) continue;
+        bool used = s == grammar.start;
+        for (int p = 0; p < grammar.production_count && !used; p++) {
+            for (int i = 0; i < grammar.productions[p].length; i++) used |= grammar.productions[p].rhs[i] == s;
+        }
+        if (!used) fprintf(stderr, "aviso: %s nao e usado\n", grammar.symbols[s].name);
+    }
+
+    int conflicts = build_table(&grammar);
+
+    FILE* out = fopen(argv[2], "w");
+    if (!out) {
+        fprintf(stderr, "Erro ao criar arquivo de saida: %s\n", argv[2]);
+        return 1;
+    }
+    const char* source = strrchr(argv[1], '/');
+    write_header(out, &grammar, source != NULL ? source + 1 : argv[1], conflicts);
+    fclose(out);
+
+    fprintf(stderr, "%s: %d producoes, %d conflito(s)\n", argv[2], grammar.production_count, conflicts);
+    return 0;
+}
@@ -0,0 +1,148 @@
+// Gerador da tabela de potencias de 5 usada na conversao dos literais reais
+// (Eisel-Lemire, em analisadorlexsint.c). Para cada q de -342 a 308 grava
+// 5^q normalizado em 128 bits (bit mais alto ligado): truncado para q >= 0
+// e arredondado para cima para q < 0, como no artigo de Lemire.
+//
+//   gcc pot5gen.c -o pot5gen
+//   ./pot5gen tabela_pot5.h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MIN_EXPONENT (-342)
+#define MAX_EXPONENT 308
+// 2^(2*795+128) e o maior numero usado; 64 palavras de 32 bits sobram
+#define BIG_WORDS 64
+
+typedef struct {
+    uint32_t word[BIG_WORDS];  // menos significativa primeiro
+} Big;
+
+static void big_set(Big* a, uint32_t value) {
+    memset(a, 0, sizeof(*a));
+    a->word[0] = value;
+}
+
+static void big_multiply(Big* a, uint32_t factor) {
+    uint64_t carry = 0;
+    for (int i = 0; i < BIG_WORDS; i++) {
+        uint64_t product = (uint64_t)a->word[i] * factor + carry;
+        a->word[i] = (uint32_t)product;
+        carry = product >> 32;
+    }
+}
+
+static int big_bits(const Big* a) {
+    for (int i = BIG_WORDS - 1; i >= 0; i--) {
+        if (a->word[i] != 0) return i * 32 + 32 - __builtin_clz(a->word[i]);
+    }
+    return 0;
+}
+
+static void big_set_bit(Big* a, int bit) {
+    a->word[bit / 32] |= 1u << (bit % 32);
+}
+
+static int big_compare(const Big* a, const Big* b) {
+    for (int i = BIG_WORDS - 1; i >= 0; i--) {
+        if (a->word[i] != b->word[i]) return a->word[i] < b->word[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+static void big_subtract(Big* a, const Big* b) {
+    uint64_t borrow = 0;
+    for (int i = 0; i < BIG_WORDS; i++) {
+        uint64_t difference = (uint64_t)a->word[i] - b->word[i] - borrow;
+        a->word[i] = (uint32_t)difference;
+        borrow = (difference >> 32) & 1;
+    }
+}
+
+static void big_shift_left(Big* a, int count) {
+    for (; count > 0; count--) {
+        for (int i = BIG_WORDS - 1; i > 0; i--) a->word[i] = (a->word[i] << 1) | (a->word[i - 1] >> 31);
+        a->word[0] <<= 1;
+    }
+}
+
+static void big_shift_right(Big* a, int count) {
+    for (; count > 0; count--) {
+        for (int i = 0; i < BIG_WORDS - 1; i++) a->word[i] = (a->word[i] >> 1) | (a->word[i + 1] << 31);
+        a->word[BIG_WORDS - 1] >>= 1;
+    }
+}
+
+// floor(2^exponent / divisor) por divisao longa, bit a bit
+static void big_divide_power_of_two(Big* quotient, int exponent, const Big* divisor) {
+    Big remainder;
+    big_set(&remainder, 0);
+    big_set(quotient, 0);
+    for (int bit = exponent; bit >= 0; bit--) {
+        big_shift_left(&remainder, 1);
+        if (bit == exponent) remainder.word[0] |= 1;
+        if (big_compare(&remainder, divisor) >= 0) {
+            big_subtract(&remainder, divisor);
+            big_set_bit(quotient, bit);
+        }
+    }
+}
+
+static void big_add_one(Big* a) {
+    for (int i = 0; i < BIG_WORDS; i++) {
+        if (++a->word[i] != 0) break;
+    }
+}
+
+// 5^q normalizado para [2^127, 2^128)
+static void power_of_five(int q, uint64_t* high, uint64_t* low) {
+    Big power, value;
+    big_set(&power, 1);
+    for (int i = 0; i < (q < 0 ? -q : q); i++) big_multiply(&power, 5);
+
+    if (q >= 0) {
+        value = power;
+        int bits = big_bits(&value);
+        if (bits > 128) big_shift_right(&value, bits - 128);
+        else big_shift_left(&value, 128 - bits);
+    } else {
+        // z: menor expoente com 2^z >= 5^-q (5^-q nunca e potencia de 2)
+        int z = big_bits(&power);
+        big_divide_power_of_two(&value, q >= -27 ? z + 127 : 2 * z + 128, &power);
+        big_add_one(&value);
+        int bits = big_bits(&value);
+        if (bits > 128) big_shift_right(&value, bits - 128);
+    }
+
+    *low = (uint64_t)value.word[1] << 32 | value.word[0];
+    *high = (uint64_t)value.word[3] << 32 | value.word[2];
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Uso: %s <tabela_pot5.h>\n", argv[0]);
+        return 1;
+    }
+    FILE* out = fopen(argv[1], "w");
+    if (out == NULL) {
+        fprintf(stderr, "Erro ao criar %s\n", argv[1]);
+        return 1;
+    }
+
+    fprintf(out, "// Gerado por pot5gen; nao editar.\n");
+    fprintf(out, "// 5^q normalizado em 128 bits (bit mais alto ligado) para q de %d a %d:\n", MIN_EXPONENT, MAX_EXPONENT);
+    fprintf(out, "// 64 bits altos e 64 baixos de cada potencia, truncado para q >= 0 e\n");
+    fprintf(out, "// arredondado para cima para q < 0.\n\n");
+    fprintf(out, "#define POW5_MIN_EXPONENT (%d)\n", MIN_EXPONENT);
+    fprintf(out, "#define POW5_MAX_EXPONENT %d\n\n", MAX_EXPONENT);
+    fprintf(out, "static const uint64_t pow5_128[%d] = {\n", 2 * (MAX_EXPONENT - MIN_EXPONENT + 1));
+    for (int q = MIN_EXPONENT; q <= MAX_EXPONENT; q++) {
+        uint64_t high, low;
+        power_of_five(q, &high, &low);
+        fprintf(out, "    0x%016llxULL, 0x%016llxULL, // 5^%d\n", (unsigned long long)high, (unsigned long long)low, q);
+    }
+    fprintf(out, "};\n");
+    fclose(out);
+    return 0;
+}
@@ -0,0 +1,230 @@
+// Gerado por ll1gen a partir de gramatica.ll1; nao editar.
+// 27 nao terminais, 55 producoes, 1 conflito(s) resolvido(s) pela ordem das alternativas.
+//
+// Simbolos: terminais sao valores de TokenType; nao terminais sao LL1_NT(i) < 0.
+
+#define LL1_NONTERMINALS 27
+#define LL1_NT(index) (-1 - (index))
+#define LL1_START LL1_NT(0)
+
+typedef struct {
+    uint16_t rhs;
+    uint8_t length;
+} LL1Production;
+
+static const int16_t ll1_rhs[91] = {
+    TOK_PROGRAM, ID, SMB_SEM, LL1_NT(1), SMB_DOT, // programa -> TOK_PROGRAM ID SMB_SEM bloco SMB_DOT
+    LL1_NT(2), LL1_NT(3), // bloco -> declaracoes comando_composto
+    TOK_VAR, LL1_NT(4), LL1_NT(5), // declaracoes -> TOK_VAR declaracao_variaveis mais_declaracoes
+    SMB_SEM, LL1_NT(6), // mais_declaracoes -> SMB_SEM proxima_declaracao
+    LL1_NT(4), LL1_NT(5), // proxima_declaracao -> declaracao_variaveis mais_declaracoes
+    LL1_NT(7), SMB_COLON, LL1_NT(8), // declaracao_variaveis -> lista_identificadores SMB_COLON tipo
+    ID, LL1_NT(9), // lista_identificadores -> ID mais_identificadores
+    SMB_COM, ID, LL1_NT(9), // mais_identificadores -> SMB_COM ID mais_identificadores
+    TOK_INTEGER, // tipo -> TOK_INTEGER
+    TOK_REAL, // tipo -> TOK_REAL
+    TOK_BEGIN, LL1_NT(10), SMB_SEM, LL1_NT(11), TOK_END, // comando_composto -> TOK_BEGIN comando SMB_SEM comandos TOK_END
+    LL1_NT(10), LL1_NT(12), // comandos -> comando fim_comando
+    SMB_SEM, LL1_NT(11), // fim_comando -> SMB_SEM comandos
+    LL1_NT(13), // comando -> atribuicao
+    LL1_NT(3), // comando -> comando_composto
+    LL1_NT(14), // comando -> comando_condicional
+    LL1_NT(15), // comando -> comando_repetitivo
+    LL1_NT(16), OP_ASS, LL1_NT(17), // atribuicao -> variavel OP_ASS expressao
+    TOK_IF, LL1_NT(17), TOK_THEN, LL1_NT(10), LL1_NT(18), // comando_condicional -> TOK_IF expressao TOK_THEN comando senao
+    TOK_ELSE, LL1_NT(10), // senao -> TOK_ELSE comando
+    TOK_WHILE, LL1_NT(17), TOK_DO, LL1_NT(10), // comando_repetitivo -> TOK_WHILE expressao TOK_DO comando
+    LL1_NT(19), LL1_NT(20), // expressao -> expressao_simples comparacao
+    LL1_NT(21), LL1_NT(19), // comparacao -> relacao expressao_simples
+    OP_EQ, // relacao -> OP_EQ
+    OP_NE, // relacao -> OP_NE
+    OP_LT, // relacao -> OP_LT
+    OP_LE, // relacao -> OP_LE
+    OP_GT, // relacao -> OP_GT
+    OP_GE, // relacao -> OP_GE
+    LL1_NT(22), LL1_NT(23), LL1_NT(24), // expressao_simples -> sinal termo mais_termos
+    OP_AD, // sinal -> OP_AD
+    OP_MIN, // sinal -> OP_MIN
+    OP_AD, LL1_NT(23), LL1_NT(24), // mais_termos -> OP_AD termo mais_termos
+    OP_MIN, LL1_NT(23), LL1_NT(24), // mais_termos -> OP_MIN termo mais_termos
+    LL1_NT(25), LL1_NT(26), // termo -> fator mais_fatores
+    OP_MUL, LL1_NT(25), LL1_NT(26), // mais_fatores -> OP_MUL fator mais_fatores
+    OP_DIV, LL1_NT(25), LL1_NT(26), // mais_fatores -> OP_DIV fator mais_fatores
+    OP_MOD, LL1_NT(25), LL1_NT(26), // mais_fatores -> OP_MOD fator mais_fatores
+    LL1_NT(16), // fator -> variavel
+    LIT_INT, // fator -> LIT_INT
+    LIT_REAL, // fator -> LIT_REAL
+    LIT_REAL_EXP, // fator -> LIT_REAL_EXP
+    SMB_OPA, LL1_NT(17), SMB_CPA, // fator -> SMB_OPA expressao SMB_CPA
+    ID, // variavel -> ID
+};
+
+static const LL1Production ll1_productions[55] = {
+    { 0, 5 },
+    { 5, 2 },
+    { 7, 3 },
+    { 10, 0 },
+    { 10, 2 },
+    { 12, 0 },
+    { 12, 2 },
+    { 14, 0 },
+    { 14, 3 },
+    { 17, 2 },
+    { 19, 3 },
+    { 22, 0 },
+    { 22, 1 },
+    { 23, 1 },
+    { 24, 5 },
+    { 29, 2 },
+    { 31, 0 },
+    { 31, 2 },
+    { 33, 0 },
+    { 33, 1 },
+    { 34, 1 },
+    { 35, 1 },
+    { 36, 1 },
+    { 37, 3 },
+    { 40, 5 },
+    { 45, 2 },
+    { 47, 0 },
+    { 47, 4 },
+    { 51, 2 },
+    { 53, 2 },
+    { 55, 0 },
+    { 55, 1 },
+    { 56, 1 },
+    { 57, 1 },
+    { 58, 1 },
+    { 59, 1 },
+    { 60, 1 },
+    { 61, 3 },
+    { 64, 1 },
+    { 65, 1 },
+    { 66, 0 },
+    { 66, 3 },
+    { 69, 3 },
+    { 72, 0 },
+    { 72, 2 },
+    { 74, 3 },
+    { 77, 3 },
+    { 80, 3 },
+    { 83, 0 },
+    { 83, 1 },
+    { 84, 1 },
+    { 85, 1 },
+    { 86, 1 },
+    { 87, 3 },
+    { 90, 1 },
+};
+
+// Producao do rastro gravada ao expandir cada nao terminal (-1: nenhuma)
+static const int16_t ll1_trace_rule[LL1_NONTERMINALS] = {
+    RULE_PROGRAM, // programa
+    RULE_BLOCK, // bloco
+    RULE_VARIABLE_DECLARATIONS_PART, // declaracoes
+    RULE_COMPOUND_COMMAND, // comando_composto
+    RULE_VARIABLE_DECLARATION, // declaracao_variaveis
+    -1, // mais_declaracoes
+    -1, // proxima_declaracao
+    RULE_IDENTIFIER_LIST, // lista_identificadores
+    RULE_TYPE, // tipo
+    -1, // mais_identificadores
+    RULE_COMMAND, // comando
+    -1, // comandos
+    -1, // fim_comando
+    RULE_ASSIGNMENT, // atribuicao
+    RULE_CONDITIONAL_COMMAND, // comando_condicional
+    RULE_REPETITIVE_COMMAND, // comando_repetitivo
+    RULE_VARIABLE, // variavel
+    RULE_EXPRESSION, // expressao
+    -1, // senao
+    RULE_SIMPLE_EXPRESSION, // expressao_simples
+    -1, // comparacao
+    RULE_RELATION, // relacao
+    -1, // sinal
+    RULE_TERM, // termo
+    -1, // mais_termos
+    RULE_FACTOR, // fator
+    -1, // mais_fatores
+};
+
+static const char* const ll1_error_message[LL1_NONTERMINALS] = {
+    "token nao esperado",
+    "token nao esperado",
+    "token nao esperado",
+    "token nao esperado",
+    "token nao esperado",
+    "token nao esperado",
+    "token nao esperado",
+    "token nao esperado",
+    "tipo esperado (integer ou real)",
+    "token nao esperado",
+    "comando esperado",
+    "token nao esperado",
+    "token nao esperado",
+    "token nao esperado",
+    "token nao esperado",
+    "token nao esperado",
+    "token nao esperado",
+    "token nao esperado",
+    "token nao esperado",
+    "token nao esperado",
+    "token nao esperado",
+    "operador relacional esperado",
+    "token nao esperado",
+    "token nao esperado",
+    "token nao esperado",
+    "fator esperado (variavel, numero ou expressao entre parenteses)",
+    "token nao esperado",
+};
+
+// Producao padrao + 1 de cada nao terminal; 0: sem padrao (erro)
+static const uint8_t ll1_default[LL1_NONTERMINALS] = {
+    1, // programa
+    2, // bloco
+    4, // declaracoes
+    15, // comando_composto
+    9, // declaracao_variaveis
+    6, // mais_declaracoes
+    7, // proxima_declaracao
+    10, // lista_identificadores
+    0, // tipo
+    12, // mais_identificadores
+    0, // comando
+    16, // comandos
+    19, // fim_comando
+    24, // atribuicao
+    25, // comando_condicional
+    28, // comando_repetitivo
+    55, // variavel
+    29, // expressao
+    27, // senao
+    38, // expressao_simples
+    31, // comparacao
+    0, // relacao
+    41, // sinal
+    45, // termo
+    44, // mais_termos
+    0, // fator
+    49, // mais_fatores
+};
+
+// Producao + 1 para cada (nao terminal, token); 0 usa ll1_default.
+// Celulas iguais a producao padrao sao omitidas
+static const uint8_t ll1_table[LL1_NONTERMINALS][TOK_ERROR + 1] = {
+    [2] = { [TOK_VAR] = 3 }, // declaracoes
+    [5] = { [SMB_SEM] = 5 }, // mais_declaracoes
+    [6] = { [TOK_BEGIN] = 8 }, // proxima_declaracao
+    [8] = { [TOK_INTEGER] = 13, [TOK_REAL] = 14 }, // tipo
+    [9] = { [SMB_COM] = 11 }, // mais_identificadores
+    [10] = { [ID] = 20, [TOK_BEGIN] = 21, [TOK_IF] = 22, [TOK_WHILE] = 23 }, // comando
+    [11] = { [TOK_END] = 17 }, // comandos
+    [12] = { [SMB_SEM] = 18 }, // fim_comando
+    [18] = { [TOK_ELSE] = 26 }, // senao
+    [20] = { [OP_EQ] = 30, [OP_NE] = 30, [OP_LT] = 30, [OP_LE] = 30, [OP_GT] = 30, [OP_GE] = 30 }, // comparacao
+    [21] = { [OP_EQ] = 32, [OP_NE] = 33, [OP_LT] = 34, [OP_LE] = 35, [OP_GT] = 36, [OP_GE] = 37 }, // relacao
+    [22] = { [OP_AD] = 39, [OP_MIN] = 40 }, // sinal
+    [24] = { [OP_AD] = 42, [OP_MIN] = 43 }, // mais_termos
+    [25] = { [ID] = 50, [LIT_INT] = 51, [LIT_REAL] = 52, [LIT_REAL_EXP] = 53, [SMB_OPA] = 54 }, // fator
+    [26] = { [OP_MUL] = 46, [OP_DIV] = 47, [OP_MOD] = 48 }, // mais_fatores
+};